@@ -0,0 +1,55 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/*
+ * A block of whitespace-separated text and the values parsed from it. Tokens
+ * are NUL-terminated in place in `data`, so `tokens[i]` can be handed straight
+ * to the stringToX() functions
+ */
+struct PercyBlock
+{
+    uint64_t sequence;
+
+    char *data;
+    size_t length;
+    size_t size;
+
+    char **tokens;
+    size_t count;
+
+    ValueType type;
+    void *values;
+    ParseErr *errors;
+};
+
+
+typedef struct PercyBlock Block;
+
+/*
+ * Input callback: fill `buf` with up to `size` bytes, setting `*length` to the
+ * number read (0 at end of input). Return non-zero on error
+ */
+typedef int (*BlockReader)(char *buf, size_t size, size_t *length, void *arg);
+
+/* Output callback: called once per parsed block. Return non-zero to stop */
+typedef int (*BlockWriter)(const Block *block, void *arg);
+
+
+Block *blockCreate(size_t size, ValueType type);
+void blockDestroy(Block *block);
+
+ParseErr blockFill(Block *block, BlockReader reader, void *arg, bool *final, size_t *carry);
+size_t blockTokenise(Block *block, bool final);
+size_t blockParse(Block *block, int arg);
+void *blockValue(const Block *block, size_t i);
+
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+
+/*
+ * A column of values parsed from a file. `errors` is a bitmap with bit `i`
+ * (bit `i % 8` of byte `i / 8`) set if token `i` did not parse successfully
+ */
+struct PercyColumn
+{
+    ValueType type;
+    size_t count;
+
+    const void *values;
+    const unsigned char *errors;
+
+    /* Cache file mapping, or heap buffers if the column was not mapped */
+    void *map;
+    size_t mapLength;
+    void *ownedValues;
+    unsigned char *ownedErrors;
+};
+
+
+typedef struct PercyColumn Column;
+
+
+ParseErr columnLoad(Column *column, const char *path, ValueType type, int arg, const char *cachePath);
+void columnFree(Column *column);
+
+const void *columnValue(const Column *column, size_t i);
+bool columnError(const Column *column, size_t i);
+
+
+#endif
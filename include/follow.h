@@ -0,0 +1,25 @@
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block.h"
+#include "parser.h"
+
+
+typedef struct PercyFollow Follow;
+
+
+ParseErr followOpen(Follow **follow, const char *path, ValueType type, int arg, size_t blockSize);
+void followClose(Follow *follow);
+
+ParseErr followPoll(Follow *follow, BlockWriter writer, void *writerArg);
+uint64_t followOffset(const Follow *follow);
+
+ParseErr followSave(const Follow *follow, const char *statePath);
+ParseErr followLoad(Follow *follow, const char *statePath);
+
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef INFER_H
+#define INFER_H
+
+
+#include <stddef.h>
+
+#include "parser.h"
+
+
+/*
+ * Result of type inference over a sample of tokens: the narrowest type that
+ * parses them all, and the smallest and largest values seen, as that type.
+ * Complex bounds are taken component-wise
+ */
+struct PercyInference
+{
+    ValueType type;
+    Value min;
+    Value max;
+    size_t count;
+};
+
+
+typedef struct PercyInference Inference;
+
+
+ParseErr percyInferType(Inference *inference, char **tokens, size_t n);
+
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef LEXED_H
+#define LEXED_H
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parser.h"
+
+
+enum PercyLexedKind
+{
+    LEXED_ZERO,
+    LEXED_FINITE,
+    LEXED_INFINITY,
+    LEXED_NAN
+};
+
+
+/*
+ * One real part of a lexed number, pointing into the lexed string. A finite
+ * value is its `length` significant digits (from the first to the last
+ * non-zero digit, skipping a `point` within them) read as an integer in
+ * `base`, times base^`exponent` x 2^`binaryExponent`. `start` is where the
+ * number was written, after its sign, or NULL if it was not (as for a lone
+ * imaginary unit)
+ */
+struct PercyLexedPart
+{
+    const char *digits;
+    const char *point;
+    size_t length;
+    int base;
+    long exponent;
+    long binaryExponent;
+    bool negative;
+    enum PercyLexedKind kind;
+    const char *start;
+};
+
+/*
+ * A real, imaginary or complex number, validated and lexed but not converted.
+ * A part that was not given is zero. `imaginary` is set if an imaginary part
+ * was given, in which case the number only converts to complex types
+ */
+struct PercyLexed
+{
+    struct PercyLexedPart re;
+    struct PercyLexedPart im;
+    bool imaginary;
+};
+
+
+typedef enum PercyLexedKind LexedKind;
+typedef struct PercyLexedPart LexedPart;
+typedef struct PercyLexed Lexed;
+
+
+ParseErr stringToLexed(Lexed *number, char *nptr, char **endptr);
+
+ParseErr lexedToDouble(double *x, const Lexed *number, double min, double max);
+ParseErr lexedToDoubleL(long double *x, const Lexed *number, long double min, long double max);
+ParseErr lexedToComplex(complex *z, const Lexed *number, complex min, complex max);
+
+#ifdef MP_PREC
+ParseErr lexedToMPFR(mpfr_t x, const Lexed *number, mpfr_t min, mpfr_t max, mpfr_rnd_t rnd);
+ParseErr lexedToMPC(mpc_t z, const Lexed *number, mpc_t min, mpc_t max, mpc_rnd_t rnd);
+#endif
+
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef MTX_H
+#define MTX_H
+
+
+#include <complex.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+enum PercyMatrixField
+{
+    MTX_REAL,
+    MTX_INTEGER,
+    MTX_COMPLEX,
+    MTX_PATTERN
+};
+
+enum PercyMatrixSymmetry
+{
+    MTX_GENERAL,
+    MTX_SYMMETRIC,
+    MTX_SKEW_SYMMETRIC,
+    MTX_HERMITIAN
+};
+
+
+/*
+ * A sparse matrix in coordinate (COO) form. Indices are 1-based, as in the
+ * file. `values` holds `double` for real fields, `int64_t` for integer fields
+ * (so every value is exact), `complex` for complex fields, and is NULL for
+ * pattern matrices. Only the entries stored in the file are loaded; symmetric
+ * matrices are not expanded
+ */
+struct PercyMatrix
+{
+    enum PercyMatrixField field;
+    enum PercyMatrixSymmetry symmetry;
+
+    unsigned long rows;
+    unsigned long cols;
+    size_t nonzeros;
+
+    unsigned long *rowIndices;
+    unsigned long *colIndices;
+    void *values;
+};
+
+
+typedef enum PercyMatrixField MatrixField;
+typedef enum PercyMatrixSymmetry MatrixSymmetry;
+typedef struct PercyMatrix Matrix;
+
+
+ParseErr mtxLoad(Matrix *matrix, const char *path, unsigned int threads, size_t *line);
+void mtxFree(Matrix *matrix);
+
+
+#endif
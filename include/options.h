@@ -0,0 +1,105 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "parser.h"
+
+
+/* Type of an option's target, and the parser its argument is read with */
+enum PercyOptionType
+{
+    OPTION_FLAG,            /* bool, set to true; takes no argument */
+    OPTION_STRING,          /* char *, set to the argument itself */
+    OPTION_ULONG,           /* unsigned long, stringToULong() in base `arg` */
+    OPTION_UINTMAX,         /* uintmax_t, stringToUIntMax() in base `arg` */
+    OPTION_DOUBLE,          /* double, stringToDouble() */
+    OPTION_DOUBLEL,         /* long double, stringToDoubleL() */
+    OPTION_COMPLEX_PART,    /* OptionComplexPart, stringToComplexPart() */
+    OPTION_COMPLEX,         /* complex, stringToComplex() */
+    OPTION_MEMORY,          /* size_t, stringToMemory() with default magnitude `arg` */
+    OPTION_DURATION,        /* int64_t nanoseconds, stringToDuration() */
+    OPTION_TIMESTAMP,       /* int64_t epoch nanoseconds, stringToTimestamp() */
+
+    #ifdef MP_PREC
+    OPTION_MPFR,            /* mpfr_t, stringToMPFRAuto() with at most `arg` bits */
+    OPTION_MPC,             /* mpc_t, stringToComplexMPCAuto() with at most `arg` bits */
+    #endif
+
+    OPTION_TYPES
+};
+
+
+/* A bound of an option's argument, in the member for its type */
+union PercyOptionBound
+{
+    unsigned long ulong;
+    uintmax_t uintmax;
+    double real;
+    long double realL;
+    size_t memory;
+    int64_t ns;
+};
+
+/*
+ * Target of an OPTION_COMPLEX_PART option: the value, whose other part is kept
+ * when one part is given, and which part the argument was
+ */
+struct PercyOptionComplexPart
+{
+    complex value;
+    ComplexPt part;
+};
+
+/*
+ * A command-line option, given as "--name", "--name=ARG" or "--name ARG",
+ * or as "-k", "-kARG" or "-k ARG" by its `key` (if not '\0'). The argument
+ * is parsed into `target` by the parser for `type`, and checked against `min`
+ * and `max`; if both are zero, the full range of the type is allowed (as it
+ * always is for complex and multiple-precision types). If `given` is not
+ * NULL, it is set to true once the option has been parsed
+ */
+struct PercyOption
+{
+    const char *name;
+    char key;
+    enum PercyOptionType type;
+    void *target;
+    union PercyOptionBound min;
+    union PercyOptionBound max;
+    int arg;
+    bool *given;
+};
+
+/*
+ * Why optionsParse() stopped: `result` is the parser's error, or PARSE_EFORM
+ * for a usage error. `option` is NULL for an unknown option, `word` is the
+ * long option as given or points at the short option's key, and `argument`
+ * is NULL for a missing argument (or is the one given to a flag)
+ */
+struct PercyOptionError
+{
+    ParseErr result;
+    const struct PercyOption *option;
+    const char *word;
+    const char *argument;
+};
+
+
+typedef enum PercyOptionType OptionType;
+typedef union PercyOptionBound OptionBound;
+typedef struct PercyOptionComplexPart OptionComplexPart;
+typedef struct PercyOption Option;
+typedef struct PercyOptionError OptionError;
+
+
+ParseErr optionsParse(const Option *options, size_t n, int argc, char **argv, int *operands, OptionError *error);
+void optionsWriteError(FILE *stream, const char *program, const OptionError *error);
+
+
+#endif
@@ -3,8 +3,11 @@
 
 
 #include <complex.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <uchar.h>
+#include <wchar.h>
 
 #ifdef MP_PREC
 #include <mpfr.h>
@@ -54,11 +57,58 @@ enum PercyMemoryMagnitude
     MEM_YB = 24
 };
 
+enum PercyComplexDialect
+{
+    DIALECT_STANDARD = 0x01,
+    DIALECT_PYTHON = 0x02,
+    DIALECT_FORTRAN = 0x04,
+    DIALECT_MATLAB = 0x08,
+    DIALECT_POLAR = 0x10,
+    DIALECT_ANY = 0x1F
+};
+
+enum PercyValueType
+{
+    VALUE_ULONG,
+    VALUE_UINTMAX,
+    VALUE_DOUBLE,
+    VALUE_DOUBLEL,
+    VALUE_COMPLEX,
+    VALUE_COMPLEXL,
+    VALUE_MEMORY
+};
+
+enum PercyByteSeparator
+{
+    BYTES_NONE = 0x00,
+    BYTES_SPACE = 0x01,
+    BYTES_COLON = 0x02
+};
+
 
 typedef enum PercyParserError ParseErr;
 typedef enum PercyNumberBase NumBase;
 typedef enum PercyComplexPart ComplexPt;
 typedef enum PercyMemoryMagnitude MemMag;
+typedef enum PercyComplexDialect ComplexDialect;
+typedef enum PercyValueType ValueType;
+typedef enum PercyByteSeparator ByteSep;
+
+
+/* Storage for a value of any `ValueType` */
+union PercyValue
+{
+    unsigned long ulong;
+    uintmax_t uintmax;
+    double real;
+    long double realL;
+    complex cmplx;
+    long double complex cmplxL;
+    size_t memory;
+};
+
+
+typedef union PercyValue Value;
 
 
 extern const complex CMPLX_MIN;
@@ -81,17 +131,72 @@ ParseErr stringToComplex(complex *z, char *nptr, complex min, complex max, char
 ParseErr stringToComplexL(long double complex *z, char *nptr, long double complex min, long double complex max,
                              char **endptr);
 
+ParseErr stringToComplexDialect(complex *z, char *nptr, complex min, complex max, char **endptr, int dialects);
+size_t stringToComplexDialectBatch(complex *z, ParseErr *errors, char **nptrs, size_t n, complex min, complex max,
+                                      int dialects);
+
 ParseErr stringToMemory(size_t *bytes, char *nptr, size_t min, size_t max, char **endptr, int magnitude);
 
+ParseErr stringToULongUTF8(unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr,
+                              int base);
+ParseErr stringToUIntMaxUTF8(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, int base);
+ParseErr stringToDoubleUTF8(double *x, char *nptr, double min, double max, char **endptr);
+ParseErr stringToDoubleLUTF8(long double *x, char *nptr, long double min, long double max, char **endptr);
+
+ParseErr stringToULongGrouped(unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr,
+                                 char separator, bool strict);
+ParseErr stringToUIntMaxGrouped(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr,
+                                   char separator, bool strict);
+ParseErr stringToDoubleGrouped(double *x, char *nptr, double min, double max, char **endptr,
+                                  char separator, bool strict);
+
+ParseErr stringToULongU16(unsigned long *x, char16_t *nptr, unsigned long min, unsigned long max, char16_t **endptr,
+                             int base);
+ParseErr stringToUIntMaxU16(uintmax_t *x, char16_t *nptr, uintmax_t min, uintmax_t max, char16_t **endptr,
+                               int base);
+ParseErr stringToDoubleU16(double *x, char16_t *nptr, double min, double max, char16_t **endptr);
+ParseErr stringToComplexU16(complex *z, char16_t *nptr, complex min, complex max, char16_t **endptr);
+ParseErr stringToMemoryU16(size_t *bytes, char16_t *nptr, size_t min, size_t max, char16_t **endptr,
+                              int magnitude);
+
+ParseErr stringToULongW(unsigned long *x, wchar_t *nptr, unsigned long min, unsigned long max, wchar_t **endptr,
+                           int base);
+ParseErr stringToUIntMaxW(uintmax_t *x, wchar_t *nptr, uintmax_t min, uintmax_t max, wchar_t **endptr, int base);
+ParseErr stringToDoubleW(double *x, wchar_t *nptr, double min, double max, wchar_t **endptr);
+ParseErr stringToComplexW(complex *z, wchar_t *nptr, complex min, complex max, wchar_t **endptr);
+ParseErr stringToMemoryW(size_t *bytes, wchar_t *nptr, size_t min, size_t max, wchar_t **endptr, int magnitude);
+
+ParseErr stringToTimestamp(int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr);
+size_t stringToTimestampBatch(int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max);
+
+ParseErr stringToDuration(int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr);
+size_t stringToDurationBatch(int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max);
+
+ParseErr stringToBytes(uint8_t *out, size_t cap, const char *s, size_t len, size_t *bytes, size_t *offset,
+                          int separators);
+
+ParseErr stringToValue(void *x, char *nptr, char **endptr, ValueType type, int arg);
+size_t valueSize(ValueType type);
+
 #ifdef MP_PREC
+ParseErr stringToMPZ(mpz_t x, char *nptr, mpz_t min, mpz_t max, char **endptr, int base);
+ParseErr stringToMPQ(mpq_t x, char *nptr, mpq_t min, mpq_t max, char **endptr, int base);
+
 ParseErr stringToMPFR(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd);
+ParseErr stringToMPFRParallel(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base,
+                                 mpfr_rnd_t rnd, unsigned int threads);
+ParseErr stringToMPFRAuto(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd,
+                             mpfr_prec_t cap);
 ParseErr stringToComplexPartMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr,
                                    int base, mpfr_prec_t prec, mpc_rnd_t rnd, ComplexPt *type);
 ParseErr stringToComplexMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr,
                                int base, mpfr_prec_t prec, mpc_rnd_t rnd);
+ParseErr stringToComplexMPCAuto(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base,
+                                   mpfr_prec_t cap, mpc_rnd_t rnd);
 #endif
 
 size_t strncpyGraph(char *dest, const char *src, size_t n);
+size_t strncpyGraphUTF8(char *dest, const char *src, size_t n);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+
+#include <stddef.h>
+
+#include "block.h"
+#include "parser.h"
+
+
+/* Reader stage callback, as for blockFill(). Return non-zero to abort the run */
+typedef BlockReader PipelineReader;
+
+/*
+ * Writer stage callback: called once per block, in input order. The block is
+ * recycled after this returns. Return non-zero to abort the run
+ */
+typedef BlockWriter PipelineWriter;
+
+
+struct PercyPipelineConfig
+{
+    ValueType type;
+    int arg;
+    unsigned int parsers;
+    size_t blockSize;
+    size_t blocks;
+};
+
+
+typedef struct PercyPipelineConfig PipelineConfig;
+typedef struct PercyPipeline Pipeline;
+
+
+Pipeline *pipelineCreate(const PipelineConfig *config);
+void pipelineDestroy(Pipeline *pipeline);
+
+ParseErr pipelineRun(Pipeline *pipeline, PipelineReader reader, void *readerArg,
+                        PipelineWriter writer, void *writerArg);
+
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "parser.h"
+
+
+/*
+ * Each histogram has 2^PROFILE_SUB_BITS buckets for every power of two of
+ * ticks (so any value is within about 3% of its bucket's bounds), exactly
+ * below 2^PROFILE_SUB_BITS, up to 2^PROFILE_MAX_BITS ticks
+ */
+#define PROFILE_SUB_BITS 5
+#define PROFILE_MAX_BITS 40
+#define PROFILE_BUCKETS ((PROFILE_MAX_BITS - PROFILE_SUB_BITS + 1) << PROFILE_SUB_BITS)
+
+
+/* Public parsers timed by the PERCY_PROFILE build */
+enum PercyProfileFunction
+{
+    PROFILE_ULONG,
+    PROFILE_UINTMAX,
+    PROFILE_DOUBLE,
+    PROFILE_DOUBLEL,
+    PROFILE_COMPLEX_PART,
+    PROFILE_COMPLEX_PARTL,
+    PROFILE_COMPLEX,
+    PROFILE_COMPLEXL,
+    PROFILE_COMPLEX_DIALECT,
+    PROFILE_COMPLEX_DIALECT_BATCH,
+    PROFILE_MEMORY,
+    PROFILE_ULONG_UTF8,
+    PROFILE_UINTMAX_UTF8,
+    PROFILE_DOUBLE_UTF8,
+    PROFILE_DOUBLEL_UTF8,
+    PROFILE_ULONG_GROUPED,
+    PROFILE_UINTMAX_GROUPED,
+    PROFILE_DOUBLE_GROUPED,
+    PROFILE_ULONG_U16,
+    PROFILE_UINTMAX_U16,
+    PROFILE_DOUBLE_U16,
+    PROFILE_COMPLEX_U16,
+    PROFILE_MEMORY_U16,
+    PROFILE_ULONG_W,
+    PROFILE_UINTMAX_W,
+    PROFILE_DOUBLE_W,
+    PROFILE_COMPLEX_W,
+    PROFILE_MEMORY_W,
+    PROFILE_TIMESTAMP,
+    PROFILE_TIMESTAMP_BATCH,
+    PROFILE_DURATION,
+    PROFILE_DURATION_BATCH,
+    PROFILE_BYTES,
+    PROFILE_VALUE,
+    PROFILE_QUANTITY,
+    PROFILE_QUANTITYU,
+    PROFILE_LEXED,
+    PROFILE_MPZ,
+    PROFILE_MPQ,
+    PROFILE_MPFR,
+    PROFILE_MPFR_PARALLEL,
+    PROFILE_MPFR_AUTO,
+    PROFILE_COMPLEX_PART_MPC,
+    PROFILE_COMPLEX_MPC,
+    PROFILE_COMPLEX_MPC_AUTO,
+    PROFILE_FUNCTIONS
+};
+
+
+/* Latencies of calls to one function, in ticks (see PercyProfile) */
+struct PercyHistogram
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[PROFILE_BUCKETS];
+};
+
+/*
+ * Latency histograms of every public parser. Ticks are TSC cycles on x86 and
+ * nanoseconds elsewhere; `ticksPerSecond` converts them, or is 0 if unknown
+ */
+struct PercyProfile
+{
+    double ticksPerSecond;
+    struct PercyHistogram functions[PROFILE_FUNCTIONS];
+};
+
+
+typedef enum PercyProfileFunction ProfileFunction;
+typedef struct PercyHistogram Histogram;
+typedef struct PercyProfile Profile;
+
+
+bool profileEnabled(void);
+const char *profileName(ProfileFunction function);
+
+void profileSnapshot(Profile *profile);
+void profileClear(Profile *profile);
+void profileMerge(Profile *into, const Profile *from);
+uint64_t profileQuantile(const Histogram *histogram, double quantile);
+
+ParseErr profileSave(const Profile *profile, const char *path);
+ParseErr profileLoad(Profile *profile, const char *path);
+void profileWrite(FILE *stream, const Profile *profile);
+
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef QUANTITY_H
+#define QUANTITY_H
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+enum PercyQuantityPrefix
+{
+    QUANTITY_SI = 0x01,         /* k, M, G, T, P, E, Z, Y */
+    QUANTITY_SI_SMALL = 0x02,   /* m, u (µ), n, p */
+    QUANTITY_IEC = 0x04,        /* Ki, Mi, Gi, Ti, Pi, Ei, Zi, Yi */
+    QUANTITY_ALL = 0x07
+};
+
+
+/*
+ * A unit recognised by a quantity table. `factor` is the number of base units
+ * it represents (0 is taken as 1), e.g. 8 for "B/s" in a table of bit rates,
+ * and `prefixes` selects which prefixes may precede the symbol
+ */
+struct PercyQuantityUnit
+{
+    const char *symbol;
+    uintmax_t factor;
+    int prefixes;
+};
+
+
+typedef enum PercyQuantityPrefix QuantityPrefix;
+typedef struct PercyQuantityUnit QuantityUnit;
+typedef struct PercyQuantityTable QuantityTable;
+
+
+ParseErr quantityTableCreate(QuantityTable **table, const QuantityUnit *units, size_t n);
+void quantityTableDestroy(QuantityTable *table);
+
+ParseErr stringToQuantity(double *x, char *nptr, double min, double max, char **endptr,
+                             const QuantityTable *table);
+ParseErr stringToQuantityU(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr,
+                              const QuantityTable *table);
+
+
+#endif
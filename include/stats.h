@@ -0,0 +1,85 @@
+#ifndef STATS_H
+#define STATS_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+
+/* First word of a statistics segment, "percysta" on little-endian machines */
+#define STATS_MAGIC UINT64_C(0x6174737963726570)
+#define STATS_VERSION 1
+
+/* Threads with a slot of their own at any one time */
+#define STATS_SLOTS 256
+
+/* Outcomes counted, one per ParseErr */
+#define STATS_OUTCOMES (PARSE_EFORM + 1)
+
+
+/*
+ * Running totals of one thread (or, summed, a whole process) since it started.
+ * Values and bytes are counted by the batch parsers: blockParse() (so
+ * pipelines, streams and followed files), stringToComplexDialectBatch(),
+ * stringToTimestampBatch() and stringToDurationBatch(). Fast and slow path
+ * hits are counted by every parser that has a fast path: the ASCII check of
+ * the UTF-8 parsers, the SIMD timestamp layout check, and the exact (Clinger)
+ * conversions of grouped and lexed numbers
+ */
+struct PercyStatsCounters
+{
+    uint64_t values;
+    uint64_t bytes;
+    uint64_t outcomes[STATS_OUTCOMES];
+    uint64_t fast;
+    uint64_t slow;
+};
+
+/*
+ * One thread's counters, written only by that thread. `sequence` is odd while
+ * they are being written, so a reader retries if it is odd or changes across
+ * its copy (a seqlock). Padded to two cache lines
+ */
+struct PercyStatsSlot
+{
+    uint64_t sequence;
+    struct PercyStatsCounters counters;
+    uint64_t padding[3];
+};
+
+/*
+ * Layout of a shared-memory statistics segment. Slots below `slots` have been
+ * used; the slot of a thread that has exited keeps its totals, and is taken
+ * over (totals and all) by the next new thread
+ */
+struct PercyStatsSegment
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slots;
+    int64_t pid;
+    uint64_t padding[5];
+    struct PercyStatsSlot slot[STATS_SLOTS];
+};
+
+
+typedef struct PercyStatsCounters StatsCounters;
+typedef struct PercyStatsSlot StatsSlot;
+typedef struct PercyStatsSegment StatsSegment;
+
+
+bool statsEnabled(void);
+
+ParseErr statsExport(const char *name);
+void statsFlush(void);
+void statsRemove(void);
+
+ParseErr statsAttach(const StatsSegment **segment, const char *name);
+size_t statsRead(const StatsSegment *segment, StatsCounters *total);
+void statsDetach(const StatsSegment *segment);
+
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+
+#include <stddef.h>
+
+#include "block.h"
+#include "parser.h"
+
+
+enum PercyStreamFormat
+{
+    STREAM_AUTO,
+    STREAM_RAW,
+    STREAM_GZIP,
+    STREAM_ZSTD
+};
+
+
+typedef enum PercyStreamFormat StreamFormat;
+typedef struct PercyStream Stream;
+
+/* Called once per parsed block. Return non-zero to stop parsing */
+typedef BlockWriter StreamWriter;
+
+
+ParseErr streamOpen(Stream **stream, const char *path, StreamFormat format);
+void streamClose(Stream *stream);
+
+StreamFormat streamFormat(const Stream *stream);
+int streamRead(char *buf, size_t size, size_t *length, void *stream);
+
+ParseErr streamParse(Stream *stream, ValueType type, int arg, size_t blockSize, StreamWriter writer, void *writerArg);
+
+
+#endif
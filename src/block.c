@@ -0,0 +1,172 @@
+#include "unprofiled.h"
+#include "block.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "parser.h"
+#include "tally.h"
+
+
+/*
+ * Allocate a block holding up to `size` bytes of text. Enough token, value and
+ * error slots are allocated for the worst case of single-character tokens
+ */
+Block *blockCreate(size_t size, ValueType type)
+{
+    Block *block;
+    size_t maxTokens = size / 2 + 1;
+    size_t width = valueSize(type);
+
+    if (size == 0 || width == 0)
+        return NULL;
+
+    block = malloc(sizeof(*block));
+
+    if (!block)
+        return NULL;
+
+    block->sequence = 0;
+    block->length = 0;
+    block->size = size;
+    block->count = 0;
+    block->type = type;
+
+    /* One extra byte so that a final token can always be NUL-terminated */
+    block->data = malloc(size + 1);
+    block->tokens = malloc(maxTokens * sizeof(*block->tokens));
+    block->values = malloc(maxTokens * width);
+    block->errors = malloc(maxTokens * sizeof(*block->errors));
+
+    if (!block->data || !block->tokens || !block->values || !block->errors)
+    {
+        blockDestroy(block);
+        return NULL;
+    }
+
+    return block;
+}
+
+
+/* Free a block and its buffers */
+void blockDestroy(Block *block)
+{
+    if (!block)
+        return;
+
+    free(block->data);
+    free(block->tokens);
+    free(block->values);
+    free(block->errors);
+    free(block);
+}
+
+
+/*
+ * Append input to the block (which may already start with bytes carried over
+ * from the previous one) and tokenise it, reading until there is at least one
+ * whole token or the input ends. `*final` is set at end of input, and `*carry`
+ * to the length of any trailing partial token, as for blockTokenise()
+ *
+ * Returns PARSE_EERR if the reader fails, or PARSE_EFORM if a token fills the
+ * entire block
+ */
+ParseErr blockFill(Block *block, BlockReader reader, void *arg, bool *final, size_t *carry)
+{
+    *final = false;
+
+    do
+    {
+        size_t length;
+
+        if (block->length == block->size)
+            return PARSE_EFORM;
+
+        if (reader(block->data + block->length, block->size - block->length, &length, arg))
+            return PARSE_EERR;
+
+        *final = (length == 0);
+        block->length += length;
+        *carry = blockTokenise(block, *final);
+    } while (block->count == 0 && !*final);
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Split the block's text into whitespace-separated tokens, NUL-terminating
+ * each in place
+ *
+ * Unless `final` is set, a token running up to the end of the text may
+ * continue in the next block. It is not tokenised, and its length is returned
+ * so the caller can carry those bytes (still at the end of `data`) over
+ */
+size_t blockTokenise(Block *block, bool final)
+{
+    char *c = block->data;
+    char *end = block->data + block->length;
+
+    block->count = 0;
+
+    while (c < end)
+    {
+        char *start;
+
+        /* Get pointer to start of token */
+        while (c < end && isspace((unsigned char) *c))
+            ++c;
+
+        if (c == end)
+            break;
+
+        start = c;
+
+        while (c < end && !isspace((unsigned char) *c))
+            ++c;
+
+        if (c == end && !final)
+            return (size_t) (end - start);
+
+        *c++ = '\0';
+        block->tokens[block->count++] = start;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Parse every token in the block into its value array, recording the result
+ * of each conversion. Return the number of tokens that failed
+ */
+size_t blockParse(Block *block, int arg)
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < block->count; ++i)
+    {
+        char *endptr;
+
+        block->errors[i] = stringToValue(blockValue(block, i), block->tokens[i], &endptr, block->type, arg);
+
+        if (block->errors[i] != PARSE_SUCCESS)
+            ++failed;
+
+        STATS_VALUE(block->errors[i], endptr - block->tokens[i]);
+    }
+
+    STATS_PUBLISH();
+
+    return failed;
+}
+
+
+/* Pointer to the value parsed from the i'th token */
+void *blockValue(const Block *block, size_t i)
+{
+    return (char *) block->values + i * valueSize(block->type);
+}
@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unprofiled.h"
+#include "cache.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "block.h"
+#include "parser.h"
+#include "stream.h"
+
+
+/* Appended to the source path for the default cache location */
+static const char CACHE_SUFFIX[] = ".percy";
+
+static const char CACHE_MAGIC[8] = {'P', 'R', 'C', 'Y', 'C', 'O', 'L', '1'};
+
+/* Alignment of the value array within the cache file, enough for any type */
+#define CACHE_ALIGN 64
+
+
+/*
+ * Cache file header. The cache is only ever read back on the machine that
+ * wrote it, so fields are in native layout; `valueSize` guards against ABI
+ * differences in the value types
+ */
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t type;
+    int32_t arg;
+
+    /* Source file identity */
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t pathLength;
+
+    uint64_t count;
+    uint64_t valueSize;
+    uint64_t valuesOffset;
+    uint64_t errorsOffset;
+    uint64_t length;
+};
+
+/* Growing column built up by the stream writer on a cache miss */
+struct ColumnBuilder
+{
+    size_t width;
+    size_t count;
+    size_t capacity;
+    char *values;
+    unsigned char *errors;
+};
+
+
+static char *cacheDefaultPath(const char *path);
+static bool cacheMap(Column *column, const char *cachePath, const struct CacheHeader *key, const char *path);
+static void cacheWrite(const char *cachePath, struct CacheHeader *key, const char *path,
+                          const struct ColumnBuilder *builder);
+static void cacheKey(struct CacheHeader *key, const struct stat *st, const char *path, ValueType type, int arg);
+
+static int columnAppend(const Block *block, void *arg);
+static size_t bitmapSize(size_t count);
+
+
+/*
+ * Load a column of whitespace-separated values from a file (plain or
+ * compressed, as for streamOpen())
+ *
+ * If a cache file exists for the same path, size, modification time, type and
+ * `arg`, it is mapped into memory instead of parsing the file again. Otherwise
+ * the file is parsed and the cache (re)written. `cachePath` may be NULL to use
+ * the source path with ".percy" appended. A cache that cannot be written is not
+ * an error - the column is simply not cached
+ *
+ * The column must be released with columnFree()
+ */
+ParseErr columnLoad(Column *column, const char *path, ValueType type, int arg, const char *cachePath)
+{
+    struct CacheHeader key, after;
+    struct ColumnBuilder builder = {0};
+    struct stat st;
+    char *defaultPath = NULL;
+    Stream *stream;
+    ParseErr parseError;
+
+    memset(column, 0, sizeof(*column));
+    column->type = type;
+
+    builder.width = valueSize(type);
+
+    if (builder.width == 0 || stat(path, &st))
+        return PARSE_EERR;
+
+    if (!cachePath)
+    {
+        defaultPath = cacheDefaultPath(path);
+
+        if (!defaultPath)
+            return PARSE_EERR;
+
+        cachePath = defaultPath;
+    }
+
+    cacheKey(&key, &st, path, type, arg);
+
+    if (cacheMap(column, cachePath, &key, path))
+    {
+        free(defaultPath);
+        return PARSE_SUCCESS;
+    }
+
+    parseError = streamOpen(&stream, path, STREAM_AUTO);
+
+    if (parseError != PARSE_SUCCESS)
+    {
+        free(defaultPath);
+        return parseError;
+    }
+
+    parseError = streamParse(stream, type, arg, 0, columnAppend, &builder);
+    streamClose(stream);
+
+    if (parseError != PARSE_SUCCESS)
+    {
+        free(builder.values);
+        free(builder.errors);
+        free(defaultPath);
+        return parseError;
+    }
+
+    /* Only cache the result if the file did not change while being parsed */
+    if (!stat(path, &st))
+    {
+        cacheKey(&after, &st, path, type, arg);
+
+        if (after.size == key.size && after.mtimeSec == key.mtimeSec && after.mtimeNsec == key.mtimeNsec)
+            cacheWrite(cachePath, &key, path, &builder);
+    }
+
+    column->count = builder.count;
+    column->values = column->ownedValues = builder.values;
+    column->errors = column->ownedErrors = builder.errors;
+
+    free(defaultPath);
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Unmap or free a column's data */
+void columnFree(Column *column)
+{
+    if (column->map)
+        munmap(column->map, column->mapLength);
+
+    free(column->ownedValues);
+    free(column->ownedErrors);
+    memset(column, 0, sizeof(*column));
+}
+
+
+/* Pointer to the i'th value of a column */
+const void *columnValue(const Column *column, size_t i)
+{
+    return (const char *) column->values + i * valueSize(column->type);
+}
+
+
+/* Whether the i'th token of a column failed to parse */
+bool columnError(const Column *column, size_t i)
+{
+    return (column->errors[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1;
+}
+
+
+/* Source path with the cache suffix appended */
+static char *cacheDefaultPath(const char *path)
+{
+    char *cachePath = malloc(strlen(path) + sizeof(CACHE_SUFFIX));
+
+    if (!cachePath)
+        return NULL;
+
+    strcpy(cachePath, path);
+    strcat(cachePath, CACHE_SUFFIX);
+
+    return cachePath;
+}
+
+
+/* Map an existing cache file if it matches the key, filling in the column */
+static bool cacheMap(Column *column, const char *cachePath, const struct CacheHeader *key, const char *path)
+{
+    const struct CacheHeader *header;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(cachePath, O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) || (uint64_t) st.st_size < sizeof(*header))
+    {
+        close(fd);
+        return false;
+    }
+
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    header = map;
+
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC))
+        || header->type != key->type || header->arg != key->arg
+        || header->size != key->size || header->mtimeSec != key->mtimeSec || header->mtimeNsec != key->mtimeNsec
+        || header->pathLength != key->pathLength || header->valueSize != key->valueSize
+        || header->length != (uint64_t) st.st_size
+        || sizeof(*header) + header->pathLength > header->valuesOffset
+        || header->count > SIZE_MAX / key->valueSize
+        || header->valuesOffset + header->count * header->valueSize > header->errorsOffset
+        || header->errorsOffset + bitmapSize((size_t) header->count) > header->length
+        || memcmp((const char *) map + sizeof(*header), path, (size_t) key->pathLength))
+    {
+        munmap(map, (size_t) st.st_size);
+        return false;
+    }
+
+    column->count = (size_t) header->count;
+    column->values = (const char *) map + header->valuesOffset;
+    column->errors = (const unsigned char *) map + header->errorsOffset;
+    column->map = map;
+    column->mapLength = (size_t) st.st_size;
+
+    return true;
+}
+
+
+/*
+ * Write the header, source path, values and error bitmap to a new cache file,
+ * renaming it into place so readers never see a partial cache
+ */
+static void cacheWrite(const char *cachePath, struct CacheHeader *key, const char *path,
+                          const struct ColumnBuilder *builder)
+{
+    const char TMP_SUFFIX[] = ".tmp";
+    const char PADDING[CACHE_ALIGN] = {0};
+
+    size_t valuesLength = builder->count * builder->width;
+    size_t errorsLength = bitmapSize(builder->count);
+    size_t pad;
+    char *tmpPath;
+    FILE *file;
+    bool ok;
+
+    key->count = builder->count;
+    key->valuesOffset = (sizeof(*key) + key->pathLength + CACHE_ALIGN - 1) / CACHE_ALIGN * CACHE_ALIGN;
+    key->errorsOffset = key->valuesOffset + valuesLength;
+    key->length = key->errorsOffset + errorsLength;
+
+    pad = (size_t) (key->valuesOffset - sizeof(*key) - key->pathLength);
+
+    tmpPath = malloc(strlen(cachePath) + sizeof(TMP_SUFFIX));
+
+    if (!tmpPath)
+        return;
+
+    strcpy(tmpPath, cachePath);
+    strcat(tmpPath, TMP_SUFFIX);
+
+    file = fopen(tmpPath, "wb");
+
+    if (!file)
+    {
+        free(tmpPath);
+        return;
+    }
+
+    ok = fwrite(key, sizeof(*key), 1, file) == 1
+         && fwrite(path, 1, (size_t) key->pathLength, file) == key->pathLength
+         && fwrite(PADDING, 1, pad, file) == pad
+         && fwrite(builder->values, 1, valuesLength, file) == valuesLength
+         && fwrite(builder->errors, 1, errorsLength, file) == errorsLength;
+
+    ok = !fclose(file) && ok && !rename(tmpPath, cachePath);
+
+    if (!ok)
+        remove(tmpPath);
+
+    free(tmpPath);
+}
+
+
+/* Fill in the identifying fields of a cache header */
+static void cacheKey(struct CacheHeader *key, const struct stat *st, const char *path, ValueType type, int arg)
+{
+    memset(key, 0, sizeof(*key));
+    memcpy(key->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+    key->type = (uint32_t) type;
+    key->arg = arg;
+    key->size = (uint64_t) st->st_size;
+    key->mtimeSec = (int64_t) st->st_mtim.tv_sec;
+    key->mtimeNsec = (int64_t) st->st_mtim.tv_nsec;
+    key->pathLength = strlen(path);
+    key->valueSize = valueSize(type);
+}
+
+
+/* Stream writer: append a block's values and errors to the column */
+static int columnAppend(const Block *block, void *arg)
+{
+    struct ColumnBuilder *builder = arg;
+    size_t count = builder->count + block->count;
+
+    if (count > builder->capacity)
+    {
+        size_t capacity = builder->capacity ? builder->capacity : 1024;
+        char *values;
+        unsigned char *errors;
+
+        while (capacity < count)
+            capacity *= 2;
+
+        values = realloc(builder->values, capacity * builder->width);
+
+        if (!values)
+            return 1;
+
+        builder->values = values;
+
+        errors = realloc(builder->errors, bitmapSize(capacity));
+
+        if (!errors)
+            return 1;
+
+        builder->errors = errors;
+        memset(builder->errors + bitmapSize(builder->capacity), 0,
+               bitmapSize(capacity) - bitmapSize(builder->capacity));
+        builder->capacity = capacity;
+    }
+
+    memcpy(builder->values + builder->count * builder->width, block->values, block->count * builder->width);
+
+    for (size_t i = 0; i < block->count; ++i)
+    {
+        size_t j = builder->count + i;
+
+        if (block->errors[i] != PARSE_SUCCESS)
+            builder->errors[j / CHAR_BIT] |= (unsigned char) (1u << (j % CHAR_BIT));
+    }
+
+    builder->count = count;
+
+    return 0;
+}
+
+
+/* Bytes needed for a bitmap of `count` bits */
+static size_t bitmapSize(size_t count)
+{
+    return (count + CHAR_BIT - 1) / CHAR_BIT;
+}
@@ -0,0 +1,215 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tally.h"
+
+
+struct DurationUnit
+{
+    const char *symbol;
+    size_t length;
+    uint64_t ns;
+};
+
+
+/*
+ * Recognised duration units. Matched in order, so any symbol that is a prefix
+ * of another ("m" of "ms") must come after it
+ */
+static const struct DurationUnit DURATION_UNITS[] =
+{
+    {"ns", 2, 1},
+    {"us", 2, 1000},
+    {"\xC2\xB5s", 3, 1000},         /* Micro sign, U+00B5 */
+    {"\xCE\xBCs", 3, 1000},         /* Greek small letter mu, U+03BC */
+    {"ms", 2, 1000000},
+    {"s", 1, 1000000000},
+    {"m", 1, 60000000000},
+    {"h", 1, 3600000000000}
+};
+
+
+static const struct DurationUnit *parseDurationUnit(const char *str);
+static ParseErr parseDurationTerm(uint64_t *ns, char *str, char **endptr, uint64_t limit);
+
+
+/*
+ * Parse a duration into a signed number of nanoseconds
+ *
+ * A duration is an optional sign followed by one or more terms, each a decimal
+ * number with a unit suffix, e.g. "250ms", "1.5s", "-1h30m" or "2h45m30.5s".
+ * Units are ns, us (or µs), ms, s, m and h. A lone "0" needs no unit
+ *
+ * Each term is scaled exactly in integer arithmetic, truncating anything
+ * below a nanosecond. Durations that do not fit in `int64_t` nanoseconds
+ * (about 292 years) return PARSE_ERANGE
+ */
+ParseErr stringToDuration(int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr)
+{
+    uint64_t total = 0, limit = INT64_MAX;
+    bool negative = false;
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    /* Get pointer to start of duration */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    if (**endptr == '+' || **endptr == '-')
+    {
+        negative = (**endptr == '-');
+        limit += negative;
+        ++(*endptr);
+    }
+
+    if (**endptr == '0' && !isdigit((*endptr)[1]) && (*endptr)[1] != '.' && !parseDurationUnit(*endptr + 1))
+    {
+        ++(*endptr);
+    }
+    else
+    {
+        uint64_t term;
+
+        parseError = parseDurationTerm(&total, *endptr, endptr, limit);
+
+        if (parseError != PARSE_SUCCESS)
+            return parseError;
+
+        /* Further terms, stopping at the first that is not one */
+        while (**endptr != '\0')
+        {
+            char *next;
+
+            parseError = parseDurationTerm(&term, *endptr, &next, limit - total);
+
+            if (parseError == PARSE_EFORM)
+                break;
+            else if (parseError != PARSE_SUCCESS)
+                return parseError;
+
+            total += term;
+            *endptr = next;
+        }
+    }
+
+    if (negative)
+        *ns = (total == (uint64_t) INT64_MAX + 1) ? INT64_MIN : -(int64_t) total;
+    else
+        *ns = (int64_t) total;
+
+    /* Range checks */
+    if (*ns < min)
+        return PARSE_EMIN;
+    else if (*ns > max)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Parse `n` duration strings with stringToDuration(), storing the result of
+ * each in `errors` (if not NULL). Return the number that failed
+ */
+size_t stringToDurationBatch(int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max)
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        char *endptr;
+        ParseErr parseError = stringToDuration(&ns[i], nptrs[i], min, max, &endptr);
+
+        if (errors)
+            errors[i] = parseError;
+
+        if (parseError != PARSE_SUCCESS)
+            ++failed;
+
+        STATS_VALUE(parseError, endptr - nptrs[i]);
+    }
+
+    STATS_PUBLISH();
+
+    return failed;
+}
+
+
+/* Unit whose symbol starts `str`, or NULL if there is none */
+static const struct DurationUnit *parseDurationUnit(const char *str)
+{
+    for (size_t i = 0; i < sizeof(DURATION_UNITS) / sizeof(*DURATION_UNITS); ++i)
+    {
+        if (!strncmp(str, DURATION_UNITS[i].symbol, DURATION_UNITS[i].length))
+            return &DURATION_UNITS[i];
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Parse one "<number><unit>" term into nanoseconds, failing with PARSE_ERANGE
+ * if it exceeds `limit`. PARSE_EFORM leaves `endptr` at `str`
+ */
+static ParseErr parseDurationTerm(uint64_t *ns, char *str, char **endptr, uint64_t limit)
+{
+    const struct DurationUnit *unit;
+    const char *integer = str, *fraction, *end;
+    uint64_t whole = 0, part = 0;
+    size_t digits;
+    bool overflow = false;
+
+    *endptr = str;
+
+    for (; isdigit(*str); ++str)
+    {
+        if (whole > (UINT64_MAX - 9) / 10)
+            overflow = true;
+        else
+            whole = whole * 10 + (uint64_t) (*str - '0');
+    }
+
+    digits = (size_t) (str - integer);
+    fraction = end = str;
+
+    if (*str == '.')
+    {
+        fraction = ++str;
+
+        while (isdigit(*str))
+            ++str;
+
+        end = str;
+        digits += (size_t) (end - fraction);
+    }
+
+    /* Need at least one digit, and a unit */
+    unit = parseDurationUnit(str);
+
+    if (digits == 0 || !unit)
+        return PARSE_EFORM;
+
+    /*
+     * Exact floor of 0.d1d2...dk * unit, by Horner's rule from the last digit:
+     * floor((d + floor(x)) / 10) == floor((d + x) / 10) for integer d
+     */
+    for (const char *c = end; c > fraction; --c)
+        part = ((uint64_t) (c[-1] - '0') * unit->ns + part) / 10;
+
+    if (overflow || part > limit || whole > (limit - part) / unit->ns)
+        return PARSE_ERANGE;
+
+    *ns = whole * unit->ns + part;
+    *endptr = str + unit->length;
+
+    return PARSE_SUCCESS;
+}
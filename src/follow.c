@@ -0,0 +1,477 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unprofiled.h"
+#include "follow.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "block.h"
+#include "parser.h"
+
+
+/* Default bytes of text per block */
+#define FOLLOW_BLOCK_SIZE 16384
+
+/* Leading bytes of the file kept to recognise it after it is truncated and rewritten */
+#define FOLLOW_MARK_SIZE 64
+
+/* First line of a saved state file */
+static const char FOLLOW_STATE_MAGIC[] = "percy-follow 2";
+
+
+struct PercyFollow
+{
+    char *path;
+    int fd;
+
+    /* Identity of the file being followed, to detect rotation */
+    dev_t dev;
+    ino_t ino;
+
+    /* Bytes of the file read so far, including any carried partial token */
+    uint64_t offset;
+
+    /* Trailing token that had no whitespace after it at the last poll */
+    char *carry;
+    size_t carryLength;
+
+    /* Whether the rest of a token too large for a block is being skipped */
+    bool skipping;
+
+    /* First bytes of the file as read, compared at each poll to detect truncation */
+    char mark[FOLLOW_MARK_SIZE];
+    size_t markLength;
+
+    Block *block;
+    int arg;
+    uint64_t sequence;
+};
+
+
+static ParseErr followAttach(Follow *follow);
+static bool followTruncated(const Follow *follow, const struct stat *st);
+static void followReset(Follow *follow);
+static ParseErr followRead(Follow *follow, BlockWriter writer, void *writerArg);
+static ParseErr followFlush(Follow *follow, BlockWriter writer, void *writerArg);
+static ParseErr followWrite(Follow *follow, BlockWriter writer, void *writerArg);
+
+
+/*
+ * Start following a file of whitespace-separated values from its beginning.
+ * Use followLoad() to resume from a previous run instead. A `blockSize` of 0
+ * selects the default; no token may be longer than a block
+ *
+ * Returns PARSE_EERR if the file cannot be opened or memory allocated
+ */
+ParseErr followOpen(Follow **follow, const char *path, ValueType type, int arg, size_t blockSize)
+{
+    Follow *f;
+    ParseErr parseError;
+
+    *follow = NULL;
+
+    if (blockSize == 0)
+        blockSize = FOLLOW_BLOCK_SIZE;
+
+    f = calloc(1, sizeof(*f));
+
+    if (!f)
+        return PARSE_EERR;
+
+    f->fd = -1;
+    f->arg = arg;
+    f->path = malloc(strlen(path) + 1);
+    f->carry = malloc(blockSize);
+    f->block = blockCreate(blockSize, type);
+
+    if (!f->path || !f->carry || !f->block)
+    {
+        followClose(f);
+        return PARSE_EERR;
+    }
+
+    strcpy(f->path, path);
+
+    parseError = followAttach(f);
+
+    if (parseError != PARSE_SUCCESS)
+    {
+        followClose(f);
+        return parseError;
+    }
+
+    *follow = f;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Close the followed file and free the handle */
+void followClose(Follow *follow)
+{
+    if (!follow)
+        return;
+
+    if (follow->fd >= 0)
+        close(follow->fd);
+
+    blockDestroy(follow->block);
+    free(follow->carry);
+    free(follow->path);
+    free(follow);
+}
+
+
+/*
+ * Parse whatever has been appended to the file since the last poll, passing
+ * each block of values to `writer`. Only newly appended bytes are read. A
+ * token at the very end of the file is held back until whitespace follows it,
+ * in case it is still being written
+ *
+ * If the file has shrunk, or its first bytes (up to FOLLOW_MARK_SIZE) differ
+ * from those read before, it is taken to have been truncated and is re-read
+ * from the start. A file truncated and rewritten with the same first bytes,
+ * past the old offset, between two polls cannot be told apart from one that
+ * was appended to. If the path now names a different file (by device and
+ * inode), the old file is read to its end, its last token is parsed, and the
+ * new file is followed from its start
+ *
+ * Returns PARSE_EERR on a read error or if the writer stops early, and
+ * PARSE_EFORM if a single token is larger than a block. Such a token is only
+ * reported once: the rest of it is skipped, and the next poll goes on after it
+ */
+ParseErr followPoll(Follow *follow, BlockWriter writer, void *writerArg)
+{
+    struct stat st;
+    ParseErr parseError;
+
+    if (fstat(follow->fd, &st))
+        return PARSE_EERR;
+
+    /* Truncated in place, even if it has since grown past the offset (copytruncate) */
+    if (followTruncated(follow, &st))
+        followReset(follow);
+
+    parseError = followRead(follow, writer, writerArg);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    /* A missing path is most likely mid-rotation, so try again next poll */
+    if (stat(follow->path, &st) || (st.st_dev == follow->dev && st.st_ino == follow->ino))
+        return PARSE_SUCCESS;
+
+    /* Rotated: the old file has been drained, so its last token is complete */
+    parseError = followFlush(follow, writer, writerArg);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    close(follow->fd);
+    follow->fd = -1;
+
+    parseError = followAttach(follow);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    return followRead(follow, writer, writerArg);
+}
+
+
+/* Bytes of the current file consumed so far */
+uint64_t followOffset(const Follow *follow)
+{
+    return follow->offset;
+}
+
+
+/*
+ * Save the file identity, offset, first bytes and any partial trailing token,
+ * so a later run can resume with followLoad(). The state file is replaced
+ * atomically
+ */
+ParseErr followSave(const Follow *follow, const char *statePath)
+{
+    const char TMP_SUFFIX[] = ".tmp";
+
+    char *tmpPath;
+    FILE *file;
+    bool ok;
+
+    tmpPath = malloc(strlen(statePath) + sizeof(TMP_SUFFIX));
+
+    if (!tmpPath)
+        return PARSE_EERR;
+
+    strcpy(tmpPath, statePath);
+    strcat(tmpPath, TMP_SUFFIX);
+
+    file = fopen(tmpPath, "wb");
+
+    if (!file)
+    {
+        free(tmpPath);
+        return PARSE_EERR;
+    }
+
+    ok = fprintf(file, "%s\n%ju %ju %" PRIu64 " %zu %zu\n", FOLLOW_STATE_MAGIC, (uintmax_t) follow->dev,
+                 (uintmax_t) follow->ino, follow->offset, follow->carryLength, follow->markLength) > 0
+         && fwrite(follow->carry, 1, follow->carryLength, file) == follow->carryLength
+         && fwrite(follow->mark, 1, follow->markLength, file) == follow->markLength;
+
+    ok = !fclose(file) && ok && !rename(tmpPath, statePath);
+
+    if (!ok)
+        remove(tmpPath);
+
+    free(tmpPath);
+
+    return ok ? PARSE_SUCCESS : PARSE_EERR;
+}
+
+
+/*
+ * Resume from state saved by followSave(). The state is only applied if it
+ * refers to the same file (device and inode) and the file has not been
+ * truncated since, as in followPoll(); otherwise the file is followed from
+ * its start, as after followOpen()
+ *
+ * Returns PARSE_EERR if the state file cannot be read, and PARSE_EFORM if it
+ * is malformed
+ */
+ParseErr followLoad(Follow *follow, const char *statePath)
+{
+    char magic[sizeof(FOLLOW_STATE_MAGIC) + 1];
+    uintmax_t dev, ino;
+    uint64_t offset;
+    size_t carryLength, markLength;
+    struct stat st;
+    FILE *file;
+
+    file = fopen(statePath, "rb");
+
+    if (!file)
+        return PARSE_EERR;
+
+    if (!fgets(magic, sizeof(magic), file))
+    {
+        fclose(file);
+        return PARSE_EFORM;
+    }
+
+    magic[strcspn(magic, "\n")] = '\0';
+
+    if (strcmp(magic, FOLLOW_STATE_MAGIC)
+        || fscanf(file, "%ju %ju %" SCNu64 " %zu %zu", &dev, &ino, &offset, &carryLength, &markLength) != 5
+        || fgetc(file) != '\n' || carryLength > follow->block->size || markLength > FOLLOW_MARK_SIZE)
+    {
+        fclose(file);
+        return PARSE_EFORM;
+    }
+
+    if (fread(follow->carry, 1, carryLength, file) != carryLength
+        || fread(follow->mark, 1, markLength, file) != markLength)
+    {
+        fclose(file);
+        return PARSE_EFORM;
+    }
+
+    fclose(file);
+
+    if (fstat(follow->fd, &st))
+        return PARSE_EERR;
+
+    follow->offset = offset;
+    follow->carryLength = carryLength;
+    follow->markLength = markLength;
+
+    if ((uintmax_t) follow->dev != dev || (uintmax_t) follow->ino != ino || followTruncated(follow, &st))
+        followReset(follow);
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Open the file at the followed path and start from its beginning */
+static ParseErr followAttach(Follow *follow)
+{
+    struct stat st;
+
+    follow->fd = open(follow->path, O_RDONLY);
+
+    if (follow->fd < 0)
+        return PARSE_EERR;
+
+    if (fstat(follow->fd, &st))
+    {
+        close(follow->fd);
+        follow->fd = -1;
+        return PARSE_EERR;
+    }
+
+    follow->dev = st.st_dev;
+    follow->ino = st.st_ino;
+    followReset(follow);
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Go back to the start of the file, forgetting what was read of it */
+static void followReset(Follow *follow)
+{
+    follow->offset = 0;
+    follow->carryLength = 0;
+    follow->markLength = 0;
+    follow->skipping = false;
+}
+
+
+/*
+ * Whether the file has been truncated since it was read up to the offset:
+ * it is now shorter, or its first bytes are no longer those read
+ */
+static bool followTruncated(const Follow *follow, const struct stat *st)
+{
+    char mark[FOLLOW_MARK_SIZE];
+    ssize_t length;
+
+    if ((uint64_t) st->st_size < follow->offset)
+        return true;
+
+    if (follow->markLength == 0)
+        return false;
+
+    do
+    {
+        length = pread(follow->fd, mark, follow->markLength, 0);
+    } while (length < 0 && errno == EINTR);
+
+    /* A read error is left for the next read to report */
+    if (length < 0)
+        return false;
+
+    return (size_t) length != follow->markLength || memcmp(mark, follow->mark, follow->markLength);
+}
+
+
+/*
+ * Read and parse everything from the current offset to the end of the file,
+ * keeping the first bytes of the file from the very blocks they were parsed
+ * from
+ */
+static ParseErr followRead(Follow *follow, BlockWriter writer, void *writerArg)
+{
+    Block *block = follow->block;
+
+    for (;;)
+    {
+        ssize_t length;
+        ParseErr parseError;
+        char *fresh;
+
+        memcpy(block->data, follow->carry, follow->carryLength);
+        block->length = follow->carryLength;
+
+        /* A token filling a whole block is reported once, then skipped to its end */
+        if (block->length == block->size)
+        {
+            follow->carryLength = 0;
+            follow->skipping = true;
+            return PARSE_EFORM;
+        }
+
+        fresh = block->data + block->length;
+
+        do
+        {
+            length = pread(follow->fd, fresh, block->size - block->length, (off_t) follow->offset);
+        } while (length < 0 && errno == EINTR);
+
+        if (length < 0)
+            return PARSE_EERR;
+        else if (length == 0)
+            return PARSE_SUCCESS;
+
+        if (follow->offset < FOLLOW_MARK_SIZE && follow->offset == follow->markLength)
+        {
+            size_t markLength = FOLLOW_MARK_SIZE - follow->markLength;
+
+            if (markLength > (size_t) length)
+                markLength = (size_t) length;
+
+            memcpy(follow->mark + follow->markLength, fresh, markLength);
+            follow->markLength += markLength;
+        }
+
+        follow->offset += (uint64_t) length;
+        block->length += (size_t) length;
+
+        if (follow->skipping)
+        {
+            char *end = block->data + block->length, *c = fresh;
+
+            while (c < end && !isspace((unsigned char) *c))
+                ++c;
+
+            if (c == end)
+                continue;
+
+            follow->skipping = false;
+            memmove(block->data, c, (size_t) (end - c));
+            block->length = (size_t) (end - c);
+        }
+
+        /* The file may still be growing, so the last token is never final */
+        follow->carryLength = blockTokenise(block, false);
+        memcpy(follow->carry, block->data + block->length - follow->carryLength, follow->carryLength);
+
+        parseError = followWrite(follow, writer, writerArg);
+
+        if (parseError != PARSE_SUCCESS)
+            return parseError;
+    }
+}
+
+
+/* Parse any held-back token as complete */
+static ParseErr followFlush(Follow *follow, BlockWriter writer, void *writerArg)
+{
+    Block *block = follow->block;
+
+    memcpy(block->data, follow->carry, follow->carryLength);
+    block->length = follow->carryLength;
+    follow->carryLength = 0;
+
+    blockTokenise(block, true);
+
+    return followWrite(follow, writer, writerArg);
+}
+
+
+/* Parse the tokens in the block and hand them to the writer */
+static ParseErr followWrite(Follow *follow, BlockWriter writer, void *writerArg)
+{
+    Block *block = follow->block;
+
+    if (block->count == 0)
+        return PARSE_SUCCESS;
+
+    blockParse(block, follow->arg);
+    block->sequence = follow->sequence++;
+
+    return writer(block, writerArg) ? PARSE_EERR : PARSE_SUCCESS;
+}
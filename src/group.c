@@ -0,0 +1,507 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tally.h"
+
+
+/* Significant digits always kept exactly in a uint64_t (a 20th may fit) */
+#define GROUP_DIGITS_MAX 19
+
+/* Largest integer below which every integer is exact as a double */
+#define CLINGER_MANTISSA_MAX (UINT64_C(1) << 53)
+
+/* Largest power of ten exact as a double */
+#define CLINGER_EXPONENT_MAX 22
+
+/* Numbers up to this length are copied to the stack for strtod() */
+#define GROUP_BUFFER_SIZE 128
+
+/* Size of a memory page, within which a 16-byte load can never fault */
+#define PAGE_SIZE 4096
+
+
+/* Digits of a grouped integer part, as scanned */
+struct GroupedDigits
+{
+    uint64_t value;
+    size_t significant;     /* Digits after any leading zeros */
+    size_t dropped;         /* Significant digits that did not fit */
+    bool truncated;         /* Whether any dropped digit was non-zero */
+};
+
+
+static ParseErr scanGroupedDigits(struct GroupedDigits *digits, char *c, char **endptr, char separator,
+                                     bool strict);
+static bool scanGroupedBlock(struct GroupedDigits *digits, const char *c, const char **endptr, char separator,
+                                bool strict);
+static bool addDigit(struct GroupedDigits *digits, int digit);
+static bool isGroupSeparator(const char *c, char separator);
+static bool isSeparatorValid(char separator);
+
+static ParseErr parseGroupedInteger(uintmax_t *x, char *nptr, uintmax_t limit, char **endptr, char separator,
+                                       bool strict, bool *negative);
+static double strtodGrouped(const char *start, const char *end, char separator);
+
+static const double POWERS_OF_TEN[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/*
+ * Parse a decimal unsigned long with digit-group separators, e.g. "1_000_000"
+ * or "1,234,567" (with `separator` '_' or ','), skipping them as the digits
+ * are read rather than copying the number first
+ *
+ * A separator only counts as one between two digits; anywhere else the number
+ * ends before it. A `separator` that could be part of the number itself ('\0',
+ * a digit, '.', '+' or '-') returns PARSE_EFORM. If `strict`, groups must be of thousands: the first of one
+ * to three digits and the rest of exactly three, otherwise PARSE_EFORM is
+ * returned with `endptr` at the misplaced separator (or the end of the digits)
+ *
+ * Short numbers are classified 16 characters at a time with SSE2, masking the
+ * separators out of the digits
+ */
+ParseErr stringToULongGrouped(unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr,
+                                 char separator, bool strict)
+{
+    uintmax_t value;
+    bool negative;
+    ParseErr parseError = parseGroupedInteger(&value, nptr, ULONG_MAX, endptr, separator, strict, &negative);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    *x = (unsigned long) value;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+    else if (negative && *x != 0)
+        return PARSE_EMIN;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/* As stringToULongGrouped(), for uintmax_t */
+ParseErr stringToUIntMaxGrouped(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr,
+                                   char separator, bool strict)
+{
+    bool negative;
+    ParseErr parseError = parseGroupedInteger(x, nptr, UINTMAX_MAX, endptr, separator, strict, &negative);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+    else if (negative && *x != 0)
+        return PARSE_EMIN;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Parse a decimal double with digit-group separators in its integer part, as
+ * for stringToULongGrouped(), e.g. "1,234.5" or "-1_000.25e3"
+ *
+ * Numbers with at most 15 or so significant digits and a small exponent are
+ * converted directly with Clinger's fast path (an exact integer multiplied or
+ * divided by an exact power of ten, so correctly rounded). Others are passed
+ * to strtod() with the separators removed
+ */
+ParseErr stringToDoubleGrouped(double *x, char *nptr, double min, double max, char **endptr,
+                                  char separator, bool strict)
+{
+    struct GroupedDigits digits;
+    char *start, *c;
+    long exponent = 0;
+    bool negative;
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    if (!isSeparatorValid(separator))
+        return PARSE_EFORM;
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    start = c = *endptr;
+    negative = (*c == '-');
+
+    if (*c == '+' || *c == '-')
+        ++c;
+
+    /* Infinity, NaN and hexadecimal have no grouping */
+    if (!isdigit(*c) && *c != '.')
+        return stringToDouble(x, nptr, min, max, endptr);
+
+    if (c[0] == '0' && (c[1] == 'x' || c[1] == 'X'))
+        return stringToDouble(x, nptr, min, max, endptr);
+
+    parseError = scanGroupedDigits(&digits, c, &c, separator, strict);
+
+    if (parseError == PARSE_EFORM)
+    {
+        *endptr = c;
+        return parseError;
+    }
+
+    exponent = (long) digits.dropped;
+
+    if (*c == '.')
+    {
+        char *fraction = ++c;
+
+        for (; isdigit(*c); ++c)
+        {
+            if (addDigit(&digits, *c - '0'))
+                --exponent;
+        }
+
+        /* A point needs digits on at least one side */
+        if (parseError == PARSE_EERR && c == fraction)
+            return PARSE_EERR;
+    }
+    else if (parseError == PARSE_EERR)
+    {
+        return PARSE_EERR;
+    }
+
+    if ((*c == 'e' || *c == 'E') && (isdigit(c[1]) || ((c[1] == '+' || c[1] == '-') && isdigit(c[2]))))
+    {
+        long value = 0;
+        bool negativeExponent = (c[1] == '-');
+
+        c += (c[1] == '+' || c[1] == '-') ? 2 : 1;
+
+        for (; isdigit(*c); ++c)
+        {
+            if (value < 100000)
+                value = value * 10 + (*c - '0');
+        }
+
+        exponent += negativeExponent ? -value : value;
+    }
+
+    *endptr = c;
+
+    if (!digits.truncated && digits.value <= CLINGER_MANTISSA_MAX
+        && exponent >= -CLINGER_EXPONENT_MAX && exponent <= CLINGER_EXPONENT_MAX)
+    {
+        *x = (double) digits.value;
+
+        if (exponent < 0)
+            *x /= POWERS_OF_TEN[-exponent];
+        else
+            *x *= POWERS_OF_TEN[exponent];
+
+        if (negative)
+            *x = -*x;
+
+        STATS_PATH(true);
+    }
+    else
+    {
+        STATS_PATH(false);
+
+        errno = 0;
+        *x = strtodGrouped(start, c, separator);
+
+        if (errno == ENOMEM)
+            return PARSE_EERR;
+        else if (errno == ERANGE)
+            return PARSE_ERANGE;
+    }
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Shared by the integer parsers: whitespace, sign and grouped digits, with
+ * PARSE_ERANGE if the value exceeds `limit`
+ */
+static ParseErr parseGroupedInteger(uintmax_t *x, char *nptr, uintmax_t limit, char **endptr, char separator,
+                                       bool strict, bool *negative)
+{
+    struct GroupedDigits digits;
+    char *c;
+    ParseErr parseError;
+
+    *endptr = nptr;
+    *negative = false;
+
+    if (!isSeparatorValid(separator))
+        return PARSE_EFORM;
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    c = *endptr;
+    *negative = (*c == '-');
+
+    if (*c == '+' || *c == '-')
+        ++c;
+
+    parseError = scanGroupedDigits(&digits, c, &c, separator, strict);
+
+    if (parseError == PARSE_EERR)
+        return parseError;
+
+    *endptr = c;
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    if (digits.dropped || digits.value > limit)
+        return PARSE_ERANGE;
+
+    *x = (uintmax_t) digits.value;
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Scan decimal digits and the separators between them, leaving `endptr` after
+ * the last digit. Returns PARSE_EERR if there are no digits and PARSE_EFORM
+ * (with `endptr` at the fault) if `strict` and the grouping is wrong
+ */
+static ParseErr scanGroupedDigits(struct GroupedDigits *digits, char *c, char **endptr, char separator,
+                                     bool strict)
+{
+    size_t group = 0;
+    bool grouped = false;
+    const char *end;
+
+    digits->value = 0;
+    digits->significant = 0;
+    digits->dropped = 0;
+    digits->truncated = false;
+
+    *endptr = c;
+
+    if (!isdigit(*c))
+        return PARSE_EERR;
+
+    if (scanGroupedBlock(digits, c, &end, separator, strict))
+    {
+        *endptr = (char *) (uintptr_t) end;
+        return PARSE_SUCCESS;
+    }
+
+    for (;; ++c)
+    {
+        if (isdigit(*c))
+        {
+            addDigit(digits, *c - '0');
+            ++group;
+        }
+        else if (isGroupSeparator(c, separator))
+        {
+            if (strict && (grouped ? group != 3 : group > 3))
+            {
+                *endptr = c;
+                return PARSE_EFORM;
+            }
+
+            grouped = true;
+            group = 0;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    *endptr = c;
+
+    if (strict && grouped && group != 3)
+        return PARSE_EFORM;
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Scan a number of digits and separators that ends within the next 16 bytes,
+ * finding both with one SSE2 compare each. Returns false, leaving the scalar
+ * loop to find the exact position of any problem, for longer numbers,
+ * separators not between digits, or misplaced groups
+ */
+static bool scanGroupedBlock(struct GroupedDigits *digits, const char *c, const char **endptr, char separator,
+                                bool strict)
+{
+    #if defined(__SSE2__)
+    __m128i v, d;
+    unsigned int digitMask, separatorMask, length, inner, expected = 0;
+    unsigned char values[16];
+
+    if (PAGE_SIZE - ((uintptr_t) c & (PAGE_SIZE - 1)) < 16)
+        return false;
+
+    v = _mm_loadu_si128((const __m128i *) (const void *) c);
+    d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+
+    digitMask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d));
+    separatorMask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(separator)));
+
+    /* Length of the run of digits and separators, which must end in the block */
+    length = (unsigned int) __builtin_ctz(~(digitMask | separatorMask) | 0x10000u);
+
+    if (length == 16)
+        return false;
+
+    digitMask &= (1u << length) - 1;
+    separatorMask &= (1u << length) - 1;
+
+    /* Every separator must sit between two digits */
+    inner = (digitMask << 1) & (digitMask >> 1);
+
+    if (separatorMask & ~inner)
+        return false;
+
+    /* Separators every fourth character from the end, leaving 1-3 digits first */
+    if (strict && separatorMask)
+    {
+        unsigned int first = length;
+
+        for (unsigned int i = 4; i < length; i += 4)
+        {
+            first = length - i;
+            expected |= 1u << first;
+        }
+
+        if (separatorMask != expected || first > 3)
+            return false;
+    }
+
+    _mm_storeu_si128((__m128i *) (void *) values, d);
+
+    /* Accumulate the digits, at most 16 so no overflow */
+    for (unsigned int mask = digitMask; mask; mask &= mask - 1)
+        addDigit(digits, values[__builtin_ctz(mask)]);
+
+    *endptr = c + length;
+
+    return true;
+    #else
+    (void) digits;
+    (void) c;
+    (void) endptr;
+    (void) separator;
+    (void) strict;
+
+    return false;
+    #endif
+}
+
+
+/*
+ * Append a digit, keeping as many significant digits as fit in a uint64_t.
+ * Returns false if the digit was dropped
+ */
+static bool addDigit(struct GroupedDigits *digits, int digit)
+{
+    if (digits->significant == 0 && digit == 0)
+        return true;
+
+    if (digits->dropped == 0
+        && (digits->significant < GROUP_DIGITS_MAX || digits->value <= (UINT64_MAX - (uint64_t) digit) / 10))
+    {
+        digits->value = digits->value * 10 + (uint64_t) digit;
+        ++digits->significant;
+
+        return true;
+    }
+
+    ++digits->dropped;
+
+    if (digit)
+        digits->truncated = true;
+
+    return false;
+}
+
+
+/* Whether `c` is a separator between two digits */
+static bool isGroupSeparator(const char *c, char separator)
+{
+    return *c == separator && isdigit(c[1]) && isdigit(c[-1]);
+}
+
+
+/* Whether `separator` cannot be mistaken for part of a number, or its end */
+static bool isSeparatorValid(char separator)
+{
+    return separator != '\0' && !isdigit(separator) && separator != '.' && separator != '+' && separator != '-';
+}
+
+
+/* strtod() of [start, end) with the separators removed */
+static double strtodGrouped(const char *start, const char *end, char separator)
+{
+    char buffer[GROUP_BUFFER_SIZE];
+    char *copy = buffer;
+    size_t j = 0;
+    double x;
+
+    if ((size_t) (end - start) >= sizeof(buffer))
+    {
+        copy = malloc((size_t) (end - start) + 1);
+
+        if (!copy)
+        {
+            errno = ENOMEM;
+            return 0.0;
+        }
+    }
+
+    for (const char *c = start; c < end; ++c)
+    {
+        if (*c != separator)
+            copy[j++] = *c;
+    }
+
+    copy[j] = '\0';
+    x = strtod(copy, NULL);
+
+    if (copy != buffer)
+        free(copy);
+
+    return x;
+}
@@ -0,0 +1,259 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HEX_SIMD
+#include <immintrin.h>
+#endif
+
+
+/*
+ * Decode as many whole blocks of hex digit pairs as possible, up to `pairs`,
+ * stopping before the first block with any other character. Returns the
+ * number of bytes written
+ */
+typedef size_t (*HexKernel)(uint8_t *out, const char *s, size_t pairs);
+
+
+static int hexValue(unsigned char c);
+static bool isSeparator(unsigned char c, int separators);
+
+#ifdef HEX_SIMD
+static HexKernel hexKernel(void);
+static size_t hexDecodeSSSE3(uint8_t *out, const char *s, size_t pairs);
+static size_t hexDecodeAVX2(uint8_t *out, const char *s, size_t pairs);
+#endif
+
+
+/*
+ * Decode `len` characters of hexadecimal text into at most `cap` bytes
+ *
+ * Digits are taken in pairs, high nibble first, in either case. If
+ * `separators` includes BYTES_SPACE and/or BYTES_COLON, whitespace and/or
+ * colons may appear between (but not within) pairs, e.g. "de:ad:be:ef" or
+ * "deadbeef cafebabe"
+ *
+ * `bytes` (if not NULL) is set to the number of bytes written and `offset` (if
+ * not NULL) to the number of characters consumed, which on error is the exact
+ * offset of the offending character. Returns PARSE_EFORM for a character that
+ * is not a hex digit or permitted separator (or a lone final digit, at offset
+ * `len`) and PARSE_ERANGE if `out` is full
+ *
+ * On x86-64, runs of digits are decoded 16 (SSSE3) or 32 (AVX2) characters at
+ * a time, selected at run time
+ */
+ParseErr stringToBytes(uint8_t *out, size_t cap, const char *s, size_t len, size_t *bytes, size_t *offset,
+                          int separators)
+{
+    size_t i = 0, written = 0;
+    ParseErr parseError = PARSE_SUCCESS;
+
+    #ifdef HEX_SIMD
+    HexKernel kernel = hexKernel();
+    #endif
+
+    while (i < len)
+    {
+        int high, low;
+
+        if (isSeparator((unsigned char) s[i], separators))
+        {
+            ++i;
+            continue;
+        }
+
+        #ifdef HEX_SIMD
+        if (kernel)
+        {
+            size_t pairs = (len - i) / 2 < cap - written ? (len - i) / 2 : cap - written;
+            size_t n = kernel(out + written, s + i, pairs);
+
+            written += n;
+            i += 2 * n;
+
+            if (n)
+                continue;
+        }
+        #endif
+
+        /* One pair at a time, finding the exact position of any error */
+        high = hexValue((unsigned char) s[i]);
+
+        if (high < 0)
+        {
+            parseError = PARSE_EFORM;
+            break;
+        }
+
+        if (i + 1 == len)
+        {
+            i = len;
+            parseError = PARSE_EFORM;
+            break;
+        }
+
+        low = hexValue((unsigned char) s[i + 1]);
+
+        if (low < 0)
+        {
+            ++i;
+            parseError = PARSE_EFORM;
+            break;
+        }
+
+        if (written == cap)
+        {
+            parseError = PARSE_ERANGE;
+            break;
+        }
+
+        out[written++] = (uint8_t) (high << 4 | low);
+        i += 2;
+    }
+
+    if (bytes)
+        *bytes = written;
+
+    if (offset)
+        *offset = i;
+
+    return parseError;
+}
+
+
+/* Value of a hex digit, or -1 */
+static int hexValue(unsigned char c)
+{
+    if ((unsigned int) (c - '0') < 10)
+        return c - '0';
+
+    c |= 0x20;
+
+    if ((unsigned int) (c - 'a') < 6)
+        return c - 'a' + 10;
+
+    return -1;
+}
+
+
+static bool isSeparator(unsigned char c, int separators)
+{
+    if (c == ':')
+        return separators & BYTES_COLON;
+    else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f')
+        return separators & BYTES_SPACE;
+    else
+        return false;
+}
+
+
+#ifdef HEX_SIMD
+/*
+ * Best kernel for this CPU, chosen on first use. Threads racing to choose it
+ * choose the same one, and the kernel is only ever accessed atomically
+ */
+static HexKernel hexKernel(void)
+{
+    static HexKernel kernel;
+    static int selected;
+
+    HexKernel best;
+
+    if (__atomic_load_n(&selected, __ATOMIC_ACQUIRE))
+        return __atomic_load_n(&kernel, __ATOMIC_RELAXED);
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        best = hexDecodeAVX2;
+    else if (__builtin_cpu_supports("ssse3"))
+        best = hexDecodeSSSE3;
+    else
+        best = NULL;
+
+    __atomic_store_n(&kernel, best, __ATOMIC_RELAXED);
+    __atomic_store_n(&selected, 1, __ATOMIC_RELEASE);
+
+    return best;
+}
+
+
+/*
+ * Nibble values of 16 characters, or a validity mask with a zero bit for each
+ * character that is not a hex digit. Digits are c - '0' <= 9 and letters are
+ * (c | 0x20) - 'a' <= 5, as unsigned bytes
+ */
+__attribute__((target("ssse3")))
+static int hexNibbles128(__m128i v, __m128i *nibbles)
+{
+    __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    *nibbles = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                            _mm_and_si128(isAlpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+
+    return _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha));
+}
+
+
+__attribute__((target("ssse3")))
+static size_t hexDecodeSSSE3(uint8_t *out, const char *s, size_t pairs)
+{
+    /* Multipliers of 16 for each high nibble and 1 for each low nibble */
+    const __m128i WEIGHTS = _mm_set1_epi16(0x0110);
+
+    size_t n = 0;
+
+    for (; n + 8 <= pairs; n += 8)
+    {
+        __m128i nibbles, combined;
+
+        if (hexNibbles128(_mm_loadu_si128((const __m128i *) (const void *) (s + 2 * n)), &nibbles) != 0xFFFF)
+            break;
+
+        combined = _mm_maddubs_epi16(nibbles, WEIGHTS);
+        _mm_storel_epi64((__m128i *) (void *) (out + n), _mm_packus_epi16(combined, combined));
+    }
+
+    return n;
+}
+
+
+__attribute__((target("avx2")))
+static size_t hexDecodeAVX2(uint8_t *out, const char *s, size_t pairs)
+{
+    const __m256i WEIGHTS = _mm256_set1_epi16(0x0110);
+
+    size_t n = 0;
+
+    for (; n + 16 <= pairs; n += 16)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (const void *) (s + 2 * n));
+        __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+        __m256i isAlpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+        __m256i nibbles, combined, packed;
+
+        if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) != -1)
+            break;
+
+        nibbles = _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+                                  _mm256_and_si256(isAlpha, _mm256_add_epi8(alpha, _mm256_set1_epi8(10))));
+        combined = _mm256_maddubs_epi16(nibbles, WEIGHTS);
+
+        /* Packing works within 128-bit lanes, so gather the low half of each */
+        packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(combined, combined), 0x08);
+        _mm_storeu_si128((__m128i *) (void *) (out + n), _mm256_castsi256_si128(packed));
+    }
+
+    /* Finish with a 16-character block where possible */
+    return n + hexDecodeSSSE3(out + n, s + 2 * n, pairs - n < 8 ? 0 : 8);
+}
+#endif
@@ -0,0 +1,285 @@
+#include "unprofiled.h"
+#include "infer.h"
+
+#include <complex.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lexer.h"
+#include "parser.h"
+
+
+/* Bounds seen so far, in the widest form of each family of types */
+struct InferBounds
+{
+    uintmax_t integerMin;
+    uintmax_t integerMax;
+    long double realMin;
+    long double realMax;
+    long double imaginaryMin;
+    long double imaginaryMax;
+    size_t memoryMin;
+    size_t memoryMax;
+};
+
+
+static ParseErr inferToken(ValueType *type, struct InferBounds *bounds, bool *memoryOk, char *token);
+static void inferReal(struct InferBounds *bounds, bool *memoryOk, long double re, long double im);
+static void inferResult(Inference *inference, ValueType type, const struct InferBounds *bounds);
+
+
+/*
+ * Infer the narrowest type that every one of `n` sample tokens parses as,
+ * with the range of values seen. Integer types are preferred to floating
+ * point, `double` to `long double` and real to complex types, only widening
+ * when a token needs it. Memory values are chosen if any token has a memory
+ * unit, so long as the rest are non-negative reals
+ *
+ * Each token is classified by the shared lexer in one pass, then parsed once
+ * with the parser for its shape. Integers are decimal only
+ *
+ * Returns PARSE_EFORM if some token parses as none of these types (or
+ * conflicts with the others), with `count` set to its index, and PARSE_EERR
+ * if there are no tokens
+ */
+ParseErr percyInferType(Inference *inference, char **tokens, size_t n)
+{
+    struct InferBounds bounds =
+    {
+        UINTMAX_MAX, 0, HUGE_VALL, -HUGE_VALL, HUGE_VALL, -HUGE_VALL, SIZE_MAX, 0
+    };
+
+    ValueType type = VALUE_ULONG;
+    bool memory = false, memoryOk = true, complexSeen = false, extended = false;
+
+    inference->count = 0;
+
+    if (n == 0)
+        return PARSE_EERR;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        ValueType tokenType;
+
+        inference->count = i;
+
+        if (inferToken(&tokenType, &bounds, &memoryOk, tokens[i]) != PARSE_SUCCESS)
+            return PARSE_EFORM;
+
+        if (tokenType == VALUE_MEMORY)
+            memory = true;
+        else if (tokenType > type)
+            type = tokenType;
+
+        if (tokenType == VALUE_COMPLEX || tokenType == VALUE_COMPLEXL)
+            complexSeen = true;
+
+        if (tokenType == VALUE_DOUBLEL || tokenType == VALUE_COMPLEXL)
+            extended = true;
+
+        /* Memory values only combine with non-negative reals */
+        if (memory && (complexSeen || !memoryOk))
+            return PARSE_EFORM;
+    }
+
+    /* A `long double` real needs `long double complex` alongside complex values */
+    if (type == VALUE_COMPLEX && extended)
+        type = VALUE_COMPLEXL;
+
+    inference->count = n;
+    inferResult(inference, memory ? VALUE_MEMORY : type, &bounds);
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Parse one token by its lexed shape, recording its type and value */
+static ParseErr inferToken(ValueType *type, struct InferBounds *bounds, bool *memoryOk, char *token)
+{
+    char *endptr;
+    ParseErr parseError = PARSE_EFORM;
+
+    switch (lexShape(token))
+    {
+        case SHAPE_INTEGER:
+        {
+            unsigned long ulong;
+            uintmax_t uintmax;
+
+            if ((parseError = stringToULong(&ulong, token, 0, ULONG_MAX, &endptr, BASE_DEC)) == PARSE_SUCCESS)
+            {
+                *type = VALUE_ULONG;
+                uintmax = ulong;
+            }
+            else if ((parseError = stringToUIntMax(&uintmax, token, 0, UINTMAX_MAX, &endptr, BASE_DEC))
+                     == PARSE_SUCCESS)
+            {
+                *type = VALUE_UINTMAX;
+            }
+            else
+            {
+                /* Too large for any integer type */
+                break;
+            }
+
+            if (uintmax < bounds->integerMin)
+                bounds->integerMin = uintmax;
+
+            if (uintmax > bounds->integerMax)
+                bounds->integerMax = uintmax;
+
+            inferReal(bounds, memoryOk, (long double) uintmax, 0.0L);
+
+            return PARSE_SUCCESS;
+        }
+        case SHAPE_REAL:
+            break;
+        case SHAPE_COMPLEX:
+        {
+            complex z;
+            long double complex zL;
+
+            if ((parseError = stringToComplex(&z, token, CMPLX_MIN, CMPLX_MAX, &endptr)) == PARSE_SUCCESS)
+            {
+                *type = VALUE_COMPLEX;
+                zL = z;
+            }
+            else if ((parseError = stringToComplexL(&zL, token, LCMPLX_MIN, LCMPLX_MAX, &endptr)) == PARSE_SUCCESS)
+            {
+                *type = VALUE_COMPLEXL;
+            }
+            else
+            {
+                return parseError;
+            }
+
+            inferReal(bounds, memoryOk, creall(zL), cimagl(zL));
+
+            return PARSE_SUCCESS;
+        }
+        case SHAPE_MEMORY:
+        {
+            size_t bytes;
+
+            parseError = stringToMemory(&bytes, token, 0, SIZE_MAX, &endptr, MEM_B);
+
+            if (parseError != PARSE_SUCCESS)
+                return parseError;
+
+            *type = VALUE_MEMORY;
+
+            if (bytes < bounds->memoryMin)
+                bounds->memoryMin = bytes;
+
+            if (bytes > bounds->memoryMax)
+                bounds->memoryMax = bytes;
+
+            return PARSE_SUCCESS;
+        }
+        case SHAPE_INVALID:
+        default:
+            return PARSE_EFORM;
+    }
+
+    /* Reals, including integers too large for `uintmax_t` */
+    {
+        double x;
+        long double xL;
+
+        if ((parseError = stringToDouble(&x, token, -(DBL_MAX), DBL_MAX, &endptr)) == PARSE_SUCCESS)
+        {
+            *type = VALUE_DOUBLE;
+            xL = x;
+        }
+        else if ((parseError = stringToDoubleL(&xL, token, -(LDBL_MAX), LDBL_MAX, &endptr)) == PARSE_SUCCESS)
+        {
+            *type = VALUE_DOUBLEL;
+        }
+        else
+        {
+            return parseError;
+        }
+
+        inferReal(bounds, memoryOk, xL, 0.0L);
+    }
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Record a real or complex value, and whether it is valid as a memory value */
+static void inferReal(struct InferBounds *bounds, bool *memoryOk, long double re, long double im)
+{
+    if (re < bounds->realMin)
+        bounds->realMin = re;
+
+    if (re > bounds->realMax)
+        bounds->realMax = re;
+
+    if (im < bounds->imaginaryMin)
+        bounds->imaginaryMin = im;
+
+    if (im > bounds->imaginaryMax)
+        bounds->imaginaryMax = im;
+
+    /* As stringToMemory() would convert it without a unit */
+    if (re >= 0.0L && re <= (long double) SIZE_MAX && im == 0.0L)
+    {
+        size_t bytes = (size_t) re;
+
+        if (bytes < bounds->memoryMin)
+            bounds->memoryMin = bytes;
+
+        if (bytes > bounds->memoryMax)
+            bounds->memoryMax = bytes;
+    }
+    else
+    {
+        *memoryOk = false;
+    }
+}
+
+
+/* Fill in the inferred type and its bounds */
+static void inferResult(Inference *inference, ValueType type, const struct InferBounds *bounds)
+{
+    inference->type = type;
+
+    switch (type)
+    {
+        case VALUE_ULONG:
+            inference->min.ulong = (unsigned long) bounds->integerMin;
+            inference->max.ulong = (unsigned long) bounds->integerMax;
+            break;
+        case VALUE_UINTMAX:
+            inference->min.uintmax = bounds->integerMin;
+            inference->max.uintmax = bounds->integerMax;
+            break;
+        case VALUE_DOUBLE:
+            inference->min.real = (double) bounds->realMin;
+            inference->max.real = (double) bounds->realMax;
+            break;
+        case VALUE_DOUBLEL:
+            inference->min.realL = bounds->realMin;
+            inference->max.realL = bounds->realMax;
+            break;
+        case VALUE_COMPLEX:
+            inference->min.cmplx = (double) bounds->realMin + (double) bounds->imaginaryMin * I;
+            inference->max.cmplx = (double) bounds->realMax + (double) bounds->imaginaryMax * I;
+            break;
+        case VALUE_COMPLEXL:
+            inference->min.cmplxL = bounds->realMin + bounds->imaginaryMin * I;
+            inference->max.cmplxL = bounds->realMax + bounds->imaginaryMax * I;
+            break;
+        case VALUE_MEMORY:
+            inference->min.memory = bounds->memoryMin;
+            inference->max.memory = bounds->memoryMax;
+            break;
+        default:
+            break;
+    }
+}
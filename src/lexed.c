@@ -0,0 +1,571 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unprofiled.h"
+#include "lexed.h"
+
+#include <complex.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "tally.h"
+
+
+/*
+ * Significant digits kept when converting to `double` and `long double`, with
+ * one more standing in for any dropped. Halfway cases between two values have
+ * at most 767 and about 11,500 digits respectively, so rounding is unchanged
+ */
+#define LEXED_DIGITS 800
+#define LEXED_DIGITS_LONG 12000
+
+/* Exponents saturate here, where any value is infinite or zero */
+#define LEXED_EXPONENT_MAX (LONG_MAX / 16)
+
+
+/* Exact powers of ten, for Clinger's fast path */
+static const double POW10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const LexedPart ZERO_PART = {NULL, NULL, 0, 10, 0, 0, false, LEXED_ZERO, NULL};
+
+
+static ParseErr lexTerm(LexedPart *part, char *c, char **endptr, bool *imaginary);
+static bool lexNumber(LexedPart *part, char *c, char **endptr);
+static bool lexDigits(LexedPart *part, char *c, char **endptr, int base);
+static bool lexExponent(long *exponent, char *c, char **endptr);
+
+static bool partFastPath(double *significand, const LexedPart *part);
+static void partToString(char *buffer, const LexedPart *part, size_t limit);
+static void writeExponent(char *buffer, char marker, long exponent);
+static ParseErr partToDouble(double *x, const LexedPart *part);
+static ParseErr partToDoubleL(long double *x, const LexedPart *part);
+
+
+/*
+ * Lex a real, imaginary or complex number, with the syntax of
+ * stringToComplex(), into a handle that can be converted later to any of the
+ * floating-point types, at any precision, without lexing the string again
+ *
+ * The handle points into `nptr`, which must outlive it. Range errors are only
+ * found on conversion
+ */
+ParseErr stringToLexed(Lexed *number, char *nptr, char **endptr)
+{
+    LexedPart first, second;
+    bool firstImaginary, secondImaginary;
+    char *partEndptr, *c;
+    char operator;
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    number->re = ZERO_PART;
+    number->im = ZERO_PART;
+    number->imaginary = false;
+
+    parseError = lexTerm(&first, nptr, endptr, &firstImaginary);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    if (firstImaginary)
+        number->im = first;
+    else
+        number->re = first;
+
+    number->imaginary = firstImaginary;
+
+    if (**endptr == '\0')
+        return PARSE_SUCCESS;
+
+    /* Anything but an operator and a part of the other type ends the number */
+    partEndptr = *endptr;
+
+    for (c = partEndptr; isspace(*c); ++c)
+        ;
+
+    if (*c != '+' && *c != '-')
+        return PARSE_EEND;
+
+    operator = *c;
+
+    if (lexTerm(&second, c + 1, &c, &secondImaginary) != PARSE_SUCCESS || secondImaginary == firstImaginary)
+        return PARSE_EEND;
+
+    if (operator == '-')
+        second.negative = !second.negative;
+
+    if (secondImaginary)
+        number->im = second;
+    else
+        number->re = second;
+
+    number->imaginary = true;
+    *endptr = c;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/* Convert a lexed real number to double and handle errors */
+ParseErr lexedToDouble(double *x, const Lexed *number, double min, double max)
+{
+    ParseErr parseError;
+
+    if (number->imaginary)
+        return PARSE_EFORM;
+
+    parseError = partToDouble(x, &number->re);
+
+    /* Range checks */
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+    else if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Convert a lexed real number to long double and handle errors */
+ParseErr lexedToDoubleL(long double *x, const Lexed *number, long double min, long double max)
+{
+    ParseErr parseError;
+
+    if (number->imaginary)
+        return PARSE_EFORM;
+
+    parseError = partToDoubleL(x, &number->re);
+
+    /* Range checks */
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+    else if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Convert a lexed number to complex and handle errors, checking each part's range */
+ParseErr lexedToComplex(complex *z, const Lexed *number, complex min, complex max)
+{
+    double re, im;
+    ParseErr parseError;
+
+    if ((parseError = partToDouble(&re, &number->re)) != PARSE_SUCCESS)
+        return parseError;
+
+    if ((parseError = partToDouble(&im, &number->im)) != PARSE_SUCCESS)
+        return parseError;
+
+    /* Range checks */
+    if (re < creal(min) || im < cimag(min))
+        return PARSE_EMIN;
+    else if (re > creal(max) || im > cimag(max))
+        return PARSE_EMAX;
+
+    *z = re + im * I;
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Lex one term of a complex number: an optional sign, then a real number
+ * and/or the imaginary unit
+ */
+static ParseErr lexTerm(LexedPart *part, char *c, char **endptr, bool *imaginary)
+{
+    bool negative = false;
+
+    *endptr = c;
+
+    while (isspace(*c))
+        ++c;
+
+    if (*c == '+' || *c == '-')
+        negative = (*c++ == '-');
+
+    while (isspace(*c))
+        ++c;
+
+    /* A second sign, which strtod() would not detect either */
+    if (*c == '+' || *c == '-')
+        return PARSE_EFORM;
+
+    if (!lexNumber(part, c, &c))
+    {
+        if (toupper(*c) != 'I')
+            return PARSE_EFORM;
+
+        /* An imaginary unit without coefficient */
+        *part = ZERO_PART;
+        part->digits = "1";
+        part->length = 1;
+        part->kind = LEXED_FINITE;
+    }
+
+    part->negative = negative;
+
+    while (isspace(*c))
+        ++c;
+
+    if ((*imaginary = (toupper(*c) == 'I')))
+        ++c;
+
+    *endptr = c;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Lex an unsigned real number as strtod() would, returning false if there is none */
+static bool lexNumber(LexedPart *part, char *c, char **endptr)
+{
+    char decimalPoint = *localeconv()->decimal_point;
+    long exponent;
+
+    *part = ZERO_PART;
+    part->start = c;
+    *endptr = c;
+
+    if (!strncasecmp(c, "inf", 3))
+    {
+        part->kind = LEXED_INFINITY;
+        c += 3;
+
+        if (!strncasecmp(c, "inity", 5))
+            c += 5;
+    }
+    else if (!strncasecmp(c, "nan", 3))
+    {
+        char *close = c + 4;
+
+        part->kind = LEXED_NAN;
+        c += 3;
+
+        /* Optional "(n-char-sequence)" */
+        if (*c == '(')
+        {
+            while (isalnum(*close) || *close == '_')
+                ++close;
+
+            if (*close == ')')
+                c = close + 1;
+        }
+    }
+    else if (c[0] == '0' && toupper(c[1]) == 'X'
+             && (isxdigit(c[2]) || (c[2] == decimalPoint && isxdigit(c[3]))))
+    {
+        lexDigits(part, c + 2, &c, 16);
+
+        if (toupper(*c) == 'P' && lexExponent(&exponent, c + 1, &c))
+            part->binaryExponent = exponent;
+    }
+    else
+    {
+        if (!lexDigits(part, c, &c, 10))
+            return false;
+
+        if (toupper(*c) == 'E' && lexExponent(&exponent, c + 1, &c))
+            part->exponent += exponent;
+    }
+
+    *endptr = c;
+
+    return true;
+}
+
+
+/* Lex the digits and point of a number, returning false if there are no digits */
+static bool lexDigits(LexedPart *part, char *c, char **endptr, int base)
+{
+    char decimalPoint = *localeconv()->decimal_point;
+    char *point = NULL, *last = NULL;
+    size_t index = 0, integer = 0, firstIndex = 0, lastIndex = 0;
+    int digit;
+
+    for (;; ++c)
+    {
+        if (*c == decimalPoint && !point)
+        {
+            point = c;
+            continue;
+        }
+
+        if ((digit = lexDigitValue(*c, base)) < 0)
+            break;
+
+        if (!point)
+            ++integer;
+
+        if (digit)
+        {
+            if (!last)
+            {
+                part->digits = c;
+                firstIndex = index;
+            }
+
+            last = c;
+            lastIndex = index;
+        }
+
+        ++index;
+    }
+
+    if (!index)
+        return false;
+
+    *endptr = c;
+    part->base = base;
+
+    if (!last)
+        return true;
+
+    part->kind = LEXED_FINITE;
+    part->length = lastIndex - firstIndex + 1;
+    part->point = (point > part->digits && point < last) ? point : NULL;
+    part->exponent = (long) integer - 1 - (long) lastIndex;
+
+    return true;
+}
+
+
+/* Lex a signed decimal exponent, returning false if there are no digits */
+static bool lexExponent(long *exponent, char *c, char **endptr)
+{
+    bool negative = false;
+
+    *exponent = 0;
+
+    if (*c == '+' || *c == '-')
+        negative = (*c++ == '-');
+
+    if (!isdigit(*c))
+        return false;
+
+    for (; isdigit(*c); ++c)
+    {
+        if (*exponent < LEXED_EXPONENT_MAX / 10)
+            *exponent = *exponent * 10 + (*c - '0');
+        else
+            *exponent = LEXED_EXPONENT_MAX;
+    }
+
+    if (negative)
+        *exponent = -*exponent;
+
+    *endptr = c;
+
+    return true;
+}
+
+
+/*
+ * Clinger's fast path: with at most 15 digits and a small power of ten, both
+ * are exact doubles, so one multiplication or division by POW10 rounds
+ * correctly. Returns false if not eligible, or the digits as `significand`
+ */
+static bool partFastPath(double *significand, const LexedPart *part)
+{
+    const char *c = part->digits;
+
+    if (part->base != 10 || part->length > 15 || part->exponent < -22 || part->exponent > 22)
+        return false;
+
+    *significand = 0.0;
+
+    for (size_t i = 0; i < part->length; ++c)
+    {
+        if (c != part->point)
+        {
+            *significand = *significand * 10.0 + (*c - '0');
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Write a finite part as a string for strtod(), with at most `limit` digits
+ * and a '1' in place of any dropped (which always end with a non-zero digit)
+ */
+static void partToString(char *buffer, const LexedPart *part, size_t limit)
+{
+    const char *c = part->digits;
+    size_t n = (part->length < limit) ? part->length : limit, k = 0;
+    long dropped = (long) (part->length - n);
+
+    if (part->base == 16)
+    {
+        buffer[k++] = '0';
+        buffer[k++] = 'x';
+    }
+
+    for (size_t i = 0; i < n; ++c)
+    {
+        if (c != part->point)
+        {
+            buffer[k++] = *c;
+            ++i;
+        }
+    }
+
+    if (dropped)
+    {
+        buffer[k++] = '1';
+        --dropped;
+    }
+
+    if (part->base == 16)
+        writeExponent(buffer + k, 'p', part->binaryExponent + 4 * (part->exponent + dropped));
+    else
+        writeExponent(buffer + k, 'e', part->exponent + dropped);
+}
+
+
+/* Write `marker` and a decimal exponent, terminated, as sprintf("e%ld") would */
+static void writeExponent(char *buffer, char marker, long exponent)
+{
+    char digits[24];
+    unsigned long magnitude = (exponent < 0) ? 0UL - (unsigned long) exponent : (unsigned long) exponent;
+    size_t n = 0;
+
+    *buffer++ = marker;
+
+    if (exponent < 0)
+        *buffer++ = '-';
+
+    do
+    {
+        digits[n++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    while (magnitude);
+
+    while (n)
+        *buffer++ = digits[--n];
+
+    *buffer = '\0';
+}
+
+
+/* Convert a lexed part to double, returning PARSE_ERANGE as strtod() would */
+static ParseErr partToDouble(double *x, const LexedPart *part)
+{
+    char buffer[LEXED_DIGITS + 32];
+    double significand;
+
+    errno = 0;
+
+    switch (part->kind)
+    {
+        case LEXED_ZERO:
+            *x = 0.0;
+            break;
+        case LEXED_INFINITY:
+            *x = HUGE_VAL;
+            break;
+        case LEXED_NAN:
+            *x = NAN;
+            break;
+        case LEXED_FINITE:
+        default:
+            if (partFastPath(&significand, part))
+            {
+                STATS_PATH(true);
+                *x = (part->exponent < 0) ? significand / POW10[-part->exponent]
+                                          : significand * POW10[part->exponent];
+            }
+            else if (part->start && part->length <= LEXED_DIGITS)
+            {
+                /* No digit would be dropped, so strtod() can read the number as written */
+                STATS_PATH(false);
+                *x = strtod(part->start, NULL);
+            }
+            else
+            {
+                STATS_PATH(false);
+                partToString(buffer, part, LEXED_DIGITS);
+                *x = strtod(buffer, NULL);
+            }
+
+            break;
+    }
+
+    if (part->negative)
+        *x = -*x;
+
+    return (errno == ERANGE) ? PARSE_ERANGE : PARSE_SUCCESS;
+}
+
+
+/* Convert a lexed part to long double, returning PARSE_ERANGE as strtold() would */
+static ParseErr partToDoubleL(long double *x, const LexedPart *part)
+{
+    char buffer[LEXED_DIGITS_LONG + 32];
+    double significand;
+
+    errno = 0;
+
+    switch (part->kind)
+    {
+        case LEXED_ZERO:
+            *x = 0.0L;
+            break;
+        case LEXED_INFINITY:
+            *x = HUGE_VALL;
+            break;
+        case LEXED_NAN:
+            *x = NAN;
+            break;
+        case LEXED_FINITE:
+        default:
+            /* Operands exact in double are exact in long double, rounded once there */
+            if (partFastPath(&significand, part))
+            {
+                STATS_PATH(true);
+                *x = (part->exponent < 0) ? (long double) significand / POW10[-part->exponent]
+                                          : (long double) significand * POW10[part->exponent];
+            }
+            else if (part->start && part->length <= LEXED_DIGITS_LONG)
+            {
+                STATS_PATH(false);
+                *x = strtold(part->start, NULL);
+            }
+            else
+            {
+                STATS_PATH(false);
+                partToString(buffer, part, LEXED_DIGITS_LONG);
+                *x = strtold(buffer, NULL);
+            }
+
+            break;
+    }
+
+    if (part->negative)
+        *x = -*x;
+
+    return (errno == ERANGE) ? PARSE_ERANGE : PARSE_SUCCESS;
+}
@@ -0,0 +1,196 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lexer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <strings.h>
+
+
+#define D (LEX_DIGIT | LEX_HEX)
+#define H LEX_HEX
+
+const unsigned char LEX_CLASSES[256] =
+{
+    ['\t'] = LEX_SPACE, ['\n'] = LEX_SPACE, ['\v'] = LEX_SPACE, ['\f'] = LEX_SPACE, ['\r'] = LEX_SPACE,
+    [' '] = LEX_SPACE,
+    ['+'] = LEX_SIGN, ['-'] = LEX_SIGN, ['.'] = LEX_POINT,
+    ['0'] = D, ['1'] = D, ['2'] = D, ['3'] = D, ['4'] = D, ['5'] = D, ['6'] = D, ['7'] = D, ['8'] = D, ['9'] = D,
+    ['a'] = H, ['b'] = H, ['c'] = H, ['d'] = H, ['e'] = H | LEX_EXPONENT | LEX_MAGNITUDE, ['f'] = H,
+    ['A'] = H, ['B'] = H, ['C'] = H, ['D'] = H, ['E'] = H | LEX_EXPONENT | LEX_MAGNITUDE, ['F'] = H,
+    ['i'] = LEX_IMAGINARY, ['I'] = LEX_IMAGINARY,
+    ['k'] = LEX_MAGNITUDE, ['K'] = LEX_MAGNITUDE, ['m'] = LEX_MAGNITUDE, ['M'] = LEX_MAGNITUDE,
+    ['g'] = LEX_MAGNITUDE, ['G'] = LEX_MAGNITUDE, ['t'] = LEX_MAGNITUDE, ['T'] = LEX_MAGNITUDE,
+    ['p'] = LEX_MAGNITUDE, ['P'] = LEX_MAGNITUDE, ['z'] = LEX_MAGNITUDE, ['Z'] = LEX_MAGNITUDE,
+    ['y'] = LEX_MAGNITUDE, ['Y'] = LEX_MAGNITUDE
+};
+
+#undef D
+#undef H
+
+
+static bool lexReal(const char **str, bool *integer);
+static bool lexRealPart(const char *c);
+
+
+/*
+ * Classify a token by its syntax alone, in one pass:
+ *   - SHAPE_INTEGER: unsigned decimal digits, e.g. "42" or "+7"
+ *   - SHAPE_REAL: any other real number accepted by strtod(), bar hexadecimal
+ *   - SHAPE_COMPLEX: a real and/or imaginary part in either order, e.g. "2i",
+ *     "1-2.5i" or "2i+1"
+ *   - SHAPE_MEMORY: a non-negative real with a memory unit, e.g. "1.5 GB"
+ *
+ * A token of some shape is not guaranteed to parse (it may be out of range),
+ * but one of SHAPE_INVALID will not parse as any of them
+ */
+LexShape lexShape(const char *str)
+{
+    bool integer, negative;
+    const char *c = str;
+
+    while (lexIs(*c, LEX_SPACE))
+        ++c;
+
+    negative = (*c == '-');
+
+    if (!lexReal(&c, &integer))
+    {
+        /* Lone imaginary unit, which a real part may follow */
+        if (lexIs(*c, LEX_SIGN))
+            ++c;
+
+        if (!lexIs(*c, LEX_IMAGINARY))
+            return SHAPE_INVALID;
+
+        return (c[1] == '\0' || lexRealPart(c + 1)) ? SHAPE_COMPLEX : SHAPE_INVALID;
+    }
+
+    if (*c == '\0')
+        return (integer && !negative) ? SHAPE_INTEGER : SHAPE_REAL;
+
+    /* Imaginary part, which a real part may follow */
+    if (lexIs(*c, LEX_IMAGINARY))
+        return (c[1] == '\0' || lexRealPart(c + 1)) ? SHAPE_COMPLEX : SHAPE_INVALID;
+
+    /* Imaginary part following a real part, which may be a unit only */
+    if (lexIs(*c, LEX_SIGN))
+    {
+        bool imaginaryInteger;
+        const char *imaginary = c;
+
+        if (!lexReal(&imaginary, &imaginaryInteger))
+            imaginary = c + 1;
+
+        return (lexIs(*imaginary, LEX_IMAGINARY) && imaginary[1] == '\0') ? SHAPE_COMPLEX : SHAPE_INVALID;
+    }
+
+    if (negative)
+        return SHAPE_INVALID;
+
+    while (lexIs(*c, LEX_SPACE))
+        ++c;
+
+    if (lexIs(*c, LEX_MAGNITUDE))
+        ++c;
+
+    return ((*c == 'B' || *c == 'b') && c[1] == '\0') ? SHAPE_MEMORY : SHAPE_INVALID;
+}
+
+
+/*
+ * Value of a digit, or -1 if it is not one in `base` (2 to 62). As for GMP and
+ * MPFR, letters are case-insensitive up to base 36, and above it uppercase
+ * letters come first
+ */
+int lexDigitValue(char c, int base)
+{
+    unsigned int u = (unsigned char) c, value;
+
+    if (u - '0' < 10)
+        value = u - '0';
+    else if (u - 'A' < 26)
+        value = u - 'A' + 10;
+    else if (u - 'a' < 26)
+        value = u - 'a' + ((base <= 36) ? 10 : 36);
+    else
+        return -1;
+
+    return (value < (unsigned int) base) ? (int) value : -1;
+}
+
+
+/* Whether `c` is a signed real part ending the token, as after an imaginary part */
+static bool lexRealPart(const char *c)
+{
+    bool integer;
+
+    if (!lexIs(*c, LEX_SIGN))
+        return false;
+
+    return lexReal(&c, &integer) && *c == '\0';
+}
+
+
+/*
+ * Skip a real number as strtod() would (decimal, infinity or NaN), noting
+ * whether it is only digits. Returns false, without moving `str`, if there is
+ * no number
+ */
+static bool lexReal(const char **str, bool *integer)
+{
+    const char *c = *str;
+    bool digits = false;
+
+    *integer = true;
+
+    if (lexIs(*c, LEX_SIGN))
+        ++c;
+
+    if (!strncasecmp(c, "inf", 3) || !strncasecmp(c, "nan", 3))
+    {
+        *integer = false;
+        c += 3;
+
+        if (!strncasecmp(c, "inity", 5) && !strncasecmp(c - 3, "inf", 3))
+            c += 5;
+
+        *str = c;
+        return true;
+    }
+
+    for (; lexIs(*c, LEX_DIGIT); ++c)
+        digits = true;
+
+    if (lexIs(*c, LEX_POINT))
+    {
+        *integer = false;
+
+        for (++c; lexIs(*c, LEX_DIGIT); ++c)
+            digits = true;
+    }
+
+    if (!digits)
+        return false;
+
+    /* An exponent needs digits, otherwise the 'e' belongs to what follows */
+    if (lexIs(*c, LEX_EXPONENT))
+    {
+        const char *exponent = c + 1;
+
+        if (lexIs(*exponent, LEX_SIGN))
+            ++exponent;
+
+        if (lexIs(*exponent, LEX_DIGIT))
+        {
+            *integer = false;
+
+            for (c = exponent; lexIs(*c, LEX_DIGIT); ++c)
+                ;
+        }
+    }
+
+    *str = c;
+
+    return true;
+}
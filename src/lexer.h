@@ -0,0 +1,55 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+
+/*
+ * Character-class lexer shared by the parsers. Not installed; the classes and
+ * shapes are an implementation detail of the library
+ */
+
+
+#include <stdbool.h>
+
+
+enum LexCharClass
+{
+    LEX_DIGIT = 0x01,
+    LEX_HEX = 0x02,
+    LEX_SIGN = 0x04,
+    LEX_POINT = 0x08,
+    LEX_EXPONENT = 0x10,
+    LEX_IMAGINARY = 0x20,
+    LEX_SPACE = 0x40,
+    LEX_MAGNITUDE = 0x80
+};
+
+/* Syntactic shape of a whole token, deciding which parser can accept it */
+enum LexShape
+{
+    SHAPE_INVALID,
+    SHAPE_INTEGER,
+    SHAPE_REAL,
+    SHAPE_COMPLEX,
+    SHAPE_MEMORY
+};
+
+
+typedef enum LexShape LexShape;
+
+
+/* Classes of each byte, as a mask of LexCharClass */
+extern const unsigned char LEX_CLASSES[256];
+
+
+/* Whether `c` is in any of the classes in `classes` */
+static inline bool lexIs(char c, unsigned char classes)
+{
+    return LEX_CLASSES[(unsigned char) c] & classes;
+}
+
+
+LexShape lexShape(const char *str);
+int lexDigitValue(char c, int base);
+
+
+#endif
@@ -0,0 +1,820 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unprofiled.h"
+#include "parser.h"
+
+#ifdef MP_PREC
+#include <ctype.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <gmp.h>
+
+#include "lexed.h"
+#include "lexer.h"
+
+
+/* Fewest significant digits worth converting in parallel */
+#define MPFR_PARALLEL_DIGITS 65536
+
+/* Most threads used, whatever is requested */
+#define MPFR_THREADS_MAX 64
+
+/* Bits converted beyond the precision, so that ignored digits rarely matter */
+#define MPFR_GUARD_BITS 64
+
+/* Most digits of a power of the base scaling a lexed number, beyond its own length */
+#define MPFR_SCALE_DIGITS 4096
+
+/*
+ * Most bits a positive exponent adds to an automatic precision without a cap.
+ * Integers needing more (past about 1e28224 in base 10) only get guard bits,
+ * so are rounded rather than held exactly
+ */
+#define MPFR_EXPONENT_BITS 65536
+
+
+/* Digits being converted in chunks, and combined in a tree of products */
+struct MpfrTree
+{
+    const unsigned char *digits;
+    size_t length;
+    int base;
+
+    /* Chunk i holds the i-th group of `chunkLength` digits from the end */
+    mpz_t *values;
+    size_t chunkLength;
+    unsigned int chunks;
+    unsigned int threads;
+
+    /* base^(length of the low value) for the current level of the tree */
+    mpz_srcptr power;
+};
+
+/* One thread's share of a tree: every `threads`-th chunk or pair from `first` */
+struct MpfrWork
+{
+    struct MpfrTree *tree;
+    unsigned int first;
+};
+
+
+static mpfr_prec_t scanPrecision(const char *str, const char **endptr, int base, mpfr_prec_t cap);
+static bool lexReal(LexedPart *real, char *nptr, char **endptr, int base);
+static void convertPart(mpfr_t x, const LexedPart *part, mpfr_rnd_t rnd);
+static void convertString(mpfr_t x, const LexedPart *part, mpfr_rnd_t rnd);
+static bool convertReal(mpfr_t x, const LexedPart *real, size_t length, mpfr_rnd_t rnd, unsigned int threads);
+static void convertDigits(mpz_t value, const unsigned char *digits, size_t length, int base, unsigned int threads);
+
+static void *convertChunks(void *arg);
+static void *combineChunks(void *arg);
+static unsigned int startWorkers(pthread_t *tids, struct MpfrWork *work, unsigned int threads,
+                                 void *(*routine)(void *));
+static void joinWorkers(pthread_t *tids, unsigned int started);
+static ParseErr finishMPFR(mpfr_t x, mpfr_t min, mpfr_t max);
+
+
+/*
+ * As stringToMPFR(), but converting numbers with very many significant digits
+ * on up to `threads` threads (0 for one per online processor)
+ *
+ * Only as many leading digits as the precision of `x` needs, plus guard
+ * digits, are converted. They are split into one chunk per thread, each chunk
+ * is converted to an `mpz_t` concurrently, and the chunks are combined in a
+ * tree of multiplications by powers of the base, computed once per level. The
+ * integer is then scaled by the exponent and rounded once into `x`. If the
+ * ignored digits could affect the rounding, all the digits are converted. The
+ * result is correctly rounded, so is identical to that of stringToMPFR()
+ *
+ * Numbers with fewer than 65536 digits needed, binary exponents ('p'),
+ * prefixed bases, infinities and NaNs are passed to stringToMPFR()
+ */
+ParseErr stringToMPFRParallel(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base,
+                                 mpfr_rnd_t rnd, unsigned int threads)
+{
+    LexedPart real;
+    ParseErr parseError;
+    char *end;
+    size_t length;
+
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 62)
+        return PARSE_EBASE;
+
+    if (!lexReal(&real, nptr, &end, base ? base : 10))
+        return stringToMPFR(x, nptr, min, max, endptr, base, rnd);
+
+    if (!base)
+        base = 10;
+
+    /* Leading digits that can affect the result at this precision */
+    length = (size_t) ((double) (mpfr_get_prec(x) + MPFR_GUARD_BITS) / log2(base)) + 2;
+
+    if (length > real.length)
+        length = real.length;
+
+    /* Short numbers, and large scales that would dominate the conversion */
+    if (length < MPFR_PARALLEL_DIGITS
+        || labs(real.exponent + (long) (real.length - length)) > 2 * (long) length)
+    {
+        return stringToMPFR(x, nptr, min, max, endptr, base, rnd);
+    }
+
+    if (threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (online > 0) ? (unsigned int) online : 1;
+    }
+
+    if (threads > MPFR_THREADS_MAX)
+        threads = MPFR_THREADS_MAX;
+
+    mpfr_clear_flags();
+
+    /* Only if the truncated digits might change the rounding are all converted */
+    if (!convertReal(x, &real, length, rnd, threads))
+        convertReal(x, &real, real.length, rnd, threads);
+
+    *endptr = end;
+
+    if ((parseError = finishMPFR(x, min, max)) != PARSE_SUCCESS)
+        return parseError;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * As stringToMPFR(), but first setting the precision of `x` to just hold the
+ * significant digits of the input: exactly for integers (including those
+ * written with a positive exponent) and power-of-two bases, and to as many
+ * digits as were given otherwise. `cap` (if non-zero)
+ * limits the precision. The precision is only changed if it differs, and
+ * mpfr_set_prec() only reallocates when it grows beyond what was allocated, so
+ * reusing `x` for inputs of similar length does not allocate
+ */
+ParseErr stringToMPFRAuto(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd,
+                             mpfr_prec_t cap)
+{
+    const char *end;
+    mpfr_prec_t prec;
+
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 62)
+        return PARSE_EBASE;
+
+    prec = scanPrecision(nptr, &end, base, cap);
+
+    if (mpfr_get_prec(x) != prec)
+        mpfr_set_prec(x, prec);
+
+    return stringToMPFR(x, nptr, min, max, endptr, base, rnd);
+}
+
+
+/*
+ * As stringToComplexMPC(), with the precision of each component of `z` chosen
+ * from the digits of its part as for stringToMPFRAuto(). A missing part is
+ * zero, so needs the least precision
+ */
+ParseErr stringToComplexMPCAuto(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base,
+                                   mpfr_prec_t cap, mpc_rnd_t rnd)
+{
+    const char *c;
+    mpfr_prec_t first, second = MPFR_PREC_MIN, re, im;
+    bool imaginaryFirst;
+
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 62)
+        return PARSE_EBASE;
+
+    first = scanPrecision(nptr, &c, base, cap);
+
+    while (isspace(*c))
+        ++c;
+
+    if ((imaginaryFirst = (toupper(*c) == 'I')))
+        ++c;
+
+    while (isspace(*c))
+        ++c;
+
+    /* Second part, after the operator */
+    if (*c == '+' || *c == '-')
+        second = scanPrecision(c + 1, &c, base, cap);
+
+    re = imaginaryFirst ? second : first;
+    im = imaginaryFirst ? first : second;
+
+    if (mpfr_get_prec(mpc_realref(z)) != re)
+        mpfr_set_prec(mpc_realref(z), re);
+
+    if (mpfr_get_prec(mpc_imagref(z)) != im)
+        mpfr_set_prec(mpc_imagref(z), im);
+
+    return stringToComplexMPC(z, nptr, min, max, endptr, base, (re > im) ? re : im, rnd);
+}
+
+
+/*
+ * Convert a lexed real number into `x`, correctly rounded at its precision,
+ * and handle errors as stringToMPFR() does
+ */
+ParseErr lexedToMPFR(mpfr_t x, const Lexed *number, mpfr_t min, mpfr_t max, mpfr_rnd_t rnd)
+{
+    if (number->imaginary)
+        return PARSE_EFORM;
+
+    mpfr_clear_flags();
+    convertPart(x, &number->re, rnd);
+
+    return finishMPFR(x, min, max);
+}
+
+
+/*
+ * Convert a lexed number into the components of `z`, each correctly rounded
+ * at its own precision, checking the range of each part
+ */
+ParseErr lexedToMPC(mpc_t z, const Lexed *number, mpc_t min, mpc_t max, mpc_rnd_t rnd)
+{
+    ParseErr parseError;
+
+    mpfr_clear_flags();
+    convertPart(mpc_realref(z), &number->re, MPC_RND_RE(rnd));
+
+    parseError = finishMPFR(mpc_realref(z), min ? mpc_realref(min) : NULL, max ? mpc_realref(max) : NULL);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    mpfr_clear_flags();
+    convertPart(mpc_imagref(z), &number->im, MPC_RND_IM(rnd));
+
+    return finishMPFR(mpc_imagref(z), min ? mpc_imagref(min) : NULL, max ? mpc_imagref(max) : NULL);
+}
+
+
+/*
+ * Precision needed for the significant digits of the number at `str`, from
+ * the first non-zero digit to the last non-zero fraction digit, limited to
+ * `cap` if it is non-zero. Sets `endptr` after the number and its exponent
+ *
+ * A positive power of the base left once the exponent has moved the point
+ * past the fraction digits makes the value an integer, which needs the bits
+ * of the odd part of that power as well (those of 5^e for 10^e), the powers
+ * of two only adding to the exponent. Without a cap, at most
+ * MPFR_EXPONENT_BITS are added this way, or MPFR_GUARD_BITS beyond that
+ */
+static mpfr_prec_t scanPrecision(const char *str, const char **endptr, int base, mpfr_prec_t cap)
+{
+    const char *c = str;
+    char decimalPoint = *localeconv()->decimal_point;
+    bool point = false;
+    size_t digits = 0, significant = 0, fraction = 0, scale = 0;
+    long exponent = 0;
+    double bits, scaled;
+    int digit, odd;
+
+    while (isspace(*c))
+        ++c;
+
+    if (*c == '+' || *c == '-')
+        ++c;
+
+    if (c[0] == '0' && toupper(c[1]) == 'X' && (base == 0 || base == 16))
+    {
+        base = 16;
+        c += 2;
+    }
+    else if (c[0] == '0' && toupper(c[1]) == 'B' && (base == 0 || base == 2))
+    {
+        base = 2;
+        c += 2;
+    }
+    else if (base == 0)
+    {
+        base = 10;
+    }
+
+    for (;; ++c)
+    {
+        if (*c == decimalPoint && !point)
+        {
+            point = true;
+            continue;
+        }
+
+        if ((digit = lexDigitValue(*c, base)) < 0)
+            break;
+
+        if (digit || digits)
+            ++digits;
+
+        if (point)
+            ++fraction;
+
+        /* Trailing zeros of the integer part count, but not those of the fraction */
+        if (digit || (digits && !point))
+            significant = digits;
+
+        if (digit && point)
+            scale = fraction;
+    }
+
+    if ((base <= 10 && toupper(*c) == 'E') || *c == '@' || (toupper(*c) == 'P' && (base == 2 || base == 16)))
+    {
+        const char *e = c + 1;
+        bool negative = false, binary = (toupper(*c) == 'P');
+
+        if (*e == '+' || *e == '-')
+            negative = (*e++ == '-');
+
+        if (isdigit(*e))
+        {
+            /* Saturates, any larger exponent getting the same (capped or guard) bits */
+            for (c = e; isdigit(*c); ++c)
+            {
+                if (exponent < 1000000000L)
+                    exponent = exponent * 10 + (*c - '0');
+            }
+
+            /* A binary exponent is a power of two, so needs no more bits */
+            if (negative || binary)
+                exponent = 0;
+        }
+    }
+
+    *endptr = c;
+
+    bits = ceil((double) significant * log2(base));
+
+    for (odd = base; odd % 2 == 0; odd /= 2)
+        ;
+
+    if (significant && odd > 1 && exponent > (long) scale)
+    {
+        scaled = ceil((double) (exponent - (long) scale) * log2(odd));
+        bits += (!cap && scaled > MPFR_EXPONENT_BITS) ? MPFR_GUARD_BITS : scaled;
+    }
+
+    if (cap && bits > (double) cap)
+        bits = (double) cap;
+
+    if (bits > (double) MPFR_PREC_MAX)
+        bits = (double) MPFR_PREC_MAX;
+
+    return (bits < MPFR_PREC_MIN) ? MPFR_PREC_MIN : (mpfr_prec_t) bits;
+}
+
+
+/*
+ * Lex a number with the syntax mpfr_strtofr() accepts for `base`: digits with
+ * an optional point, then an exponent ('e' up to base 10, or '@') of the base.
+ * Returns false for anything else it accepts (infinities, NaNs, binary
+ * exponents and base prefixes), for no digits, and for a zero value
+ */
+static bool lexReal(LexedPart *real, char *nptr, char **endptr, int base)
+{
+    char *c = nptr;
+    char decimalPoint = *localeconv()->decimal_point;
+    const char *last = NULL;
+    size_t length = 0, fraction = 0, lastIndex = 0;
+    long exponent = 0;
+    int digit;
+
+    real->digits = NULL;
+    real->point = NULL;
+    real->base = base;
+    real->binaryExponent = 0;
+    real->negative = false;
+    real->kind = LEXED_FINITE;
+
+    while (isspace(*c))
+        ++c;
+
+    if (*c == '+' || *c == '-')
+        real->negative = (*c++ == '-');
+
+    real->start = c;
+
+    if (c[0] == '0' && ((toupper(c[1]) == 'X' && (base == 10 || base == 16))
+                        || (toupper(c[1]) == 'B' && (base == 10 || base == 2))))
+    {
+        return false;
+    }
+
+    for (;; ++c)
+    {
+        if (*c == decimalPoint && !real->point)
+        {
+            real->point = c;
+            continue;
+        }
+
+        if ((digit = lexDigitValue(*c, base)) < 0)
+            break;
+
+        if (real->point)
+            ++fraction;
+
+        if (digit && !real->digits)
+            real->digits = c;
+
+        if (real->digits)
+        {
+            if (digit)
+            {
+                last = c;
+                lastIndex = length;
+            }
+
+            ++length;
+        }
+    }
+
+    if (!real->digits)
+        return false;
+
+    /* Only a point within the significant digits is skipped */
+    if (real->point && (real->point < real->digits || real->point > last))
+        real->point = NULL;
+
+    if ((base <= 10 && toupper(*c) == 'E') || *c == '@')
+    {
+        char *digits = c + 1;
+        bool negative = false;
+
+        if (*digits == '+' || *digits == '-')
+            negative = (*digits++ == '-');
+
+        if (isdigit(*digits))
+        {
+            for (c = digits; isdigit(*c); ++c)
+            {
+                /* Leave huge exponents to MPFR */
+                if (exponent > LONG_MAX / 20)
+                    return false;
+
+                exponent = exponent * 10 + (*c - '0');
+            }
+
+            if (negative)
+                exponent = -exponent;
+        }
+    }
+    else if (toupper(*c) == 'P' && (base == 2 || base == 16))
+    {
+        return false;
+    }
+
+    /* Trailing zeros are dropped from the digits into the exponent */
+    real->length = lastIndex + 1;
+    real->exponent = exponent - (long) fraction + (long) (length - real->length);
+    *endptr = c;
+
+    return true;
+}
+
+
+/* Convert a lexed part into `x` */
+static void convertPart(mpfr_t x, const LexedPart *part, mpfr_rnd_t rnd)
+{
+    size_t length;
+
+    switch (part->kind)
+    {
+        case LEXED_ZERO:
+            mpfr_set_zero(x, part->negative ? -1 : 1);
+            return;
+        case LEXED_INFINITY:
+            mpfr_set_inf(x, part->negative ? -1 : 1);
+            return;
+        case LEXED_NAN:
+            mpfr_set_nan(x);
+            return;
+        case LEXED_FINITE:
+        default:
+            break;
+    }
+
+    length = (size_t) ((double) (mpfr_get_prec(x) + MPFR_GUARD_BITS) / log2(part->base)) + 2;
+
+    if (length > part->length)
+        length = part->length;
+
+    /* Huge powers of the base are left to MPFR, which only needs them to the precision */
+    if (labs(part->exponent + (long) (part->length - length)) > 2 * (long) length + MPFR_SCALE_DIGITS)
+        convertString(x, part, rnd);
+    else if (!convertReal(x, part, length, rnd, 1))
+        convertReal(x, part, part->length, rnd, 1);
+}
+
+
+/* Convert a lexed part into `x` through mpfr_strtofr(), as "digits@exponent" */
+static void convertString(mpfr_t x, const LexedPart *part, mpfr_rnd_t rnd)
+{
+    void *(*allocate)(size_t);
+    void (*release)(void *, size_t);
+
+    size_t size = part->length + 32, k = 0;
+    const char *c = part->digits;
+    char *buffer;
+
+    mp_get_memory_functions(&allocate, NULL, &release);
+    buffer = allocate(size);
+
+    if (part->negative)
+        buffer[k++] = '-';
+
+    for (size_t i = 0; i < part->length; ++c)
+    {
+        if (c != part->point)
+        {
+            buffer[k++] = *c;
+            ++i;
+        }
+    }
+
+    sprintf(buffer + k, "@%ld", part->exponent);
+    mpfr_strtofr(x, buffer, NULL, part->base, rnd);
+    release(buffer, size);
+
+    if (part->binaryExponent)
+        mpfr_mul_2si(x, x, part->binaryExponent, rnd);
+}
+
+
+/*
+ * Convert the leading `length` significant digits of `real` into `x`. Returns
+ * false, leaving `x` unset, if the digits after them could change the rounding
+ */
+static bool convertReal(mpfr_t x, const LexedPart *real, size_t length, mpfr_rnd_t rnd, unsigned int threads)
+{
+    void *(*allocate)(size_t);
+    void (*release)(void *, size_t);
+
+    unsigned char *digits;
+    const char *c = real->digits;
+    int base = real->base;
+
+    mpz_t num, den, unit, quotient, remainder;
+    long exponent = real->exponent + (long) (real->length - length);
+    long shift;
+    bool sticky, decided = true;
+
+    mp_get_memory_functions(&allocate, NULL, &release);
+    digits = allocate(length);
+
+    for (size_t i = 0; i < length; ++c)
+    {
+        if (c != real->point)
+            digits[i++] = (unsigned char) lexDigitValue(*c, base);
+    }
+
+    mpz_inits(num, den, unit, quotient, remainder, NULL);
+
+    /* The value lies in [num, num + unit) / den, or is num / den if nothing was dropped */
+    convertDigits(num, digits, length, base, threads);
+    release(digits, length);
+
+    if (exponent >= 0)
+    {
+        mpz_ui_pow_ui(unit, (unsigned long) base, (unsigned long) exponent);
+        mpz_mul(num, num, unit);
+        mpz_set_ui(den, 1);
+    }
+    else
+    {
+        mpz_set_ui(unit, 1);
+        mpz_ui_pow_ui(den, (unsigned long) base, (unsigned long) -exponent);
+    }
+
+    /* Scale so the quotient has at least two bits beyond the precision */
+    shift = (long) mpfr_get_prec(x) + 4 - ((long) mpz_sizeinbase(num, 2) - (long) mpz_sizeinbase(den, 2));
+
+    if (shift >= 0)
+    {
+        mpz_mul_2exp(num, num, (mp_bitcnt_t) shift);
+        mpz_mul_2exp(unit, unit, (mp_bitcnt_t) shift);
+    }
+    else
+    {
+        mpz_mul_2exp(den, den, (mp_bitcnt_t) -shift);
+    }
+
+    mpz_tdiv_qr(quotient, remainder, num, den);
+
+    sticky = (mpz_sgn(remainder) != 0);
+
+    /* With dropped non-zero digits, the quotient is only known if the interval stays below the next integer */
+    if (real->length > length)
+    {
+        mpz_add(remainder, remainder, unit);
+        decided = (mpz_cmp(remainder, den) < 0);
+        sticky = true;
+    }
+
+    /* A set low bit below the quotient makes it round as the exact value would */
+    if (decided)
+    {
+        if (sticky)
+        {
+            mpz_mul_2exp(quotient, quotient, 1);
+            mpz_add_ui(quotient, quotient, 1);
+            ++shift;
+        }
+
+        if (real->negative)
+            mpz_neg(quotient, quotient);
+
+        mpfr_set_z_2exp(x, quotient, real->binaryExponent - shift, rnd);
+    }
+
+    mpz_clears(num, den, unit, quotient, remainder, NULL);
+
+    return decided;
+}
+
+
+/* Convert digit values to an integer, in parallel chunks combined in a tree */
+static void convertDigits(mpz_t value, const unsigned char *digits, size_t length, int base, unsigned int threads)
+{
+    pthread_t tids[MPFR_THREADS_MAX];
+    struct MpfrWork work[MPFR_THREADS_MAX];
+    mpz_t values[MPFR_THREADS_MAX];
+    mpz_t powers[MPFR_THREADS_MAX];
+
+    struct MpfrTree tree;
+    unsigned int chunks, started, levels = 0;
+
+    tree.digits = digits;
+    tree.length = length;
+    tree.base = base;
+    tree.values = values;
+    tree.chunkLength = (length + threads - 1) / threads;
+    tree.chunks = chunks = (unsigned int) ((length + tree.chunkLength - 1) / tree.chunkLength);
+    tree.threads = chunks;
+
+    for (unsigned int i = 0; i < chunks; ++i)
+    {
+        mpz_init(values[i]);
+        work[i].tree = &tree;
+        work[i].first = i;
+    }
+
+    started = startWorkers(tids, work, tree.threads, convertChunks);
+
+    /* Powers of the base for each level of the tree, while the chunks convert */
+    for (unsigned int n = chunks; n > 1; n = (n + 1) / 2)
+    {
+        mpz_init(powers[levels]);
+
+        if (levels == 0)
+            mpz_ui_pow_ui(powers[0], (unsigned long) base, (unsigned long) tree.chunkLength);
+        else
+            mpz_mul(powers[levels], powers[levels - 1], powers[levels - 1]);
+
+        ++levels;
+    }
+
+    convertChunks(&work[0]);
+    joinWorkers(tids, started);
+
+    /* Each level combines pairs of values in parallel, halving their number */
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        unsigned int pairs = tree.chunks / 2;
+
+        tree.power = powers[level];
+        tree.threads = (pairs < threads) ? pairs : threads;
+
+        started = startWorkers(tids, work, tree.threads, combineChunks);
+        combineChunks(&work[0]);
+        joinWorkers(tids, started);
+
+        for (unsigned int i = 1; i < pairs; ++i)
+            mpz_swap(values[i], values[2 * i]);
+
+        /* An unpaired top value carries up to the next level */
+        if (tree.chunks % 2)
+            mpz_swap(values[pairs], values[tree.chunks - 1]);
+
+        tree.chunks -= pairs;
+    }
+
+    mpz_swap(value, values[0]);
+
+    for (unsigned int i = 0; i < chunks; ++i)
+        mpz_clear(values[i]);
+
+    for (unsigned int level = 0; level < levels; ++level)
+        mpz_clear(powers[level]);
+}
+
+
+/* Convert each chunk of digits in a thread's share */
+static void *convertChunks(void *arg)
+{
+    struct MpfrWork *work = arg;
+    struct MpfrTree *tree = work->tree;
+
+    for (unsigned int i = work->first; i < tree->chunks; i += tree->threads)
+    {
+        size_t end = tree->length - i * tree->chunkLength;
+        size_t start = (end > tree->chunkLength) ? end - tree->chunkLength : 0;
+        mp_size_t limbs = (mp_size_t) ((double) (end - start) * log2(tree->base) / GMP_NUMB_BITS) + 2;
+
+        limbs = (mp_size_t) mpn_set_str(mpz_limbs_write(tree->values[i], limbs), tree->digits + start, end - start,
+                                        tree->base);
+        mpz_limbs_finish(tree->values[i], limbs);
+    }
+
+    return NULL;
+}
+
+
+/* Combine each pair of values in a thread's share, as low + high x power */
+static void *combineChunks(void *arg)
+{
+    struct MpfrWork *work = arg;
+    struct MpfrTree *tree = work->tree;
+
+    for (unsigned int j = work->first; j < tree->chunks / 2; j += tree->threads)
+        mpz_addmul(tree->values[2 * j], tree->values[2 * j + 1], tree->power);
+
+    return NULL;
+}
+
+
+/*
+ * Start work 1 to `threads - 1` on their own threads, returning how many were
+ * started. Work that cannot get a thread is done on the calling thread
+ */
+static unsigned int startWorkers(pthread_t *tids, struct MpfrWork *work, unsigned int threads,
+                                 void *(*routine)(void *))
+{
+    unsigned int started = 1;
+
+    for (unsigned int t = 1; t < threads; ++t)
+    {
+        if (pthread_create(&tids[started], NULL, routine, &work[t]) == 0)
+            ++started;
+        else
+            routine(&work[t]);
+    }
+
+    return started;
+}
+
+
+/* Wait for the threads started by startWorkers() */
+static void joinWorkers(pthread_t *tids, unsigned int started)
+{
+    for (unsigned int t = 1; t < started; ++t)
+        pthread_join(tids[t], NULL);
+}
+
+
+/* Handle the MPFR flags raised converting into `x`, then check its range */
+static ParseErr finishMPFR(mpfr_t x, mpfr_t min, mpfr_t max)
+{
+    mpfr_flags_t mpfrErr;
+
+    /* Inexactness is not considered an error */
+    mpfr_clear_inexflag();
+    mpfrErr = mpfr_flags_save();
+
+    if (mpfrErr)
+    {
+        if (mpfrErr & MPFR_FLAGS_UNDERFLOW
+            || mpfrErr & MPFR_FLAGS_OVERFLOW
+            || mpfrErr & MPFR_FLAGS_ERANGE)
+        {
+            return PARSE_ERANGE;
+        }
+
+        return PARSE_EERR;
+    }
+
+    /* If user supplied minimum and/or maximum */
+    if (min && mpfr_cmp(x, min) < 0)
+        return PARSE_EMIN;
+
+    if (max && mpfr_cmp(x, max) > 0)
+        return PARSE_EMAX;
+
+    return PARSE_SUCCESS;
+}
+#endif
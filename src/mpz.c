@@ -0,0 +1,209 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#ifdef MP_PREC
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <gmp.h>
+
+#include "lexer.h"
+
+
+/* Digit strings up to this long are converted from a buffer on the stack */
+#define MPZ_STACK_DIGITS 256
+
+
+static ParseErr parseMPZ(mpz_t x, char *nptr, char **endptr, int base, bool signAllowed);
+static int parseBasePrefix(char *c, char **endptr, int base);
+
+
+/*
+ * Convert string to a GMP integer and handle errors
+ *
+ * The syntax is that of mpz_set_str(), with an optional sign, and with base 0
+ * detecting a "0x", "0b" or "0" prefix. Unlike mpz_set_str(), whitespace is
+ * only skipped before the number, and `endptr` is set as for strtol(). Digits
+ * are converted with GMP's subquadratic mpn_set_str(), so million-digit
+ * numbers take milliseconds. `min` and `max` may be NULL
+ */
+ParseErr stringToMPZ(mpz_t x, char *nptr, mpz_t min, mpz_t max, char **endptr, int base)
+{
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 62)
+        return PARSE_EBASE;
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    parseError = parseMPZ(x, *endptr, endptr, base, true);
+
+    /* Conversion check */
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    /* Range checks */
+    if (min && mpz_cmp(x, min) < 0)
+        return PARSE_EMIN;
+    else if (max && mpz_cmp(x, max) > 0)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Convert string to a GMP rational and handle errors
+ *
+ * Input is an integer, as for stringToMPZ(), optionally followed by '/' and an
+ * unsigned denominator (which may have its own base prefix). The result is in
+ * canonical form. A zero denominator returns PARSE_EFORM, with `endptr` at the
+ * '/' and the denominator left as 1
+ */
+ParseErr stringToMPQ(mpq_t x, char *nptr, mpq_t min, mpq_t max, char **endptr, int base)
+{
+    char *denominatorEnd;
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 62)
+        return PARSE_EBASE;
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    parseError = parseMPZ(mpq_numref(x), *endptr, endptr, base, true);
+
+    /* Conversion check */
+    if (parseError != PARSE_SUCCESS)
+    {
+        mpz_set_ui(mpq_denref(x), 1);
+        return parseError;
+    }
+
+    /* Without a denominator the number ends before the '/' */
+    if (**endptr != '/' || parseMPZ(mpq_denref(x), *endptr + 1, &denominatorEnd, base, false) != PARSE_SUCCESS)
+    {
+        mpz_set_ui(mpq_denref(x), 1);
+    }
+    else if (mpz_sgn(mpq_denref(x)) == 0)
+    {
+        mpz_set_ui(mpq_denref(x), 1);
+        return PARSE_EFORM;
+    }
+    else
+    {
+        *endptr = denominatorEnd;
+        mpq_canonicalize(x);
+    }
+
+    /* Range checks */
+    if (min && mpq_cmp(x, min) < 0)
+        return PARSE_EMIN;
+    else if (max && mpq_cmp(x, max) > 0)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Parse the integer at `nptr` (without leading whitespace) into `x`. Returns
+ * PARSE_EERR, with `endptr` at `nptr`, if there are no digits
+ */
+static ParseErr parseMPZ(mpz_t x, char *nptr, char **endptr, int base, bool signAllowed)
+{
+    unsigned char stackDigits[MPZ_STACK_DIGITS];
+    unsigned char *digits = stackDigits;
+
+    void *(*allocate)(size_t);
+    void (*release)(void *, size_t);
+
+    char *c = nptr;
+    bool negative = false, zeros = false;
+    size_t length = 0;
+    mp_size_t limbs;
+
+    *endptr = nptr;
+
+    if (signAllowed && (*c == '+' || *c == '-'))
+        negative = (*c++ == '-');
+
+    base = parseBasePrefix(c, &c, base);
+
+    /* Leading zeros are digits, but mpn_set_str() needs a non-zero first digit */
+    for (; *c == '0'; ++c)
+        zeros = true;
+
+    while (lexDigitValue(c[length], base) >= 0)
+        ++length;
+
+    if (!length)
+    {
+        if (!zeros)
+            return PARSE_EERR;
+
+        mpz_set_ui(x, 0);
+        *endptr = c;
+
+        return PARSE_SUCCESS;
+    }
+
+    mp_get_memory_functions(&allocate, NULL, &release);
+
+    if (length > MPZ_STACK_DIGITS)
+        digits = allocate(length);
+
+    for (size_t i = 0; i < length; ++i)
+        digits[i] = (unsigned char) lexDigitValue(c[i], base);
+
+    /* Room for any `length`-digit number, plus the extra limb mpn_set_str() needs */
+    limbs = (mp_size_t) ((double) length * log2(base) / GMP_NUMB_BITS) + 2;
+    limbs = (mp_size_t) mpn_set_str(mpz_limbs_write(x, limbs), digits, length, base);
+    mpz_limbs_finish(x, negative ? -limbs : limbs);
+
+    if (digits != stackDigits)
+        release(digits, length);
+
+    *endptr = c + length;
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Skip a "0x" (base 0 or 16) or "0b" (base 0 or 2) prefix followed by a digit,
+ * returning the base. Otherwise base 0 means octal after a '0' and decimal
+ * otherwise
+ */
+static int parseBasePrefix(char *c, char **endptr, int base)
+{
+    *endptr = c;
+
+    if (c[0] == '0' && toupper(c[1]) == 'X' && (base == 0 || base == 16) && lexDigitValue(c[2], 16) >= 0)
+    {
+        *endptr = c + 2;
+        return 16;
+    }
+    else if (c[0] == '0' && toupper(c[1]) == 'B' && (base == 0 || base == 2) && lexDigitValue(c[2], 2) >= 0)
+    {
+        *endptr = c + 2;
+        return 2;
+    }
+
+    if (base)
+        return base;
+
+    return (c[0] == '0') ? 8 : 10;
+}
+#endif
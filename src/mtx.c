@@ -0,0 +1,542 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include "unprofiled.h"
+#include "mtx.h"
+
+#include <complex.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <float.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "parser.h"
+
+
+/* Smallest share of the entry lines worth giving to a thread */
+#define MTX_CHUNK_MIN 1048576
+
+/* Most threads used, whatever is requested */
+#define MTX_THREADS_MAX 256
+
+
+/* One thread's share of the entry lines */
+struct MtxChunk
+{
+    Matrix *matrix;
+
+    char *start;
+    char *end;
+
+    /* Lines, and non-blank (entry) lines, in this chunk */
+    size_t lines;
+    size_t entries;
+
+    /* Index of this chunk's first entry in the matrix arrays */
+    size_t first;
+
+    /* First error in this chunk, and its line number within the chunk */
+    ParseErr error;
+    size_t errorLine;
+};
+
+
+static char *mapPadded(const char *path, size_t *length, size_t *mapLength);
+static char *nextLine(char *c, char *end);
+static bool isBlankLine(char *c);
+static char *skipBlank(char *c);
+
+static ParseErr parseBanner(Matrix *matrix, char *c);
+static ParseErr parseEntry(Matrix *matrix, size_t i, char *c);
+
+static void *countChunk(void *arg);
+static void *parseChunk(void *arg);
+static bool runChunks(struct MtxChunk *chunks, unsigned int threads, void *(*routine)(void *));
+
+
+/*
+ * Load a Matrix Market coordinate file (real, integer, complex or pattern
+ * field) into COO arrays. The file is mapped into memory, and its entry lines
+ * are counted and parsed by up to `threads` threads (0 for one per online
+ * processor). If `line` is not NULL, it is set to the 1-based line number of
+ * the first error
+ *
+ * Returns:
+ *   - PARSE_EERR if the file cannot be read or memory allocated
+ *   - PARSE_EFORM if the banner, size line or an entry is malformed, or the
+ *     number of entries does not match the size line
+ *   - PARSE_ERANGE if an index is outside the matrix or a value overflows
+ *
+ * The matrix must be released with mtxFree()
+ */
+ParseErr mtxLoad(Matrix *matrix, const char *path, unsigned int threads, size_t *line)
+{
+    struct MtxChunk chunks[MTX_THREADS_MAX];
+    size_t length, mapLength, lineNumber = 1, entries = 0, width = 0;
+    char *map, *c, *end, *tmpptr;
+    unsigned long nonzeros;
+    ParseErr parseError;
+
+    memset(matrix, 0, sizeof(*matrix));
+
+    if (line)
+        *line = 0;
+
+    map = mapPadded(path, &length, &mapLength);
+
+    if (!map)
+        return PARSE_EERR;
+
+    end = map + length;
+
+    /* Banner */
+    parseError = parseBanner(matrix, map);
+    c = nextLine(map, end);
+
+    /* Comments and blank lines up to the size line */
+    while (parseError == PARSE_SUCCESS && c < end && (*c == '%' || isBlankLine(c)))
+    {
+        c = nextLine(c, end);
+        ++lineNumber;
+    }
+
+    /* Size line: rows, columns and number of entries */
+    if (parseError == PARSE_SUCCESS)
+    {
+        char *sizeptr = skipBlank(c);
+
+        ++lineNumber;
+
+        if (c >= end
+            || stringToULong(&matrix->rows, sizeptr, 0, ULONG_MAX, &tmpptr, BASE_DEC) != PARSE_EEND
+            || (sizeptr = skipBlank(tmpptr)) == tmpptr
+            || stringToULong(&matrix->cols, sizeptr, 0, ULONG_MAX, &tmpptr, BASE_DEC) != PARSE_EEND
+            || (sizeptr = skipBlank(tmpptr)) == tmpptr
+            || stringToULong(&nonzeros, sizeptr, 0, SIZE_MAX, &tmpptr, BASE_DEC) == PARSE_EERR
+            || !isBlankLine(tmpptr))
+        {
+            parseError = PARSE_EFORM;
+        }
+
+        matrix->nonzeros = (size_t) nonzeros;
+        c = nextLine(c, end);
+    }
+
+    if (parseError == PARSE_SUCCESS)
+    {
+        switch (matrix->field)
+        {
+            case MTX_REAL:
+                width = sizeof(double);
+                break;
+            case MTX_INTEGER:
+                width = sizeof(int64_t);
+                break;
+            case MTX_COMPLEX:
+                width = sizeof(complex);
+                break;
+            case MTX_PATTERN:
+            default:
+                width = 0;
+                break;
+        }
+
+        if (matrix->nonzeros > SIZE_MAX / sizeof(unsigned long)
+            || (width && matrix->nonzeros > SIZE_MAX / width))
+        {
+            parseError = PARSE_ERANGE;
+        }
+    }
+
+    if (parseError == PARSE_SUCCESS)
+    {
+        size_t n = matrix->nonzeros ? matrix->nonzeros : 1;
+
+        matrix->rowIndices = malloc(n * sizeof(*matrix->rowIndices));
+        matrix->colIndices = malloc(n * sizeof(*matrix->colIndices));
+
+        if (width)
+            matrix->values = malloc(n * width);
+
+        if (!matrix->rowIndices || !matrix->colIndices || (width && !matrix->values))
+            parseError = PARSE_EERR;
+    }
+
+    if (parseError != PARSE_SUCCESS)
+    {
+        if (line)
+            *line = lineNumber;
+
+        munmap(map, mapLength);
+        mtxFree(matrix);
+        return parseError;
+    }
+
+    /* Divide the entry lines between the threads, splitting at line breaks */
+    if (threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (online > 0) ? (unsigned int) online : 1;
+    }
+
+    if (threads > (size_t) (end - c) / MTX_CHUNK_MIN + 1)
+        threads = (unsigned int) ((size_t) (end - c) / MTX_CHUNK_MIN + 1);
+
+    if (threads > MTX_THREADS_MAX)
+        threads = MTX_THREADS_MAX;
+
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+        chunks[t].matrix = matrix;
+        chunks[t].start = (t == 0) ? c : chunks[t - 1].end;
+        chunks[t].end = (t == threads - 1) ? end
+                        : nextLine(chunks[t].start + (size_t) (end - chunks[t].start) / (threads - t) - 1, end);
+        chunks[t].error = PARSE_SUCCESS;
+    }
+
+    /* Count each chunk's entries so every thread knows where to store them */
+    parseError = runChunks(chunks, threads, countChunk) ? PARSE_SUCCESS : PARSE_EERR;
+
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+        chunks[t].first = entries;
+        entries += chunks[t].entries;
+    }
+
+    if (parseError == PARSE_SUCCESS && entries != matrix->nonzeros)
+    {
+        parseError = PARSE_EFORM;
+
+        if (line)
+            *line = lineNumber + 1;
+    }
+
+    if (parseError == PARSE_SUCCESS)
+        parseError = runChunks(chunks, threads, parseChunk) ? PARSE_SUCCESS : PARSE_EERR;
+
+    /* Report the earliest error in the file */
+    for (unsigned int t = 0; parseError == PARSE_SUCCESS && t < threads; ++t)
+    {
+        if (chunks[t].error != PARSE_SUCCESS)
+        {
+            parseError = chunks[t].error;
+
+            if (line)
+                *line = lineNumber + chunks[t].errorLine;
+        }
+
+        lineNumber += chunks[t].lines;
+    }
+
+    munmap(map, mapLength);
+
+    if (parseError != PARSE_SUCCESS)
+        mtxFree(matrix);
+
+    return parseError;
+}
+
+
+/* Free a matrix's arrays */
+void mtxFree(Matrix *matrix)
+{
+    free(matrix->rowIndices);
+    free(matrix->colIndices);
+    free(matrix->values);
+
+    matrix->rowIndices = NULL;
+    matrix->colIndices = NULL;
+    matrix->values = NULL;
+}
+
+
+/*
+ * Map a file read-only with at least one NUL byte after its end, so every
+ * line (including an unterminated last line) can be handed straight to the
+ * stringToX() functions. An anonymous region a page larger than the file is
+ * reserved and the file mapped over the start of it
+ */
+static char *mapPadded(const char *path, size_t *length, size_t *mapLength)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) || pageSize <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *length = (size_t) st.st_size;
+    *mapLength = (*length / (size_t) pageSize + 1) * (size_t) pageSize;
+
+    map = mmap(NULL, *mapLength, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (map != MAP_FAILED && *length > 0
+        && mmap(map, *length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(map, *mapLength);
+        map = MAP_FAILED;
+    }
+
+    close(fd);
+
+    return (map == MAP_FAILED) ? NULL : map;
+}
+
+
+/* Pointer to the start of the line after the one containing `c` */
+static char *nextLine(char *c, char *end)
+{
+    char *newline = memchr(c, '\n', (size_t) (end - c));
+
+    return newline ? newline + 1 : end;
+}
+
+
+/* Whether the rest of the line holds only whitespace */
+static bool isBlankLine(char *c)
+{
+    c = skipBlank(c);
+
+    return *c == '\n' || *c == '\0';
+}
+
+
+/* Skip spaces and tabs (and carriage returns), but not line breaks */
+static char *skipBlank(char *c)
+{
+    while (*c == ' ' || *c == '\t' || *c == '\r')
+        ++c;
+
+    return c;
+}
+
+
+/* Parse "%%MatrixMarket matrix coordinate <field> <symmetry>" */
+static ParseErr parseBanner(Matrix *matrix, char *c)
+{
+    const char *BANNER[] = {"%%MatrixMarket", "matrix", "coordinate"};
+    const char *FIELDS[] = {"real", "integer", "complex", "pattern"};
+    const char *SYMMETRIES[] = {"general", "symmetric", "skew-symmetric", "hermitian"};
+
+    size_t word = 0;
+    bool field = false, symmetry = false;
+
+    for (c = skipBlank(c); *c != '\n' && *c != '\0'; c = skipBlank(c), ++word)
+    {
+        size_t length = 0;
+
+        while (!isspace((unsigned char) c[length]) && c[length] != '\0')
+            ++length;
+
+        if (word < sizeof(BANNER) / sizeof(BANNER[0]))
+        {
+            if (length != strlen(BANNER[word]) || strncasecmp(c, BANNER[word], length))
+                return PARSE_EFORM;
+        }
+        else if (word == sizeof(BANNER) / sizeof(BANNER[0]))
+        {
+            for (size_t i = 0; i < sizeof(FIELDS) / sizeof(FIELDS[0]); ++i)
+            {
+                if (length == strlen(FIELDS[i]) && !strncasecmp(c, FIELDS[i], length))
+                {
+                    matrix->field = (MatrixField) i;
+                    field = true;
+                }
+            }
+        }
+        else if (word == sizeof(BANNER) / sizeof(BANNER[0]) + 1)
+        {
+            for (size_t i = 0; i < sizeof(SYMMETRIES) / sizeof(SYMMETRIES[0]); ++i)
+            {
+                if (length == strlen(SYMMETRIES[i]) && !strncasecmp(c, SYMMETRIES[i], length))
+                {
+                    matrix->symmetry = (MatrixSymmetry) i;
+                    symmetry = true;
+                }
+            }
+        }
+        else
+        {
+            return PARSE_EFORM;
+        }
+
+        c += length;
+    }
+
+    return (field && symmetry) ? PARSE_SUCCESS : PARSE_EFORM;
+}
+
+
+/* Parse the entry line at `c` into index `i` of the matrix arrays */
+static ParseErr parseEntry(Matrix *matrix, size_t i, char *c)
+{
+    char *endptr;
+    double re, im;
+    uintmax_t magnitude;
+    bool negative;
+    ParseErr parseError;
+
+    /*
+     * Each field is checked to start on this line before it is parsed, since
+     * strtoX() would otherwise skip the line break into the next entry
+     */
+    parseError = stringToULong(&matrix->rowIndices[i], c, 1, matrix->rows, &endptr, BASE_DEC);
+
+    if (parseError != PARSE_EEND)
+        return (parseError == PARSE_SUCCESS || parseError == PARSE_EERR) ? PARSE_EFORM : PARSE_ERANGE;
+
+    c = skipBlank(endptr);
+
+    if (c == endptr)
+        return PARSE_EFORM;
+
+    parseError = stringToULong(&matrix->colIndices[i], c, 1, matrix->cols, &endptr, BASE_DEC);
+
+    if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
+        return (parseError == PARSE_EERR) ? PARSE_EFORM : PARSE_ERANGE;
+
+    switch (matrix->field)
+    {
+        case MTX_REAL:
+            c = skipBlank(endptr);
+
+            if (c == endptr || *c == '\n')
+                return PARSE_EFORM;
+
+            parseError = stringToDouble(&((double *) matrix->values)[i], c, -(DBL_MAX), DBL_MAX, &endptr);
+            break;
+        case MTX_INTEGER:
+            c = skipBlank(endptr);
+
+            if (c == endptr || *c == '\n')
+                return PARSE_EFORM;
+
+            /* Integers may be negative, so the sign is taken off first and the magnitude bounded by it */
+            negative = (*c == '-');
+            parseError = stringToUIntMax(&magnitude, (*c == '-' || *c == '+') ? c + 1 : c, 0,
+                                         (uintmax_t) INT64_MAX + negative, &endptr, BASE_DEC);
+
+            /* -2^63 has no positive counterpart, so it is negated one short of its magnitude */
+            if (negative && magnitude)
+                ((int64_t *) matrix->values)[i] = -(int64_t) (magnitude - 1) - 1;
+            else
+                ((int64_t *) matrix->values)[i] = (int64_t) magnitude;
+            break;
+        case MTX_COMPLEX:
+            c = skipBlank(endptr);
+
+            if (c == endptr || *c == '\n')
+                return PARSE_EFORM;
+
+            parseError = stringToDouble(&re, c, -(DBL_MAX), DBL_MAX, &endptr);
+
+            if (parseError != PARSE_EEND)
+                break;
+
+            c = skipBlank(endptr);
+
+            if (c == endptr || *c == '\n')
+                return PARSE_EFORM;
+
+            parseError = stringToDouble(&im, c, -(DBL_MAX), DBL_MAX, &endptr);
+            ((complex *) matrix->values)[i] = re + im * I;
+            break;
+        case MTX_PATTERN:
+        default:
+            break;
+    }
+
+    if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
+        return (parseError == PARSE_EERR) ? PARSE_EFORM : PARSE_ERANGE;
+
+    return isBlankLine(endptr) ? PARSE_SUCCESS : PARSE_EFORM;
+}
+
+
+/* Thread routine: count the lines and entry lines in a chunk */
+static void *countChunk(void *arg)
+{
+    struct MtxChunk *chunk = arg;
+
+    chunk->lines = 0;
+    chunk->entries = 0;
+
+    for (char *c = chunk->start; c < chunk->end; c = nextLine(c, chunk->end))
+    {
+        ++chunk->lines;
+
+        if (!isBlankLine(c))
+            ++chunk->entries;
+    }
+
+    return NULL;
+}
+
+
+/* Thread routine: parse the entry lines in a chunk, stopping at an error */
+static void *parseChunk(void *arg)
+{
+    struct MtxChunk *chunk = arg;
+    size_t i = chunk->first, line = 0;
+
+    for (char *c = chunk->start; c < chunk->end; c = nextLine(c, chunk->end), ++line)
+    {
+        if (isBlankLine(c))
+            continue;
+
+        chunk->error = parseEntry(chunk->matrix, i++, skipBlank(c));
+
+        if (chunk->error != PARSE_SUCCESS)
+        {
+            chunk->errorLine = line + 1;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Run a routine over every chunk, on the calling thread and `threads - 1` more */
+static bool runChunks(struct MtxChunk *chunks, unsigned int threads, void *(*routine)(void *))
+{
+    pthread_t tids[MTX_THREADS_MAX];
+    unsigned int started;
+    bool ok = true;
+
+    for (started = 1; started < threads; ++started)
+    {
+        if (pthread_create(&tids[started], NULL, routine, &chunks[started]))
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    routine(&chunks[0]);
+
+    for (unsigned int t = 1; t < started; ++t)
+        pthread_join(tids[t], NULL);
+
+    return ok;
+}
@@ -0,0 +1,418 @@
+#include "unprofiled.h"
+#include "options.h"
+
+#include <complex.h>
+#include <float.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MP_PREC
+#include <mpfr.h>
+#include <mpc.h>
+#endif
+
+
+/* Names of the option types in error messages */
+static const char *const OPTION_TYPE_NAMES[] =
+{
+    [OPTION_FLAG] = "flag",
+    [OPTION_STRING] = "string",
+    [OPTION_ULONG] = "integer",
+    [OPTION_UINTMAX] = "integer",
+    [OPTION_DOUBLE] = "number",
+    [OPTION_DOUBLEL] = "number",
+    [OPTION_COMPLEX_PART] = "complex part",
+    [OPTION_COMPLEX] = "complex number",
+    [OPTION_MEMORY] = "memory size",
+    [OPTION_DURATION] = "duration",
+    [OPTION_TIMESTAMP] = "timestamp",
+
+    #ifdef MP_PREC
+    [OPTION_MPFR] = "number",
+    [OPTION_MPC] = "complex number",
+    #endif
+};
+
+
+static const Option *findLong(const Option *options, size_t n, const char *name, size_t length);
+static const Option *findShort(const Option *options, size_t n, char key);
+static ParseErr optionSet(const Option *option, char *argument);
+static bool optionBounded(const Option *option);
+static void writeBound(FILE *stream, const Option *option, const OptionBound *bound);
+
+
+/*
+ * Parse the options of `argv` against the table `options` of `n`, storing each
+ * argument in its option's target, until the first operand, a lone "-", or
+ * after "--". `*operands` is set to the index of the first operand (`argc` if
+ * none). An option given more than once takes the last value
+ *
+ * Stops at the first error: an unknown option, a missing argument, an
+ * argument given to a flag (all PARSE_EFORM), or an argument its parser
+ * rejects or does not fully parse (PARSE_EEND), which is described in `*error`
+ * for optionsWriteError(). Returns PARSE_SUCCESS otherwise
+ */
+ParseErr optionsParse(const Option *options, size_t n, int argc, char **argv, int *operands, OptionError *error)
+{
+    int a;
+
+    error->result = PARSE_SUCCESS;
+    error->option = NULL;
+    error->word = NULL;
+    error->argument = NULL;
+
+    for (a = 1; a < argc; ++a)
+    {
+        char *word = argv[a];
+        const Option *option;
+        char *argument = NULL;
+
+        /* Operands, from the first non-option on */
+        if (word[0] != '-' || word[1] == '\0')
+            break;
+
+        if (word[1] == '-')
+        {
+            char *name = word + 2;
+            char *equals;
+
+            if (*name == '\0')
+            {
+                ++a;
+                break;
+            }
+
+            equals = strchr(name, '=');
+            option = findLong(options, n, name, equals ? (size_t) (equals - name) : strlen(name));
+
+            error->word = word;
+
+            if (!option)
+            {
+                error->result = PARSE_EFORM;
+                break;
+            }
+
+            if (equals)
+                argument = equals + 1;
+            else if (option->type != OPTION_FLAG && a + 1 < argc)
+                argument = argv[++a];
+        }
+        else
+        {
+            /* Clustered short options, until one that takes an argument */
+            char *key = word + 1;
+
+            for (;;)
+            {
+                option = findShort(options, n, *key);
+
+                if (!option || option->type != OPTION_FLAG || key[1] == '\0')
+                    break;
+
+                *(bool *) option->target = true;
+
+                if (option->given)
+                    *option->given = true;
+
+                ++key;
+            }
+
+            error->word = key;
+
+            if (!option)
+            {
+                error->result = PARSE_EFORM;
+                break;
+            }
+
+            if (option->type != OPTION_FLAG)
+            {
+                if (key[1] != '\0')
+                    argument = key + 1;
+                else if (a + 1 < argc)
+                    argument = argv[++a];
+            }
+        }
+
+        error->option = option;
+        error->argument = argument;
+
+        /* A flag given an argument, or an option missing one */
+        if ((option->type == OPTION_FLAG) != (argument == NULL))
+        {
+            error->result = PARSE_EFORM;
+            break;
+        }
+
+        error->result = optionSet(option, argument);
+
+        if (error->result != PARSE_SUCCESS)
+            break;
+
+        if (option->given)
+            *option->given = true;
+    }
+
+    *operands = a;
+
+    if (error->result == PARSE_SUCCESS)
+    {
+        error->option = NULL;
+        error->word = NULL;
+        error->argument = NULL;
+    }
+
+    return error->result;
+}
+
+
+/*
+ * Describe an error of optionsParse() on `stream`, as one line prefixed with
+ * `program`, in the same words for every program and option
+ */
+void optionsWriteError(FILE *stream, const char *program, const OptionError *error)
+{
+    const Option *option = error->option;
+
+    if (error->result == PARSE_SUCCESS)
+        return;
+
+    if (!option)
+    {
+        if (error->word && strncmp(error->word, "--", 2) == 0)
+            fprintf(stream, "%s: Unknown option '%s'\n", program, error->word);
+        else
+            fprintf(stream, "%s: Unknown option '-%c'\n", program, error->word ? error->word[0] : '?');
+
+        return;
+    }
+
+    fprintf(stream, "%s: ", program);
+
+    if (option->name)
+        fprintf(stream, "--%s", option->name);
+    else
+        fprintf(stream, "-%c", option->key);
+
+    fprintf(stream, ": ");
+
+    if (option->type == OPTION_FLAG)
+    {
+        fprintf(stream, "Takes no argument\n");
+        return;
+    }
+
+    if (!error->argument)
+    {
+        fprintf(stream, "Missing %s argument\n", OPTION_TYPE_NAMES[option->type]);
+        return;
+    }
+
+    switch (error->result)
+    {
+        case PARSE_EMIN:
+            fprintf(stream, "Argument '%s' is below the minimum", error->argument);
+
+            if (optionBounded(option))
+            {
+                fprintf(stream, " of ");
+                writeBound(stream, option, &option->min);
+            }
+
+            fprintf(stream, "\n");
+            break;
+        case PARSE_EMAX:
+            fprintf(stream, "Argument '%s' is above the maximum", error->argument);
+
+            if (optionBounded(option))
+            {
+                fprintf(stream, " of ");
+                writeBound(stream, option, &option->max);
+            }
+
+            fprintf(stream, "\n");
+            break;
+        case PARSE_ERANGE:
+            fprintf(stream, "Argument '%s' is out of range\n", error->argument);
+            break;
+        case PARSE_EEND:
+            fprintf(stream, "Trailing characters in %s '%s'\n", OPTION_TYPE_NAMES[option->type], error->argument);
+            break;
+        case PARSE_EBASE:
+            fprintf(stream, "Invalid base %d\n", option->arg);
+            break;
+        case PARSE_EFORM:
+            fprintf(stream, "Invalid %s '%s'\n", OPTION_TYPE_NAMES[option->type], error->argument);
+            break;
+        default:
+            fprintf(stream, "Cannot parse '%s'\n", error->argument);
+            break;
+    }
+}
+
+
+/* Option named by the `length` characters of `name` */
+static const Option *findLong(const Option *options, size_t n, const char *name, size_t length)
+{
+    for (size_t o = 0; o < n; ++o)
+    {
+        if (options[o].name && strncmp(options[o].name, name, length) == 0 && options[o].name[length] == '\0')
+            return &options[o];
+    }
+
+    return NULL;
+}
+
+
+static const Option *findShort(const Option *options, size_t n, char key)
+{
+    if (key == '\0')
+        return NULL;
+
+    for (size_t o = 0; o < n; ++o)
+    {
+        if (options[o].key == key)
+            return &options[o];
+    }
+
+    return NULL;
+}
+
+
+/* Parse an option's argument into its target, a trailing remainder being PARSE_EEND */
+static ParseErr optionSet(const Option *option, char *argument)
+{
+    bool bounded = optionBounded(option);
+    const OptionBound *min = &option->min;
+    const OptionBound *max = &option->max;
+    char *endptr = argument;
+    ParseErr parseError;
+
+    switch (option->type)
+    {
+        case OPTION_FLAG:
+            *(bool *) option->target = true;
+            return PARSE_SUCCESS;
+        case OPTION_STRING:
+            *(char **) option->target = argument;
+            return PARSE_SUCCESS;
+        case OPTION_ULONG:
+            parseError = stringToULong(option->target, argument, bounded ? min->ulong : 0,
+                                       bounded ? max->ulong : ULONG_MAX, &endptr, option->arg);
+            break;
+        case OPTION_UINTMAX:
+            parseError = stringToUIntMax(option->target, argument, bounded ? min->uintmax : 0,
+                                         bounded ? max->uintmax : UINTMAX_MAX, &endptr, option->arg);
+            break;
+        case OPTION_DOUBLE:
+            parseError = stringToDouble(option->target, argument, bounded ? min->real : -(DBL_MAX),
+                                        bounded ? max->real : DBL_MAX, &endptr);
+            break;
+        case OPTION_DOUBLEL:
+            parseError = stringToDoubleL(option->target, argument, bounded ? min->realL : -(LDBL_MAX),
+                                         bounded ? max->realL : LDBL_MAX, &endptr);
+            break;
+        case OPTION_COMPLEX_PART:
+        {
+            OptionComplexPart *target = option->target;
+
+            parseError = stringToComplexPart(&target->value, argument, CMPLX_MIN, CMPLX_MAX, &endptr, &target->part);
+            break;
+        }
+        case OPTION_COMPLEX:
+            parseError = stringToComplex(option->target, argument, CMPLX_MIN, CMPLX_MAX, &endptr);
+            break;
+        case OPTION_MEMORY:
+            parseError = stringToMemory(option->target, argument, bounded ? min->memory : 0,
+                                        bounded ? max->memory : SIZE_MAX, &endptr, option->arg);
+            break;
+        case OPTION_DURATION:
+            parseError = stringToDuration(option->target, argument, bounded ? min->ns : INT64_MIN,
+                                          bounded ? max->ns : INT64_MAX, &endptr);
+            break;
+        case OPTION_TIMESTAMP:
+            parseError = stringToTimestamp(option->target, argument, bounded ? min->ns : INT64_MIN,
+                                           bounded ? max->ns : INT64_MAX, &endptr);
+            break;
+
+        #ifdef MP_PREC
+        case OPTION_MPFR:
+            parseError = stringToMPFRAuto(*(mpfr_t *) option->target, argument, NULL, NULL, &endptr, 0, MPFR_RNDN,
+                                          option->arg);
+            break;
+        case OPTION_MPC:
+            parseError = stringToComplexMPCAuto(*(mpc_t *) option->target, argument, NULL, NULL, &endptr, 0,
+                                                option->arg, MPC_RNDNN);
+            break;
+        #endif
+
+        default:
+            return PARSE_EERR;
+    }
+
+    if (parseError == PARSE_SUCCESS && *endptr != '\0')
+        return PARSE_EEND;
+
+    return parseError;
+}
+
+
+/* Whether an option has bounds of its own, rather than the full range of its type */
+static bool optionBounded(const Option *option)
+{
+    switch (option->type)
+    {
+        case OPTION_ULONG:
+            return option->min.ulong || option->max.ulong;
+        case OPTION_UINTMAX:
+            return option->min.uintmax || option->max.uintmax;
+        case OPTION_DOUBLE:
+            return option->min.real != 0.0 || option->max.real != 0.0;
+        case OPTION_DOUBLEL:
+            return option->min.realL != 0.0L || option->max.realL != 0.0L;
+        case OPTION_MEMORY:
+            return option->min.memory || option->max.memory;
+        case OPTION_DURATION:
+        case OPTION_TIMESTAMP:
+            return option->min.ns || option->max.ns;
+        default:
+            return false;
+    }
+}
+
+
+static void writeBound(FILE *stream, const Option *option, const OptionBound *bound)
+{
+    switch (option->type)
+    {
+        case OPTION_ULONG:
+            fprintf(stream, "%lu", bound->ulong);
+            break;
+        case OPTION_UINTMAX:
+            fprintf(stream, "%" PRIuMAX, bound->uintmax);
+            break;
+        case OPTION_DOUBLE:
+            fprintf(stream, "%g", bound->real);
+            break;
+        case OPTION_DOUBLEL:
+            fprintf(stream, "%Lg", bound->realL);
+            break;
+        case OPTION_MEMORY:
+            fprintf(stream, "%zu bytes", bound->memory);
+            break;
+        case OPTION_DURATION:
+            fprintf(stream, "%" PRId64 " ns", bound->ns);
+            break;
+        case OPTION_TIMESTAMP:
+            fprintf(stream, "%" PRId64 " ns since the epoch", bound->ns);
+            break;
+        default:
+            break;
+    }
+}
@@ -1,3 +1,4 @@
+#include "unprofiled.h"
 #include "parser.h"
 
 #include <assert.h>
@@ -19,6 +20,8 @@
 #include <mpc.h>
 #endif
 
+#include "tally.h"
+
 
 /* Minimum/maximum possible complex values */
 const complex CMPLX_MIN = -(DBL_MAX) - DBL_MAX * I;
@@ -32,12 +35,21 @@ const long double complex LCMPLX_MAX = LDBL_MAX + LDBL_MAX * I;
 /* Symbol to denote the imaginary unit (case-insensitive) */
 static const char IMAGINARY_UNIT = 'i';
 
+/* UTF-8 angle and degree symbols of polar complex numbers */
+static const char POLAR_ANGLE[] = "\xE2\x88\xA0";
+static const char POLAR_DEGREE[] = "\xC2\xB0";
+
 
 static int parseMemoryUnit(char *str, char **endptr);
 static int parseSign(char *c, char **endptr);
 static ComplexPt parseImaginaryUnit(char *c, char **endptr);
+static ParseErr parseComplexTerm(double *x, char *c, char **endptr, const char *units, bool spaced,
+                                 ComplexPt *type);
+static ParseErr parsePolar(complex *z, double r, char *c, char **endptr);
 
 #ifdef MP_PREC
+static ParseErr parsePartMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base, mpc_rnd_t rnd,
+                             int operator, ComplexPt exclude, ComplexPt *type);
 static mpfr_rnd_t getReMPFRRound(mpc_rnd_t rnd);
 static mpfr_rnd_t getImMPFRRound(mpc_rnd_t rnd);
 #endif
@@ -511,6 +523,172 @@ ParseErr stringToComplexL(long double complex *z, char *nptr, long double comple
 }
 
 
+/* 
+ * Parse a complex number string written in any of the selected dialects into
+ * a complex variable, in a single pass
+ * 
+ * `dialects` is a combination of:
+ *   - DIALECT_STANDARD: "a + bi" or "bi + a", as stringToComplex()
+ *   - DIALECT_PYTHON: "(a+bj)", with the parentheses optional
+ *   - DIALECT_FORTRAN: "(a,b)", as also used in CSV exports
+ *   - DIALECT_MATLAB: "a+bi" or "a+bj"
+ *   - DIALECT_POLAR: "r∠θ", with θ in radians, or in degrees if followed by
+ *     '°'
+ * or DIALECT_ANY for all of them. Units are case-insensitive. As with
+ * stringToComplex(), either part of the Cartesian forms may be omitted, and
+ * `min`/`max` bound the real and imaginary parts independently
+ */
+ParseErr stringToComplexDialect(complex *z, char *nptr, complex min, complex max, char **endptr, int dialects)
+{
+    char units[5] = {'\0'};
+    size_t unitCount = 0;
+
+    ComplexPt firstType, secondType;
+    double x, y;
+    char *partEndptr;
+    int operator;
+    bool paren = false;
+    bool spaced = (dialects & DIALECT_STANDARD) != 0;
+
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    if (dialects & (DIALECT_STANDARD | DIALECT_MATLAB))
+    {
+        units[unitCount++] = 'i';
+        units[unitCount++] = 'I';
+    }
+
+    if (dialects & (DIALECT_PYTHON | DIALECT_MATLAB))
+    {
+        units[unitCount++] = 'j';
+        units[unitCount++] = 'J';
+    }
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    *z = 0.0 + 0.0 * I;
+
+    if (**endptr == '(' && dialects & (DIALECT_PYTHON | DIALECT_FORTRAN))
+    {
+        paren = true;
+        ++(*endptr);
+    }
+
+    /* Get first operand in complex number */
+    parseError = parseComplexTerm(&x, *endptr, endptr, units, spaced, &firstType);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    partEndptr = *endptr;
+
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    if (firstType == COMPLEX_REAL && paren && dialects & DIALECT_FORTRAN && **endptr == ',')
+    {
+        /* Fortran "(a,b)" takes both parts without units */
+        parseError = parseComplexTerm(&y, *endptr + 1, endptr, "", false, &secondType);
+
+        if (parseError != PARSE_SUCCESS)
+            return (parseError == PARSE_ERANGE) ? PARSE_ERANGE : PARSE_EFORM;
+
+        *z = x + y * I;
+    }
+    else if (firstType == COMPLEX_REAL && dialects & DIALECT_POLAR
+             && !strncmp(*endptr, POLAR_ANGLE, sizeof(POLAR_ANGLE) - 1))
+    {
+        parseError = parsePolar(z, x, *endptr + sizeof(POLAR_ANGLE) - 1, endptr);
+
+        if (parseError != PARSE_SUCCESS)
+            return parseError;
+    }
+    else
+    {
+        if (firstType == COMPLEX_REAL)
+            *z = x + 0.0 * I;
+        else
+            *z = 0.0 + x * I;
+
+        /* Get operator between the two parts */
+        operator = parseSign(*endptr, endptr);
+
+        if (operator)
+        {
+            parseError = parseComplexTerm(&y, *endptr, endptr, units, spaced, &secondType);
+
+            if (parseError != PARSE_SUCCESS || secondType == firstType)
+                operator = 0;
+            else if (secondType == COMPLEX_REAL)
+                *z = operator * y + cimag(*z) * I;
+            else
+                *z = creal(*z) + operator * y * I;
+        }
+
+        /* Only the first part was valid */
+        if (!operator)
+        {
+            if (paren)
+                return PARSE_EFORM;
+
+            *endptr = partEndptr;
+        }
+    }
+
+    if (paren)
+    {
+        while (isspace(**endptr))
+            ++(*endptr);
+
+        if (**endptr != ')')
+            return PARSE_EFORM;
+
+        ++(*endptr);
+    }
+
+    /* Range checks */
+    if (creal(*z) < creal(min) || cimag(*z) < cimag(min))
+        return PARSE_EMIN;
+    else if (creal(*z) > creal(max) || cimag(*z) > cimag(max))
+        return PARSE_EMAX;
+
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/* 
+ * Parse `n` complex number strings with stringToComplexDialect(), storing the
+ * result of each in `errors` (if not NULL). Return the number that failed
+ */
+size_t stringToComplexDialectBatch(complex *z, ParseErr *errors, char **nptrs, size_t n, complex min, complex max,
+                                      int dialects)
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        char *endptr;
+        ParseErr parseError = stringToComplexDialect(&z[i], nptrs[i], min, max, &endptr, dialects);
+
+        if (errors)
+            errors[i] = parseError;
+
+        if (parseError != PARSE_SUCCESS)
+            ++failed;
+
+        STATS_VALUE(parseError, endptr - nptrs[i]);
+    }
+
+    STATS_PUBLISH();
+
+    return failed;
+}
+
+
 /* 
  * Parse a positive double with optional memory unit suffix (if omitted,
  * magnitude will be that of the magnitude argument) into a size_t value
@@ -565,6 +743,61 @@ ParseErr stringToMemory(size_t *bytes, char *nptr, size_t min, size_t max, char
 }
 
 
+/* 
+ * Parse a string into the type selected by `type`, over that type's full
+ * range. `arg` is the base of integer types or the default magnitude of
+ * memory values, and is ignored by everything else
+ */
+ParseErr stringToValue(void *x, char *nptr, char **endptr, ValueType type, int arg)
+{
+    switch (type)
+    {
+        case VALUE_ULONG:
+            return stringToULong(x, nptr, 0, ULONG_MAX, endptr, arg);
+        case VALUE_UINTMAX:
+            return stringToUIntMax(x, nptr, 0, UINTMAX_MAX, endptr, arg);
+        case VALUE_DOUBLE:
+            return stringToDouble(x, nptr, -(DBL_MAX), DBL_MAX, endptr);
+        case VALUE_DOUBLEL:
+            return stringToDoubleL(x, nptr, -(LDBL_MAX), LDBL_MAX, endptr);
+        case VALUE_COMPLEX:
+            return stringToComplex(x, nptr, CMPLX_MIN, CMPLX_MAX, endptr);
+        case VALUE_COMPLEXL:
+            return stringToComplexL(x, nptr, LCMPLX_MIN, LCMPLX_MAX, endptr);
+        case VALUE_MEMORY:
+            return stringToMemory(x, nptr, 0, SIZE_MAX, endptr, arg);
+        default:
+            *endptr = nptr;
+            return PARSE_EERR;
+    }
+}
+
+
+/* Size in bytes of the variable parsed into for a given value type */
+size_t valueSize(ValueType type)
+{
+    switch (type)
+    {
+        case VALUE_ULONG:
+            return sizeof(unsigned long);
+        case VALUE_UINTMAX:
+            return sizeof(uintmax_t);
+        case VALUE_DOUBLE:
+            return sizeof(double);
+        case VALUE_DOUBLEL:
+            return sizeof(long double);
+        case VALUE_COMPLEX:
+            return sizeof(complex);
+        case VALUE_COMPLEXL:
+            return sizeof(long double complex);
+        case VALUE_MEMORY:
+            return sizeof(size_t);
+        default:
+            return 0;
+    }
+}
+
+
 #ifdef MP_PREC
 /* Convert string to MPFR floating-point and handle errors */
 ParseErr stringToMPFR(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd)
@@ -616,121 +849,17 @@ ParseErr stringToMPFR(mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endpt
  *   - The operator can be '+' or '-'
  *   - It can be preceded by an optional '+' or '-' sign
  *   - An imaginary number must be followed by the imaginary unit
+ *
+ * The part is converted directly into its component of `z`, at that
+ * component's precision (`prec` is no longer needed), and the other component
+ * is left unchanged, even on error
  */
 ParseErr stringToComplexPartMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr,
                                    int base, mpfr_prec_t prec, mpc_rnd_t rnd, ComplexPt *type)
 {
-    mpfr_t x;
-    int sign;
-    ParseErr parseError;
-
-    char *tmpptr;
-    mpfr_rnd_t mpfrRnd;
-
-    *endptr = nptr;
-
-    /* Get pointer to start of number */
-    while (isspace(**endptr))
-        ++(*endptr);
-
-    /* 
-     * Manually parsing the sign enables detection of a complex unit lacking in
-     * a coefficient but having a '+'/'-' sign
-     */
-    sign = parseSign(*endptr, endptr);
-
-    if (!sign)
-        sign = 1;
-
-    /*
-     * Because the sign has been manually parsed, error on a second sign, which
-     * gmp_sscanf() will not detect
-     */
-    if (parseSign(*endptr, endptr))
-        return PARSE_EFORM;
-
-    mpfr_init2(x, prec);
-
-    /* Do a dummy read of the number to apply correct rounding mode */
-    tmpptr = *endptr;
-    stringToMPFR(x, *endptr, NULL, NULL, endptr, base, MPFR_RNDN);
-
-    if (parseImaginaryUnit(*endptr, endptr) == COMPLEX_IMAGINARY)
-        mpfrRnd = getImMPFRRound(rnd);
-    else
-        mpfrRnd = getReMPFRRound(rnd);
-    
-    if (mpfrRnd == MPFR_RNDA)
-    {
-        mpfr_clear(x);
-        return PARSE_EERR;
-    }
-
-    *endptr = tmpptr;
-    parseError = stringToMPFR(x, *endptr, NULL, NULL, endptr, base, mpfrRnd);
-
-    if (parseError == PARSE_EERR || parseError == PARSE_EFORM)
-    {
-        if (toupper(**endptr) != toupper(IMAGINARY_UNIT))
-        {
-            mpfr_clear(x);
-            return PARSE_EFORM;
-        }
-
-        /* Failed conversion must be an imaginary unit without coefficient */
-        mpfr_set_d(x, 1.0, mpfrRnd);
-    }
-    else if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
-    {
-        mpfr_clear(x);
-        return parseError;
-    }
-
-    if (sign == -1)
-        mpfr_neg(x, x, mpfrRnd);
-
-    *type = parseImaginaryUnit(*endptr, endptr);
-
-    switch(*type)
-    {
-        case COMPLEX_REAL:
-            if (min && mpfr_cmp(x, mpc_realref(min)) < 0)
-            {
-                mpfr_clear(x);
-                return PARSE_EMIN;
-            }
-            else if (max && mpfr_cmp(x, mpc_realref(max)) > 0)
-            {
-                mpfr_clear(x);
-                return PARSE_EMAX;
-            }
+    (void) prec;
 
-            mpc_set_fr_fr(z, x, mpc_imagref(z), rnd);
-
-            break;
-        case COMPLEX_IMAGINARY:
-            if (min && mpfr_cmp(x, mpc_imagref(min)) < 0)
-            {
-                mpfr_clear(x);
-                return PARSE_EMIN;
-            }
-            else if (max && mpfr_cmp(x, mpc_imagref(max)) > 0)
-            {
-                mpfr_clear(x);
-                return PARSE_EMAX;
-            }
-
-            mpc_set_fr_fr(z, mpc_realref(z), x, rnd);
-
-            break;
-        default:
-            mpfr_clear(x);
-            return PARSE_EERR;
-    }
-
-    mpfr_clear(x);
-
-    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+    return parsePartMPC(z, nptr, min, max, endptr, base, rnd, 1, COMPLEX_NONE, type);
 }
 
 
@@ -752,12 +881,13 @@ ParseErr stringToComplexPartMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char
 ParseErr stringToComplexMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr,
                                int base, mpfr_prec_t prec, mpc_rnd_t rnd)
 {
-    ComplexPt firstType, secondType;
+    ComplexPt firstType, secondType = COMPLEX_NONE;
     char *partEndptr;
     int operator;
-    mpc_t secondZPart;
 
     ParseErr parseError;
+
+    (void) prec;
  
     *endptr = nptr;
 
@@ -768,7 +898,7 @@ ParseErr stringToComplexMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **en
     mpc_set_d_d(z, 0.0, 0.0, rnd);
 
     /* Get first operand in complex number */
-    parseError = stringToComplexPartMPC(z, *endptr, min, max, endptr, base, prec, rnd, &firstType);
+    parseError = parsePartMPC(z, *endptr, min, max, endptr, base, rnd, 1, COMPLEX_NONE, &firstType);
 
     if (parseError == PARSE_SUCCESS)
         return PARSE_SUCCESS;
@@ -791,45 +921,24 @@ ParseErr stringToComplexMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **en
         return PARSE_EEND;
     }
 
-    mpc_init2(secondZPart, prec);
-
-    /* Get second operand in complex number */
-    parseError = stringToComplexPartMPC(secondZPart, *endptr, min, max, endptr, base, prec, rnd, &secondType);
+    /*
+     * Get second operand in complex number, straight into its component of z.
+     * One of the same type as the first is rejected before it is converted
+     */
+    parseError = parsePartMPC(z, *endptr, min, max, endptr, base, rnd, operator, firstType, &secondType);
 
     if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
     {
-        *endptr = partEndptr;
-        mpc_clear(secondZPart);
-        return PARSE_EEND;
-    }
+        /* The missing part is zero, whatever the failed conversion left */
+        if (secondType == COMPLEX_REAL && firstType != COMPLEX_REAL)
+            mpfr_set_zero(mpc_realref(z), 1);
+        else if (secondType == COMPLEX_IMAGINARY && firstType != COMPLEX_IMAGINARY)
+            mpfr_set_zero(mpc_imagref(z), 1);
 
-    if (firstType == secondType)
-    {
         *endptr = partEndptr;
-        mpc_clear(secondZPart);
         return PARSE_EEND;
     }
 
-    if (operator == -1)
-        mpc_neg(secondZPart, secondZPart, rnd);
-
-    /* Set correct part of z, dependent on the first parsed part's type */
-    switch (secondType)
-    {
-        case COMPLEX_REAL:
-            mpc_set_fr_fr(z, mpc_realref(secondZPart), mpc_imagref(z), rnd);
-            break;
-        case COMPLEX_IMAGINARY:
-            mpc_set_fr_fr(z, mpc_realref(z), mpc_imagref(secondZPart), rnd);
-            break;
-        default:
-            *endptr = partEndptr;
-            mpc_clear(secondZPart);
-            return PARSE_EEND;
-    }
-
-    mpc_clear(secondZPart);
-
     return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
 }
 #endif
@@ -934,7 +1043,222 @@ static ComplexPt parseImaginaryUnit(char *c, char **endptr)
 }
 
 
+/* 
+ * Parse one term of a complex number: an optional sign, then a coefficient
+ * and/or one of the imaginary unit characters in `units`. If `spaced`, an
+ * 'i' or 'I' unit may be preceded by whitespace, as in stringToComplex()
+ */
+static ParseErr parseComplexTerm(double *x, char *c, char **endptr, const char *units, bool spaced,
+                                 ComplexPt *type)
+{
+    char *numptr, *unitptr;
+    int sign;
+
+    sign = parseSign(c, endptr);
+
+    if (!sign)
+        sign = 1;
+
+    if (parseSign(*endptr, endptr))
+        return PARSE_EFORM;
+
+    numptr = *endptr;
+    errno = 0;
+    *x = strtod(numptr, endptr);
+
+    if (*endptr == numptr)
+    {
+        if (**endptr == '\0' || !strchr(units, **endptr))
+            return PARSE_EFORM;
+
+        /* Failed conversion must be an imaginary unit without coefficient */
+        *x = 1.0;
+    }
+    else if (errno == ERANGE)
+    {
+        return PARSE_ERANGE;
+    }
+
+    *x *= sign;
+
+    unitptr = *endptr;
+
+    if (spaced)
+    {
+        while (isspace(*unitptr))
+            ++unitptr;
+
+        if (toupper(*unitptr) != toupper(IMAGINARY_UNIT))
+            unitptr = *endptr;
+    }
+
+    if (*unitptr != '\0' && strchr(units, *unitptr))
+    {
+        *endptr = unitptr + 1;
+        *type = COMPLEX_IMAGINARY;
+    }
+    else
+    {
+        *type = COMPLEX_REAL;
+    }
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Parse the angle of a polar complex number (after the angle symbol) and
+ * convert it with magnitude `r`. Whole multiples of 90 degrees are exact
+ */
+static ParseErr parsePolar(complex *z, double r, char *c, char **endptr)
+{
+    const double PI = 3.14159265358979323846;
+
+    double theta, sinTheta, cosTheta;
+    ComplexPt type;
+    ParseErr parseError;
+
+    parseError = parseComplexTerm(&theta, c, endptr, "", false, &type);
+
+    if (parseError != PARSE_SUCCESS)
+        return (parseError == PARSE_ERANGE) ? PARSE_ERANGE : PARSE_EFORM;
+
+    if (!strncmp(*endptr, POLAR_DEGREE, sizeof(POLAR_DEGREE) - 1))
+    {
+        double quadrant;
+
+        *endptr += sizeof(POLAR_DEGREE) - 1;
+
+        theta = fmod(theta, 360.0);
+        quadrant = theta / 90.0;
+
+        if (quadrant == floor(quadrant))
+        {
+            const double SIN[] = {0.0, 1.0, 0.0, -1.0};
+            int q = ((int) quadrant + 4) % 4;
+
+            *z = r * SIN[(q + 1) % 4] + r * SIN[q] * I;
+            return PARSE_SUCCESS;
+        }
+
+        theta *= PI / 180.0;
+    }
+
+    /* Adjacent sin() and cos() of the same angle are fused into sincos() */
+    sinTheta = sin(theta);
+    cosTheta = cos(theta);
+
+    *z = r * cosTheta + r * sinTheta * I;
+
+    return PARSE_SUCCESS;
+}
+
+
 #ifdef MP_PREC
+/*
+ * Parse a real or imaginary part, negated if `operator` is -1, directly into
+ * its component of `z`, leaving the other unchanged. The number is first read
+ * at the least precision into a stack variable, to find its end and so the
+ * imaginary unit deciding the component and rounding mode without allocating.
+ * A part of type `exclude` returns PARSE_EFORM before `z` is written
+ */
+static ParseErr parsePartMPC(mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base, mpc_rnd_t rnd,
+                             int operator, ComplexPt exclude, ComplexPt *type)
+{
+    mp_limb_t probeLimbs[1];
+    mpfr_t probe;
+
+    mpfr_ptr x, xMin = NULL, xMax = NULL;
+    mpfr_rnd_t mpfrRnd;
+    char *start, *end;
+    int sign;
+    ParseErr parseError;
+
+    *endptr = nptr;
+
+    /* Get pointer to start of number */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    /* 
+     * Manually parsing the sign enables detection of a complex unit lacking in
+     * a coefficient but having a '+'/'-' sign
+     */
+    sign = parseSign(*endptr, endptr);
+
+    if (!sign)
+        sign = 1;
+
+    /*
+     * Because the sign has been manually parsed, error on a second sign, which
+     * mpfr_strtofr() will not detect
+     */
+    if (parseSign(*endptr, endptr))
+        return PARSE_EFORM;
+
+    /* Do a dummy read of the number to find the part's type */
+    start = *endptr;
+    mpfr_custom_init(probeLimbs, MPFR_PREC_MIN);
+    mpfr_custom_init_set(probe, MPFR_ZERO_KIND, 0, MPFR_PREC_MIN, probeLimbs);
+    stringToMPFR(probe, start, NULL, NULL, &end, base, MPFR_RNDN);
+
+    *type = parseImaginaryUnit(end, endptr);
+
+    /* Without a number, only an imaginary unit is valid */
+    if ((end == start && *type != COMPLEX_IMAGINARY) || *type == exclude)
+    {
+        *endptr = start;
+        return PARSE_EFORM;
+    }
+
+    switch (*type)
+    {
+        case COMPLEX_REAL:
+            x = mpc_realref(z);
+            xMin = min ? mpc_realref(min) : NULL;
+            xMax = max ? mpc_realref(max) : NULL;
+            mpfrRnd = getReMPFRRound(rnd);
+            break;
+        case COMPLEX_IMAGINARY:
+            x = mpc_imagref(z);
+            xMin = min ? mpc_imagref(min) : NULL;
+            xMax = max ? mpc_imagref(max) : NULL;
+            mpfrRnd = getImMPFRRound(rnd);
+            break;
+        default:
+            return PARSE_EERR;
+    }
+
+    if (mpfrRnd == MPFR_RNDA)
+        return PARSE_EERR;
+
+    /* An imaginary unit without coefficient */
+    if (end == start)
+    {
+        mpfr_set_d(x, 1.0, mpfrRnd);
+    }
+    else
+    {
+        parseError = stringToMPFR(x, start, NULL, NULL, &end, base, mpfrRnd);
+
+        if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
+            return parseError;
+    }
+
+    if (sign * operator == -1)
+        mpfr_neg(x, x, mpfrRnd);
+
+    /* Range checks */
+    if (xMin && mpfr_cmp(x, xMin) < 0)
+        return PARSE_EMIN;
+    else if (xMax && mpfr_cmp(x, xMax) > 0)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
 /* Get real rounding mode from MPC mode */
 static mpfr_rnd_t getReMPFRRound(mpc_rnd_t rnd)
 {
@@ -0,0 +1,416 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "unprofiled.h"
+#include "pipeline.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "block.h"
+#include "parser.h"
+
+
+/* Defaults for zeroed configuration fields */
+#define PIPELINE_BLOCK_SIZE 65536
+#define PIPELINE_BLOCKS_PER_PARSER 4
+
+/* Assumed cache line size, used to keep ring indices apart */
+#define CACHE_LINE 64
+
+
+/*
+ * Lock-free single-producer/single-consumer ring of block pointers. `head` is
+ * only written by the consumer and `tail` only by the producer, each on its
+ * own cache line
+ */
+struct Ring
+{
+    size_t head;
+    char headPad[CACHE_LINE - sizeof(size_t)];
+
+    size_t tail;
+    char tailPad[CACHE_LINE - sizeof(size_t)];
+
+    Block **slots;
+    size_t mask;
+};
+
+struct ParserStage
+{
+    Pipeline *pipeline;
+    unsigned int index;
+};
+
+struct PercyPipeline
+{
+    PipelineConfig config;
+
+    /* Every block owned by the pipeline, recycled between runs */
+    Block **pool;
+
+    /* Writer -> reader: blocks free for reuse */
+    struct Ring freeRing;
+
+    /* Reader -> parser i and parser i -> writer */
+    struct Ring *inRings;
+    struct Ring *outRings;
+
+    /* Partial token carried between blocks by the reader */
+    char *carry;
+
+    pthread_t *threads;
+    struct ParserStage *stages;
+
+    PipelineWriter writer;
+    void *writerArg;
+
+    /* Set by the writer when its callback asks to stop */
+    int abort;
+};
+
+
+static bool ringInit(struct Ring *ring, size_t capacity);
+static void ringReset(struct Ring *ring);
+static void ringPush(struct Ring *ring, Block *block);
+static Block *ringPop(struct Ring *ring);
+
+static ParseErr readerStage(Pipeline *pipeline, PipelineReader reader, void *arg);
+static void *parserStage(void *arg);
+static void *writerStage(void *arg);
+
+
+/*
+ * Create a pipeline of one reader, `config->parsers` parser stages and one
+ * ordered writer. Zeroed configuration fields take their defaults. All blocks
+ * are allocated up front; the reader blocks when none are free, which bounds
+ * memory use and applies backpressure to the input
+ */
+Pipeline *pipelineCreate(const PipelineConfig *config)
+{
+    Pipeline *pipeline;
+    size_t capacity = 1;
+    unsigned int parsers;
+
+    if (valueSize(config->type) == 0)
+        return NULL;
+
+    pipeline = calloc(1, sizeof(*pipeline));
+
+    if (!pipeline)
+        return NULL;
+
+    pipeline->config = *config;
+
+    if (pipeline->config.parsers == 0)
+        pipeline->config.parsers = 1;
+
+    if (pipeline->config.blockSize == 0)
+        pipeline->config.blockSize = PIPELINE_BLOCK_SIZE;
+
+    if (pipeline->config.blocks == 0)
+        pipeline->config.blocks = (size_t) pipeline->config.parsers * PIPELINE_BLOCKS_PER_PARSER;
+
+    parsers = pipeline->config.parsers;
+
+    /* Each ring must hold every block plus an end-of-input marker */
+    while (capacity < pipeline->config.blocks + 1)
+        capacity <<= 1;
+
+    pipeline->pool = calloc(pipeline->config.blocks, sizeof(*pipeline->pool));
+    pipeline->inRings = calloc(parsers, sizeof(*pipeline->inRings));
+    pipeline->outRings = calloc(parsers, sizeof(*pipeline->outRings));
+    pipeline->carry = malloc(pipeline->config.blockSize);
+    pipeline->threads = calloc((size_t) parsers + 1, sizeof(*pipeline->threads));
+    pipeline->stages = calloc(parsers, sizeof(*pipeline->stages));
+
+    if (!pipeline->pool || !pipeline->inRings || !pipeline->outRings || !pipeline->carry
+        || !pipeline->threads || !pipeline->stages || !ringInit(&pipeline->freeRing, capacity))
+    {
+        pipelineDestroy(pipeline);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < parsers; ++i)
+    {
+        if (!ringInit(&pipeline->inRings[i], capacity) || !ringInit(&pipeline->outRings[i], capacity))
+        {
+            pipelineDestroy(pipeline);
+            return NULL;
+        }
+
+        pipeline->stages[i].pipeline = pipeline;
+        pipeline->stages[i].index = i;
+    }
+
+    for (size_t i = 0; i < pipeline->config.blocks; ++i)
+    {
+        pipeline->pool[i] = blockCreate(pipeline->config.blockSize, pipeline->config.type);
+
+        if (!pipeline->pool[i])
+        {
+            pipelineDestroy(pipeline);
+            return NULL;
+        }
+
+        ringPush(&pipeline->freeRing, pipeline->pool[i]);
+    }
+
+    return pipeline;
+}
+
+
+/* Free a pipeline and all of its blocks. It must not be running */
+void pipelineDestroy(Pipeline *pipeline)
+{
+    if (!pipeline)
+        return;
+
+    if (pipeline->pool)
+    {
+        for (size_t i = 0; i < pipeline->config.blocks; ++i)
+            blockDestroy(pipeline->pool[i]);
+    }
+
+    if (pipeline->inRings)
+    {
+        for (unsigned int i = 0; i < pipeline->config.parsers; ++i)
+            free(pipeline->inRings[i].slots);
+    }
+
+    if (pipeline->outRings)
+    {
+        for (unsigned int i = 0; i < pipeline->config.parsers; ++i)
+            free(pipeline->outRings[i].slots);
+    }
+
+    free(pipeline->freeRing.slots);
+    free(pipeline->pool);
+    free(pipeline->inRings);
+    free(pipeline->outRings);
+    free(pipeline->carry);
+    free(pipeline->threads);
+    free(pipeline->stages);
+    free(pipeline);
+}
+
+
+/*
+ * Run the pipeline until the reader reaches end of input. The reader stage
+ * runs on the calling thread; parser and writer stages get their own threads.
+ * Block `n` is parsed by parser `n % parsers`, and the writer collects them
+ * back in that order, so output order always matches input order
+ *
+ * Returns:
+ *   - PARSE_SUCCESS when all input was read and written
+ *   - PARSE_EERR if either callback aborted the run, or a thread could not be
+ *     started
+ *   - PARSE_EFORM if a single token was longer than a whole block
+ */
+ParseErr pipelineRun(Pipeline *pipeline, PipelineReader reader, void *readerArg,
+                        PipelineWriter writer, void *writerArg)
+{
+    unsigned int parsers = pipeline->config.parsers;
+    unsigned int started;
+    bool writerStarted;
+    ParseErr parseError;
+
+    pipeline->writer = writer;
+    pipeline->writerArg = writerArg;
+    __atomic_store_n(&pipeline->abort, 0, __ATOMIC_RELAXED);
+
+    for (started = 0; started < parsers; ++started)
+    {
+        if (pthread_create(&pipeline->threads[started], NULL, parserStage, &pipeline->stages[started]))
+            break;
+    }
+
+    writerStarted = started == parsers
+                    && !pthread_create(&pipeline->threads[parsers], NULL, writerStage, pipeline);
+
+    if (writerStarted)
+    {
+        parseError = readerStage(pipeline, reader, readerArg);
+    }
+    else
+    {
+        /* Wind down whichever parser stages did start */
+        for (unsigned int i = 0; i < started; ++i)
+            ringPush(&pipeline->inRings[i], NULL);
+
+        parseError = PARSE_EERR;
+    }
+
+    for (unsigned int i = 0; i < started; ++i)
+        pthread_join(pipeline->threads[i], NULL);
+
+    if (writerStarted)
+        pthread_join(pipeline->threads[parsers], NULL);
+
+    if (parseError == PARSE_SUCCESS && __atomic_load_n(&pipeline->abort, __ATOMIC_RELAXED))
+        parseError = PARSE_EERR;
+
+    /* Return every block to the free ring, ready for the next run */
+    for (unsigned int i = 0; i < parsers; ++i)
+    {
+        ringReset(&pipeline->inRings[i]);
+        ringReset(&pipeline->outRings[i]);
+    }
+
+    ringReset(&pipeline->freeRing);
+
+    for (size_t i = 0; i < pipeline->config.blocks; ++i)
+        ringPush(&pipeline->freeRing, pipeline->pool[i]);
+
+    return parseError;
+}
+
+
+/* Allocate a ring of `capacity` slots, which must be a power of two */
+static bool ringInit(struct Ring *ring, size_t capacity)
+{
+    ring->slots = malloc(capacity * sizeof(*ring->slots));
+    ring->mask = capacity - 1;
+    ringReset(ring);
+
+    return ring->slots != NULL;
+}
+
+
+/* Empty a ring. Only safe while no stage is running */
+static void ringReset(struct Ring *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+
+/*
+ * Push a block (or the NULL end-of-input marker), yielding while the ring is
+ * full. Rings are sized so this should never actually wait
+ */
+static void ringPush(struct Ring *ring, Block *block)
+{
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) > ring->mask)
+        sched_yield();
+
+    ring->slots[tail & ring->mask] = block;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+/* Pop the next block, yielding while the ring is empty */
+static Block *ringPop(struct Ring *ring)
+{
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    Block *block;
+
+    while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head)
+        sched_yield();
+
+    block = ring->slots[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return block;
+}
+
+
+/*
+ * Fill free blocks from the reader callback, tokenise them and deal them out
+ * to the parser stages. A token cut off by the end of a block is carried over
+ * to the start of the next one
+ */
+static ParseErr readerStage(Pipeline *pipeline, PipelineReader reader, void *arg)
+{
+    unsigned int parsers = pipeline->config.parsers;
+    uint64_t sequence = 0;
+    size_t carry = 0;
+    bool final = false;
+    ParseErr parseError = PARSE_SUCCESS;
+
+    while (!final)
+    {
+        /* Waits here when every block is in flight */
+        Block *block = ringPop(&pipeline->freeRing);
+
+        if (__atomic_load_n(&pipeline->abort, __ATOMIC_RELAXED))
+            break;
+
+        memcpy(block->data, pipeline->carry, carry);
+        block->length = carry;
+
+        /* Keep reading until there is at least one whole token */
+        parseError = blockFill(block, reader, arg, &final, &carry);
+
+        if (parseError != PARSE_SUCCESS)
+            break;
+
+        if (block->count == 0)
+            continue;
+
+        memcpy(pipeline->carry, block->data + block->length - carry, carry);
+
+        block->sequence = sequence;
+        ringPush(&pipeline->inRings[sequence % parsers], block);
+        ++sequence;
+    }
+
+    for (unsigned int i = 0; i < parsers; ++i)
+        ringPush(&pipeline->inRings[i], NULL);
+
+    return parseError;
+}
+
+
+/* Parse blocks from one input ring until the end-of-input marker */
+static void *parserStage(void *arg)
+{
+    struct ParserStage *stage = arg;
+    Pipeline *pipeline = stage->pipeline;
+    Block *block;
+
+    do
+    {
+        block = ringPop(&pipeline->inRings[stage->index]);
+
+        if (block && !__atomic_load_n(&pipeline->abort, __ATOMIC_RELAXED))
+            blockParse(block, pipeline->config.arg);
+
+        ringPush(&pipeline->outRings[stage->index], block);
+    } while (block);
+
+    return NULL;
+}
+
+
+/* Hand parsed blocks to the writer callback in sequence order, then recycle */
+static void *writerStage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    unsigned int parsers = pipeline->config.parsers;
+
+    for (uint64_t sequence = 0;; ++sequence)
+    {
+        Block *block = ringPop(&pipeline->outRings[sequence % parsers]);
+
+        if (!block)
+            break;
+
+        /* After an abort, keep draining so the reader and parsers can finish */
+        if (!__atomic_load_n(&pipeline->abort, __ATOMIC_RELAXED)
+            && pipeline->writer(block, pipeline->writerArg))
+        {
+            __atomic_store_n(&pipeline->abort, 1, __ATOMIC_RELAXED);
+        }
+
+        ringPush(&pipeline->freeRing, block);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,801 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "profile.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(PERCY_PROFILE) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILE_TSC
+#endif
+
+#include "lexed.h"
+#include "quantity.h"
+
+
+/* First line of a saved profile */
+#define PROFILE_MAGIC "percy-profile 1"
+
+/* Longest function name in a saved profile */
+#define PROFILE_NAME_MAX 64
+
+
+static const char *const PROFILE_NAMES[PROFILE_FUNCTIONS] =
+{
+    [PROFILE_ULONG] = "stringToULong",
+    [PROFILE_UINTMAX] = "stringToUIntMax",
+    [PROFILE_DOUBLE] = "stringToDouble",
+    [PROFILE_DOUBLEL] = "stringToDoubleL",
+    [PROFILE_COMPLEX_PART] = "stringToComplexPart",
+    [PROFILE_COMPLEX_PARTL] = "stringToComplexPartL",
+    [PROFILE_COMPLEX] = "stringToComplex",
+    [PROFILE_COMPLEXL] = "stringToComplexL",
+    [PROFILE_COMPLEX_DIALECT] = "stringToComplexDialect",
+    [PROFILE_COMPLEX_DIALECT_BATCH] = "stringToComplexDialectBatch",
+    [PROFILE_MEMORY] = "stringToMemory",
+    [PROFILE_ULONG_UTF8] = "stringToULongUTF8",
+    [PROFILE_UINTMAX_UTF8] = "stringToUIntMaxUTF8",
+    [PROFILE_DOUBLE_UTF8] = "stringToDoubleUTF8",
+    [PROFILE_DOUBLEL_UTF8] = "stringToDoubleLUTF8",
+    [PROFILE_ULONG_GROUPED] = "stringToULongGrouped",
+    [PROFILE_UINTMAX_GROUPED] = "stringToUIntMaxGrouped",
+    [PROFILE_DOUBLE_GROUPED] = "stringToDoubleGrouped",
+    [PROFILE_ULONG_U16] = "stringToULongU16",
+    [PROFILE_UINTMAX_U16] = "stringToUIntMaxU16",
+    [PROFILE_DOUBLE_U16] = "stringToDoubleU16",
+    [PROFILE_COMPLEX_U16] = "stringToComplexU16",
+    [PROFILE_MEMORY_U16] = "stringToMemoryU16",
+    [PROFILE_ULONG_W] = "stringToULongW",
+    [PROFILE_UINTMAX_W] = "stringToUIntMaxW",
+    [PROFILE_DOUBLE_W] = "stringToDoubleW",
+    [PROFILE_COMPLEX_W] = "stringToComplexW",
+    [PROFILE_MEMORY_W] = "stringToMemoryW",
+    [PROFILE_TIMESTAMP] = "stringToTimestamp",
+    [PROFILE_TIMESTAMP_BATCH] = "stringToTimestampBatch",
+    [PROFILE_DURATION] = "stringToDuration",
+    [PROFILE_DURATION_BATCH] = "stringToDurationBatch",
+    [PROFILE_BYTES] = "stringToBytes",
+    [PROFILE_VALUE] = "stringToValue",
+    [PROFILE_QUANTITY] = "stringToQuantity",
+    [PROFILE_QUANTITYU] = "stringToQuantityU",
+    [PROFILE_LEXED] = "stringToLexed",
+    [PROFILE_MPZ] = "stringToMPZ",
+    [PROFILE_MPQ] = "stringToMPQ",
+    [PROFILE_MPFR] = "stringToMPFR",
+    [PROFILE_MPFR_PARALLEL] = "stringToMPFRParallel",
+    [PROFILE_MPFR_AUTO] = "stringToMPFRAuto",
+    [PROFILE_COMPLEX_PART_MPC] = "stringToComplexPartMPC",
+    [PROFILE_COMPLEX_MPC] = "stringToComplexMPC",
+    [PROFILE_COMPLEX_MPC_AUTO] = "stringToComplexMPCAuto",
+};
+
+
+#ifdef PERCY_PROFILE
+/* One thread's histograms, each allocated on the thread's first call of its function */
+struct ProfileThread
+{
+    struct ProfileThread *next;
+    Histogram *histograms[PROFILE_FUNCTIONS];
+};
+
+
+static pthread_once_t profileOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t profileKey;
+static bool profileReady;
+
+/* Live threads, and the merged histograms of threads that have exited */
+static pthread_mutex_t profileMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct ProfileThread *profileThreads;
+static Profile profileRetired;
+
+/* Clock readings at the first timed call, to calibrate ticks against */
+static uint64_t profileStartTicks;
+static struct timespec profileStartTime;
+
+
+static inline uint64_t profileClock(void);
+static void profileInit(void);
+static struct ProfileThread *profileThread(void);
+static void profileRecord(ProfileFunction function, uint64_t start);
+static void profileExit(void *arg);
+static void profileAtExit(void);
+static double profileCalibrate(void);
+static size_t bucketIndex(uint64_t ticks);
+#endif
+
+static void mergeHistogram(Histogram *into, const Histogram *from);
+static uint64_t bucketUpper(size_t bucket);
+
+
+#ifdef PERCY_PROFILE
+/*
+ * Define `name` as a wrapper timing each call to `nameUnprofiled` (the parser
+ * itself, renamed by unprofiled.h), returning its result
+ */
+#define PROFILED(type, name, id, params, args) \
+    type name##Unprofiled params; \
+    type name params \
+    { \
+        uint64_t start = profileClock(); \
+        type result = name##Unprofiled args; \
+        \
+        profileRecord(id, start); \
+        \
+        return result; \
+    }
+
+
+PROFILED(ParseErr, stringToULong, PROFILE_ULONG,
+         (unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToUIntMax, PROFILE_UINTMAX,
+         (uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToDouble, PROFILE_DOUBLE,
+         (double *x, char *nptr, double min, double max, char **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToDoubleL, PROFILE_DOUBLEL,
+         (long double *x, char *nptr, long double min, long double max, char **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToComplexPart, PROFILE_COMPLEX_PART,
+         (complex *z, char *nptr, complex min, complex max, char **endptr, ComplexPt *type),
+         (z, nptr, min, max, endptr, type))
+PROFILED(ParseErr, stringToComplexPartL, PROFILE_COMPLEX_PARTL,
+         (long double complex *z, char *nptr, long double complex min, long double complex max, char **endptr,
+          ComplexPt *type),
+         (z, nptr, min, max, endptr, type))
+PROFILED(ParseErr, stringToComplex, PROFILE_COMPLEX,
+         (complex *z, char *nptr, complex min, complex max, char **endptr),
+         (z, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToComplexL, PROFILE_COMPLEXL,
+         (long double complex *z, char *nptr, long double complex min, long double complex max, char **endptr),
+         (z, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToComplexDialect, PROFILE_COMPLEX_DIALECT,
+         (complex *z, char *nptr, complex min, complex max, char **endptr, int dialects),
+         (z, nptr, min, max, endptr, dialects))
+PROFILED(size_t, stringToComplexDialectBatch, PROFILE_COMPLEX_DIALECT_BATCH,
+         (complex *z, ParseErr *errors, char **nptrs, size_t n, complex min, complex max, int dialects),
+         (z, errors, nptrs, n, min, max, dialects))
+PROFILED(ParseErr, stringToMemory, PROFILE_MEMORY,
+         (size_t *bytes, char *nptr, size_t min, size_t max, char **endptr, int magnitude),
+         (bytes, nptr, min, max, endptr, magnitude))
+PROFILED(ParseErr, stringToULongUTF8, PROFILE_ULONG_UTF8,
+         (unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToUIntMaxUTF8, PROFILE_UINTMAX_UTF8,
+         (uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToDoubleUTF8, PROFILE_DOUBLE_UTF8,
+         (double *x, char *nptr, double min, double max, char **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToDoubleLUTF8, PROFILE_DOUBLEL_UTF8,
+         (long double *x, char *nptr, long double min, long double max, char **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToULongGrouped, PROFILE_ULONG_GROUPED,
+         (unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr, char separator,
+          bool strict),
+         (x, nptr, min, max, endptr, separator, strict))
+PROFILED(ParseErr, stringToUIntMaxGrouped, PROFILE_UINTMAX_GROUPED,
+         (uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, char separator, bool strict),
+         (x, nptr, min, max, endptr, separator, strict))
+PROFILED(ParseErr, stringToDoubleGrouped, PROFILE_DOUBLE_GROUPED,
+         (double *x, char *nptr, double min, double max, char **endptr, char separator, bool strict),
+         (x, nptr, min, max, endptr, separator, strict))
+PROFILED(ParseErr, stringToULongU16, PROFILE_ULONG_U16,
+         (unsigned long *x, char16_t *nptr, unsigned long min, unsigned long max, char16_t **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToUIntMaxU16, PROFILE_UINTMAX_U16,
+         (uintmax_t *x, char16_t *nptr, uintmax_t min, uintmax_t max, char16_t **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToDoubleU16, PROFILE_DOUBLE_U16,
+         (double *x, char16_t *nptr, double min, double max, char16_t **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToComplexU16, PROFILE_COMPLEX_U16,
+         (complex *z, char16_t *nptr, complex min, complex max, char16_t **endptr),
+         (z, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToMemoryU16, PROFILE_MEMORY_U16,
+         (size_t *bytes, char16_t *nptr, size_t min, size_t max, char16_t **endptr, int magnitude),
+         (bytes, nptr, min, max, endptr, magnitude))
+PROFILED(ParseErr, stringToULongW, PROFILE_ULONG_W,
+         (unsigned long *x, wchar_t *nptr, unsigned long min, unsigned long max, wchar_t **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToUIntMaxW, PROFILE_UINTMAX_W,
+         (uintmax_t *x, wchar_t *nptr, uintmax_t min, uintmax_t max, wchar_t **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToDoubleW, PROFILE_DOUBLE_W,
+         (double *x, wchar_t *nptr, double min, double max, wchar_t **endptr),
+         (x, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToComplexW, PROFILE_COMPLEX_W,
+         (complex *z, wchar_t *nptr, complex min, complex max, wchar_t **endptr),
+         (z, nptr, min, max, endptr))
+PROFILED(ParseErr, stringToMemoryW, PROFILE_MEMORY_W,
+         (size_t *bytes, wchar_t *nptr, size_t min, size_t max, wchar_t **endptr, int magnitude),
+         (bytes, nptr, min, max, endptr, magnitude))
+PROFILED(ParseErr, stringToTimestamp, PROFILE_TIMESTAMP,
+         (int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr),
+         (ns, nptr, min, max, endptr))
+PROFILED(size_t, stringToTimestampBatch, PROFILE_TIMESTAMP_BATCH,
+         (int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max),
+         (ns, errors, nptrs, n, min, max))
+PROFILED(ParseErr, stringToDuration, PROFILE_DURATION,
+         (int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr),
+         (ns, nptr, min, max, endptr))
+PROFILED(size_t, stringToDurationBatch, PROFILE_DURATION_BATCH,
+         (int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max),
+         (ns, errors, nptrs, n, min, max))
+PROFILED(ParseErr, stringToBytes, PROFILE_BYTES,
+         (uint8_t *out, size_t cap, const char *s, size_t len, size_t *bytes, size_t *offset, int separators),
+         (out, cap, s, len, bytes, offset, separators))
+PROFILED(ParseErr, stringToValue, PROFILE_VALUE,
+         (void *x, char *nptr, char **endptr, ValueType type, int arg),
+         (x, nptr, endptr, type, arg))
+PROFILED(ParseErr, stringToQuantity, PROFILE_QUANTITY,
+         (double *x, char *nptr, double min, double max, char **endptr, const QuantityTable *table),
+         (x, nptr, min, max, endptr, table))
+PROFILED(ParseErr, stringToQuantityU, PROFILE_QUANTITYU,
+         (uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, const QuantityTable *table),
+         (x, nptr, min, max, endptr, table))
+PROFILED(ParseErr, stringToLexed, PROFILE_LEXED,
+         (Lexed *number, char *nptr, char **endptr),
+         (number, nptr, endptr))
+
+#ifdef MP_PREC
+PROFILED(ParseErr, stringToMPZ, PROFILE_MPZ,
+         (mpz_t x, char *nptr, mpz_t min, mpz_t max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToMPQ, PROFILE_MPQ,
+         (mpq_t x, char *nptr, mpq_t min, mpq_t max, char **endptr, int base),
+         (x, nptr, min, max, endptr, base))
+PROFILED(ParseErr, stringToMPFR, PROFILE_MPFR,
+         (mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd),
+         (x, nptr, min, max, endptr, base, rnd))
+PROFILED(ParseErr, stringToMPFRParallel, PROFILE_MPFR_PARALLEL,
+         (mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd, unsigned int threads),
+         (x, nptr, min, max, endptr, base, rnd, threads))
+PROFILED(ParseErr, stringToMPFRAuto, PROFILE_MPFR_AUTO,
+         (mpfr_t x, char *nptr, mpfr_t min, mpfr_t max, char **endptr, int base, mpfr_rnd_t rnd, mpfr_prec_t cap),
+         (x, nptr, min, max, endptr, base, rnd, cap))
+PROFILED(ParseErr, stringToComplexPartMPC, PROFILE_COMPLEX_PART_MPC,
+         (mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base, mpfr_prec_t prec, mpc_rnd_t rnd,
+          ComplexPt *type),
+         (z, nptr, min, max, endptr, base, prec, rnd, type))
+PROFILED(ParseErr, stringToComplexMPC, PROFILE_COMPLEX_MPC,
+         (mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base, mpfr_prec_t prec, mpc_rnd_t rnd),
+         (z, nptr, min, max, endptr, base, prec, rnd))
+PROFILED(ParseErr, stringToComplexMPCAuto, PROFILE_COMPLEX_MPC_AUTO,
+         (mpc_t z, char *nptr, mpc_t min, mpc_t max, char **endptr, int base, mpfr_prec_t cap, mpc_rnd_t rnd),
+         (z, nptr, min, max, endptr, base, cap, rnd))
+#endif
+#endif
+
+
+/* Whether the library was built with PERCY_PROFILE, so records latencies */
+bool profileEnabled(void)
+{
+    #ifdef PERCY_PROFILE
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+
+/* Name of a profiled function, or NULL if there is no such function */
+const char *profileName(ProfileFunction function)
+{
+    return ((unsigned int) function < PROFILE_FUNCTIONS) ? PROFILE_NAMES[function] : NULL;
+}
+
+
+/*
+ * Merge the histograms of every thread, including those that have exited,
+ * into `profile`. Threads keep recording while it is taken, so counts may be
+ * a call or two apart between functions. Empty unless built with
+ * PERCY_PROFILE
+ */
+void profileSnapshot(Profile *profile)
+{
+    profileClear(profile);
+
+    #ifdef PERCY_PROFILE
+    pthread_mutex_lock(&profileMutex);
+
+    profileMerge(profile, &profileRetired);
+
+    for (struct ProfileThread *thread = profileThreads; thread; thread = thread->next)
+    {
+        for (size_t f = 0; f < PROFILE_FUNCTIONS; ++f)
+        {
+            Histogram *histogram = __atomic_load_n(&thread->histograms[f], __ATOMIC_ACQUIRE);
+
+            if (histogram)
+                mergeHistogram(&profile->functions[f], histogram);
+        }
+    }
+
+    pthread_mutex_unlock(&profileMutex);
+
+    profile->ticksPerSecond = profileCalibrate();
+    #endif
+}
+
+
+/* Empty every histogram of `profile` */
+void profileClear(Profile *profile)
+{
+    memset(profile, 0, sizeof(*profile));
+}
+
+
+/* Add the histograms of `from` to those of `into` */
+void profileMerge(Profile *into, const Profile *from)
+{
+    if (into->ticksPerSecond == 0.0)
+        into->ticksPerSecond = from->ticksPerSecond;
+
+    for (size_t f = 0; f < PROFILE_FUNCTIONS; ++f)
+        mergeHistogram(&into->functions[f], &from->functions[f]);
+}
+
+
+/*
+ * Latency below which `quantile` (0 to 1) of the calls fall, as the upper
+ * bound of the bucket holding it, or 0 if there were no calls
+ */
+uint64_t profileQuantile(const Histogram *histogram, double quantile)
+{
+    uint64_t rank, seen = 0;
+
+    if (!histogram->count)
+        return 0;
+
+    rank = (uint64_t) (quantile * (double) histogram->count + 0.5);
+
+    if (rank < 1)
+        rank = 1;
+    else if (rank > histogram->count)
+        rank = histogram->count;
+
+    for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+    {
+        seen += histogram->buckets[b];
+
+        if (seen >= rank)
+        {
+            uint64_t upper = bucketUpper(b);
+            return (upper < histogram->max) ? upper : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+
+/*
+ * Save the non-empty histograms of `profile` as text, replacing the file
+ * atomically. Returns PARSE_EERR if it cannot be written
+ */
+ParseErr profileSave(const Profile *profile, const char *path)
+{
+    const char TMP_SUFFIX[] = ".tmp";
+
+    char *tmpPath;
+    FILE *file;
+    bool ok;
+
+    tmpPath = malloc(strlen(path) + sizeof(TMP_SUFFIX));
+
+    if (!tmpPath)
+        return PARSE_EERR;
+
+    strcpy(tmpPath, path);
+    strcat(tmpPath, TMP_SUFFIX);
+
+    file = fopen(tmpPath, "w");
+
+    if (!file)
+    {
+        free(tmpPath);
+        return PARSE_EERR;
+    }
+
+    ok = fprintf(file, "%s\n%.17g\n", PROFILE_MAGIC, profile->ticksPerSecond) > 0;
+
+    /* Each function as "name count sum min max buckets", then each bucket as "index:count" */
+    for (size_t f = 0; f < PROFILE_FUNCTIONS && ok; ++f)
+    {
+        const Histogram *histogram = &profile->functions[f];
+        size_t buckets = 0;
+
+        if (!histogram->count)
+            continue;
+
+        for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+            buckets += (histogram->buckets[b] != 0);
+
+        ok = fprintf(file, "%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %zu", PROFILE_NAMES[f],
+                     histogram->count, histogram->sum, histogram->min, histogram->max, buckets) > 0;
+
+        for (size_t b = 0; b < PROFILE_BUCKETS && ok; ++b)
+        {
+            if (histogram->buckets[b])
+                ok = fprintf(file, " %zu:%" PRIu64, b, histogram->buckets[b]) > 0;
+        }
+
+        ok = ok && fputc('\n', file) != EOF;
+    }
+
+    ok = !fclose(file) && ok && !rename(tmpPath, path);
+
+    if (!ok)
+        remove(tmpPath);
+
+    free(tmpPath);
+
+    return ok ? PARSE_SUCCESS : PARSE_EERR;
+}
+
+
+/*
+ * Load a profile saved by profileSave() into `profile`. Returns PARSE_EERR if
+ * the file cannot be read, and PARSE_EFORM if it is malformed
+ */
+ParseErr profileLoad(Profile *profile, const char *path)
+{
+    char magic[sizeof(PROFILE_MAGIC) + 1];
+    char name[PROFILE_NAME_MAX];
+    FILE *file;
+    ParseErr parseError = PARSE_SUCCESS;
+
+    profileClear(profile);
+
+    file = fopen(path, "r");
+
+    if (!file)
+        return PARSE_EERR;
+
+    if (!fgets(magic, sizeof(magic), file) || strcmp(magic, PROFILE_MAGIC "\n")
+        || fscanf(file, "%lf", &profile->ticksPerSecond) != 1)
+    {
+        fclose(file);
+        return PARSE_EFORM;
+    }
+
+    while (parseError == PARSE_SUCCESS && fscanf(file, "%63s", name) == 1)
+    {
+        Histogram *histogram = NULL;
+        size_t buckets;
+
+        for (size_t f = 0; f < PROFILE_FUNCTIONS; ++f)
+        {
+            if (!strcmp(name, PROFILE_NAMES[f]))
+                histogram = &profile->functions[f];
+        }
+
+        if (!histogram
+            || fscanf(file, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %zu", &histogram->count,
+                      &histogram->sum, &histogram->min, &histogram->max, &buckets) != 5)
+        {
+            parseError = PARSE_EFORM;
+            break;
+        }
+
+        for (size_t i = 0; i < buckets; ++i)
+        {
+            size_t b;
+            uint64_t count;
+
+            if (fscanf(file, " %zu:%" SCNu64, &b, &count) != 2 || b >= PROFILE_BUCKETS)
+            {
+                parseError = PARSE_EFORM;
+                break;
+            }
+
+            histogram->buckets[b] = count;
+        }
+    }
+
+    if (parseError == PARSE_SUCCESS && !feof(file))
+        parseError = PARSE_EFORM;
+
+    fclose(file);
+
+    return parseError;
+}
+
+
+/*
+ * Write a table of the calls, mean, p50, p99, p99.9 and maximum latency of
+ * each function called, in nanoseconds if the tick rate is known
+ */
+void profileWrite(FILE *stream, const Profile *profile)
+{
+    const double QUANTILES[] = {0.5, 0.99, 0.999};
+
+    double scale = (profile->ticksPerSecond > 0.0) ? 1e9 / profile->ticksPerSecond : 1.0;
+
+    fprintf(stream, "%-28s %12s %10s %10s %10s %10s %10s  (%s)\n", "function", "calls", "mean", "p50", "p99",
+            "p99.9", "max", (profile->ticksPerSecond > 0.0) ? "ns" : "ticks");
+
+    for (size_t f = 0; f < PROFILE_FUNCTIONS; ++f)
+    {
+        const Histogram *histogram = &profile->functions[f];
+
+        if (!histogram->count)
+            continue;
+
+        fprintf(stream, "%-28s %12" PRIu64 " %10.0f", PROFILE_NAMES[f], histogram->count,
+                (double) histogram->sum / (double) histogram->count * scale);
+
+        for (size_t q = 0; q < sizeof(QUANTILES) / sizeof(QUANTILES[0]); ++q)
+            fprintf(stream, " %10.0f", (double) profileQuantile(histogram, QUANTILES[q]) * scale);
+
+        fprintf(stream, " %10.0f\n", (double) histogram->max * scale);
+    }
+}
+
+
+#ifdef PERCY_PROFILE
+/* Current time in ticks: the TSC on x86, otherwise monotonic nanoseconds */
+static inline uint64_t profileClock(void)
+{
+    #ifdef PROFILE_TSC
+    return __rdtsc();
+    #else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+    #endif
+}
+
+
+/*
+ * Create the thread key, and take the first clock readings. If
+ * PERCY_PROFILE_FILE is set, a snapshot is saved to it (suffixed with the
+ * process ID) at exit
+ */
+static void profileInit(void)
+{
+    profileReady = !pthread_key_create(&profileKey, profileExit);
+
+    profileStartTicks = profileClock();
+    clock_gettime(CLOCK_MONOTONIC, &profileStartTime);
+
+    if (getenv("PERCY_PROFILE_FILE"))
+        atexit(profileAtExit);
+}
+
+
+/* The calling thread's histograms, registered on its first call, or NULL if they cannot be */
+static struct ProfileThread *profileThread(void)
+{
+    struct ProfileThread *thread;
+
+    pthread_once(&profileOnce, profileInit);
+
+    if (!profileReady)
+        return NULL;
+
+    if ((thread = pthread_getspecific(profileKey)))
+        return thread;
+
+    thread = calloc(1, sizeof(*thread));
+
+    if (!thread)
+        return NULL;
+
+    if (pthread_setspecific(profileKey, thread))
+    {
+        free(thread);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&profileMutex);
+    thread->next = profileThreads;
+    profileThreads = thread;
+    pthread_mutex_unlock(&profileMutex);
+
+    return thread;
+}
+
+
+/*
+ * Record a call of `function` that started at `start` ticks in the calling
+ * thread's histogram. Only the owning thread writes a histogram, so each field
+ * is read plainly and stored with a relaxed atomic store, which keeps
+ * concurrent snapshots well defined without any locked instructions
+ */
+static void profileRecord(ProfileFunction function, uint64_t start)
+{
+    uint64_t ticks = profileClock() - start;
+    struct ProfileThread *thread = profileThread();
+    Histogram *histogram;
+    size_t bucket = bucketIndex(ticks);
+
+    if (!thread)
+        return;
+
+    histogram = thread->histograms[function];
+
+    if (!histogram)
+    {
+        histogram = calloc(1, sizeof(*histogram));
+
+        if (!histogram)
+            return;
+
+        __atomic_store_n(&thread->histograms[function], histogram, __ATOMIC_RELEASE);
+    }
+
+    if (!histogram->count || ticks < histogram->min)
+        __atomic_store_n(&histogram->min, ticks, __ATOMIC_RELAXED);
+
+    if (ticks > histogram->max)
+        __atomic_store_n(&histogram->max, ticks, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&histogram->buckets[bucket], histogram->buckets[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->sum, histogram->sum + ticks, __ATOMIC_RELAXED);
+    __atomic_store_n(&histogram->count, histogram->count + 1, __ATOMIC_RELAXED);
+}
+
+
+/* Fold an exiting thread's histograms into those of exited threads */
+static void profileExit(void *arg)
+{
+    struct ProfileThread *thread = arg;
+
+    pthread_mutex_lock(&profileMutex);
+
+    for (struct ProfileThread **link = &profileThreads; *link; link = &(*link)->next)
+    {
+        if (*link == thread)
+        {
+            *link = thread->next;
+            break;
+        }
+    }
+
+    for (size_t f = 0; f < PROFILE_FUNCTIONS; ++f)
+    {
+        if (thread->histograms[f])
+            mergeHistogram(&profileRetired.functions[f], thread->histograms[f]);
+
+        free(thread->histograms[f]);
+    }
+
+    pthread_mutex_unlock(&profileMutex);
+
+    free(thread);
+}
+
+
+/* Save a snapshot to "$PERCY_PROFILE_FILE.<pid>" */
+static void profileAtExit(void)
+{
+    const char *prefix = getenv("PERCY_PROFILE_FILE");
+    Profile *profile = malloc(sizeof(*profile));
+    char *path;
+
+    if (!prefix || !profile)
+    {
+        free(profile);
+        return;
+    }
+
+    path = malloc(strlen(prefix) + 24);
+
+    if (path)
+    {
+        sprintf(path, "%s.%ld", prefix, (long) getpid());
+        profileSnapshot(profile);
+        profileSave(profile, path);
+    }
+
+    free(path);
+    free(profile);
+}
+
+
+/*
+ * Ticks per second: TSC cycles over the monotonic clock since the first timed
+ * call (waiting until at least 10 ms have passed), or 1e9 for nanoseconds.
+ * 0 if nothing was timed
+ */
+static double profileCalibrate(void)
+{
+    #ifdef PROFILE_TSC
+    struct timespec now;
+    uint64_t ticks;
+    double seconds;
+
+    if (!profileStartTicks)
+        return 0.0;
+
+    do
+    {
+        ticks = profileClock();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        seconds = (double) (now.tv_sec - profileStartTime.tv_sec)
+                  + (double) (now.tv_nsec - profileStartTime.tv_nsec) * 1e-9;
+    }
+    while (seconds < 0.01);
+
+    return (double) (ticks - profileStartTicks) / seconds;
+    #else
+    return profileStartTicks ? 1e9 : 0.0;
+    #endif
+}
+
+
+/*
+ * Bucket of a latency: exact below 2^PROFILE_SUB_BITS, then the top
+ * PROFILE_SUB_BITS + 1 bits of the value, with latencies beyond
+ * 2^PROFILE_MAX_BITS in the last bucket
+ */
+static size_t bucketIndex(uint64_t ticks)
+{
+    unsigned int bits;
+
+    if (ticks >> PROFILE_MAX_BITS)
+        return PROFILE_BUCKETS - 1;
+
+    if (ticks < (UINT64_C(1) << PROFILE_SUB_BITS))
+        return (size_t) ticks;
+
+    bits = 63 - (unsigned int) __builtin_clzll(ticks);
+
+    return ((size_t) (bits - PROFILE_SUB_BITS + 1) << PROFILE_SUB_BITS)
+           + (size_t) ((ticks >> (bits - PROFILE_SUB_BITS)) & ((UINT64_C(1) << PROFILE_SUB_BITS) - 1));
+}
+#endif
+
+
+/* Add one histogram to another, reading `from` atomically as its thread may be writing it */
+static void mergeHistogram(Histogram *into, const Histogram *from)
+{
+    uint64_t count = __atomic_load_n(&from->count, __ATOMIC_RELAXED);
+    uint64_t min = __atomic_load_n(&from->min, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&from->max, __ATOMIC_RELAXED);
+
+    if (!count)
+        return;
+
+    if (!into->count || min < into->min)
+        into->min = min;
+
+    if (max > into->max)
+        into->max = max;
+
+    into->count += count;
+    into->sum += __atomic_load_n(&from->sum, __ATOMIC_RELAXED);
+
+    for (size_t b = 0; b < PROFILE_BUCKETS; ++b)
+        into->buckets[b] += __atomic_load_n(&from->buckets[b], __ATOMIC_RELAXED);
+}
+
+
+/* Largest latency in a bucket */
+static uint64_t bucketUpper(size_t bucket)
+{
+    unsigned int shift;
+
+    if (bucket < (1u << PROFILE_SUB_BITS))
+        return (uint64_t) bucket;
+
+    shift = (unsigned int) (bucket >> PROFILE_SUB_BITS) - 1;
+
+    return (((UINT64_C(1) << PROFILE_SUB_BITS) + (bucket & ((1u << PROFILE_SUB_BITS) - 1))) << shift)
+           + (UINT64_C(1) << shift) - 1;
+}
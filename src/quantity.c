@@ -0,0 +1,513 @@
+#include "unprofiled.h"
+#include "quantity.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+
+
+/* Largest number copied for exact rescaling with strtod() */
+#define QUANTITY_NUMBER_MAX 96
+
+/* Exponents are clamped to this, well beyond the range of any result */
+#define QUANTITY_EXPONENT_MAX 100000
+
+
+struct QuantityPrefixDef
+{
+    const char *symbol;
+    int exp10;
+    int exp2;
+    int set;
+};
+
+/* Scale of a trie match: factor * 10^exp10 * 2^exp2 */
+struct QuantityScale
+{
+    uintmax_t factor;
+    int exp10;
+    int exp2;
+};
+
+/* Trie node, with children chained through `sibling` */
+struct QuantityNode
+{
+    unsigned char byte;
+    size_t child;
+    size_t sibling;
+    size_t match;
+};
+
+struct PercyQuantityTable
+{
+    struct QuantityNode *nodes;
+    size_t nodeCount;
+    struct QuantityScale *scales;
+};
+
+/* A lexed decimal number: integer digits, fraction digits and exponent */
+struct QuantityNumber
+{
+    bool negative;
+    const char *integer;
+    size_t integerLength;
+    const char *fraction;
+    size_t fractionLength;
+    long exponent;
+};
+
+
+/* Index meaning "no node" or "no match"; node 0 is the root so never a child */
+#define QUANTITY_NONE ((size_t) 0)
+
+static const struct QuantityPrefixDef QUANTITY_PREFIXES[] =
+{
+    {"", 0, 0, QUANTITY_ALL},
+    {"k", 3, 0, QUANTITY_SI},
+    {"M", 6, 0, QUANTITY_SI},
+    {"G", 9, 0, QUANTITY_SI},
+    {"T", 12, 0, QUANTITY_SI},
+    {"P", 15, 0, QUANTITY_SI},
+    {"E", 18, 0, QUANTITY_SI},
+    {"Z", 21, 0, QUANTITY_SI},
+    {"Y", 24, 0, QUANTITY_SI},
+    {"m", -3, 0, QUANTITY_SI_SMALL},
+    {"u", -6, 0, QUANTITY_SI_SMALL},
+    {"\xC2\xB5", -6, 0, QUANTITY_SI_SMALL},     /* Micro sign, U+00B5 */
+    {"\xCE\xBC", -6, 0, QUANTITY_SI_SMALL},     /* Greek small letter mu, U+03BC */
+    {"n", -9, 0, QUANTITY_SI_SMALL},
+    {"p", -12, 0, QUANTITY_SI_SMALL},
+    {"Ki", 0, 10, QUANTITY_IEC},
+    {"Mi", 0, 20, QUANTITY_IEC},
+    {"Gi", 0, 30, QUANTITY_IEC},
+    {"Ti", 0, 40, QUANTITY_IEC},
+    {"Pi", 0, 50, QUANTITY_IEC},
+    {"Ei", 0, 60, QUANTITY_IEC},
+    {"Zi", 0, 70, QUANTITY_IEC},
+    {"Yi", 0, 80, QUANTITY_IEC}
+};
+
+#define QUANTITY_PREFIX_COUNT (sizeof(QUANTITY_PREFIXES) / sizeof(*QUANTITY_PREFIXES))
+
+
+static bool trieInsert(QuantityTable *table, const char *prefix, const char *symbol, size_t match);
+static size_t trieStep(const QuantityTable *table, size_t node, unsigned char byte);
+static const struct QuantityScale *trieLookup(const QuantityTable *table, const char *str, char **endptr);
+
+static ParseErr lexQuantity(struct QuantityNumber *number, const struct QuantityScale **scale, char *nptr,
+                               char **endptr, const QuantityTable *table);
+static int quantityDigit(const struct QuantityNumber *number, size_t i);
+
+
+/*
+ * Compile a table of `n` units, with their permitted prefixes, into a trie for
+ * stringToQuantity() and stringToQuantityU(). The table does not refer to
+ * `units` afterwards and may be shared between threads
+ *
+ * Returns PARSE_EFORM if a symbol is empty or two prefixed symbols are spelt
+ * the same, and PARSE_EERR if out of memory, leaving `*table` NULL on error
+ */
+ParseErr quantityTableCreate(QuantityTable **table, const QuantityUnit *units, size_t n)
+{
+    QuantityTable *t;
+    size_t maxNodes = 1, maxScales = 1;
+
+    *table = NULL;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!units[i].symbol || units[i].symbol[0] == '\0')
+            return PARSE_EFORM;
+
+        for (size_t j = 0; j < QUANTITY_PREFIX_COUNT; ++j)
+        {
+            if (j == 0 || (QUANTITY_PREFIXES[j].set & units[i].prefixes))
+            {
+                maxNodes += strlen(QUANTITY_PREFIXES[j].symbol) + strlen(units[i].symbol);
+                ++maxScales;
+            }
+        }
+    }
+
+    t = malloc(sizeof(*t));
+
+    if (!t)
+        return PARSE_EERR;
+
+    t->nodes = calloc(maxNodes, sizeof(*t->nodes));
+    t->scales = malloc(maxScales * sizeof(*t->scales));
+    t->nodeCount = 1;
+
+    if (!t->nodes || !t->scales)
+    {
+        quantityTableDestroy(t);
+        return PARSE_EERR;
+    }
+
+    /* Scale 0 is the bare number, with no unit */
+    t->scales[0].factor = 1;
+    t->scales[0].exp10 = 0;
+    t->scales[0].exp2 = 0;
+
+    for (size_t i = 0, match = 1; i < n; ++i)
+    {
+        for (size_t j = 0; j < QUANTITY_PREFIX_COUNT; ++j)
+        {
+            if (j != 0 && !(QUANTITY_PREFIXES[j].set & units[i].prefixes))
+                continue;
+
+            t->scales[match].factor = units[i].factor ? units[i].factor : 1;
+            t->scales[match].exp10 = QUANTITY_PREFIXES[j].exp10;
+            t->scales[match].exp2 = QUANTITY_PREFIXES[j].exp2;
+
+            if (!trieInsert(t, QUANTITY_PREFIXES[j].symbol, units[i].symbol, match))
+            {
+                quantityTableDestroy(t);
+                return PARSE_EFORM;
+            }
+
+            ++match;
+        }
+    }
+
+    *table = t;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Free a table created with quantityTableCreate() */
+void quantityTableDestroy(QuantityTable *table)
+{
+    if (!table)
+        return;
+
+    free(table->nodes);
+    free(table->scales);
+    free(table);
+}
+
+
+/*
+ * Parse a decimal number with an optional (prefixed) unit from `table`, e.g.
+ * "10Gbps", "2.4 GHz" or "512KiB", into a double in base units. Without a unit
+ * the number is taken to be in base units
+ *
+ * Decimal prefixes are applied by adjusting the exponent of the number before
+ * conversion, and binary prefixes by scaling by a power of two, so the result
+ * is correctly rounded for units with a factor of 1 (numbers longer than 96
+ * characters are scaled after conversion instead)
+ */
+ParseErr stringToQuantity(double *x, char *nptr, double min, double max, char **endptr,
+                             const QuantityTable *table)
+{
+    struct QuantityNumber number;
+    const struct QuantityScale *scale;
+    ParseErr parseError;
+
+    parseError = lexQuantity(&number, &scale, nptr, endptr, table);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    errno = 0;
+
+    if (number.integerLength + number.fractionLength + 16 <= QUANTITY_NUMBER_MAX)
+    {
+        char buffer[QUANTITY_NUMBER_MAX];
+
+        snprintf(buffer, sizeof(buffer), "%s%.*s.%.*se%ld", number.negative ? "-" : "",
+                 (int) number.integerLength, number.integer, (int) number.fractionLength, number.fraction,
+                 number.exponent + scale->exp10);
+
+        *x = strtod(buffer, NULL);
+    }
+    else
+    {
+        *x = strtod(number.integer - number.negative, NULL) * pow(10.0, scale->exp10);
+    }
+
+    *x = ldexp(*x, scale->exp2) * (double) scale->factor;
+
+    /* Range checks */
+    if (errno == ERANGE || isinf(*x))
+        return PARSE_ERANGE;
+    else if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Parse a quantity as for stringToQuantity() into an integer number of base
+ * units. The scaling is exact, truncating any fractional part, so "2.5kbps"
+ * is exactly 2500 and "1500mA" is 1. Negative quantities return PARSE_EFORM
+ */
+ParseErr stringToQuantityU(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr,
+                              const QuantityTable *table)
+{
+    struct QuantityNumber number;
+    const struct QuantityScale *scale;
+    uintmax_t multiplier, whole = 0, part = 0;
+    size_t digits;
+    long point;
+    bool zero = true;
+    ParseErr parseError;
+
+    parseError = lexQuantity(&number, &scale, nptr, endptr, table);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    if (number.negative)
+    {
+        *endptr = nptr;
+        return PARSE_EFORM;
+    }
+
+    digits = number.integerLength + number.fractionLength;
+
+    for (size_t i = 0; i < digits && zero; ++i)
+        zero = (quantityDigit(&number, i) == 0);
+
+    *x = 0;
+
+    if (!zero)
+    {
+        /* Whole multiple of base units that one unit of the number represents */
+        multiplier = scale->factor;
+
+        for (int i = 0; i < scale->exp2; ++i)
+        {
+            if (multiplier > UINTMAX_MAX / 2)
+                return PARSE_ERANGE;
+
+            multiplier *= 2;
+        }
+
+        for (int i = 0; i < scale->exp10; ++i)
+        {
+            if (multiplier > UINTMAX_MAX / 10)
+                return PARSE_ERANGE;
+
+            multiplier *= 10;
+        }
+
+        /* Position of the decimal point within the digits, after small prefixes */
+        point = (long) number.integerLength + number.exponent + (scale->exp10 < 0 ? scale->exp10 : 0);
+
+        if (point > (long) digits + 20)
+            return PARSE_ERANGE;
+
+        for (long i = 0; i < point; ++i)
+        {
+            int digit = quantityDigit(&number, (size_t) i);
+
+            if (whole > (UINTMAX_MAX - (uintmax_t) digit) / 10)
+                return PARSE_ERANGE;
+
+            whole = whole * 10 + (uintmax_t) digit;
+        }
+
+        /*
+         * Exact floor of 0.d1d2...dk * multiplier, by Horner's rule from the
+         * last digit, splitting the multiplier so nothing overflows
+         */
+        for (size_t i = digits; i > (point > 0 ? (size_t) point : 0); --i)
+        {
+            uintmax_t digit = (uintmax_t) quantityDigit(&number, i - 1);
+
+            part = digit * (multiplier / 10) + part / 10 + (digit * (multiplier % 10) + part % 10) / 10;
+        }
+
+        for (long i = point; i < 0 && part; ++i)
+            part /= 10;
+
+        if (whole > (UINTMAX_MAX - part) / multiplier)
+            return PARSE_ERANGE;
+
+        *x = whole * multiplier + part;
+    }
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/* Add "<prefix><symbol>" to the trie, failing if it is already there */
+static bool trieInsert(QuantityTable *table, const char *prefix, const char *symbol, size_t match)
+{
+    const char *parts[] = {prefix, symbol};
+    size_t node = 0;
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (const unsigned char *c = (const unsigned char *) parts[i]; *c; ++c)
+        {
+            size_t next = trieStep(table, node, *c);
+
+            if (next == QUANTITY_NONE)
+            {
+                next = table->nodeCount++;
+                table->nodes[next].byte = *c;
+                table->nodes[next].sibling = table->nodes[node].child;
+                table->nodes[node].child = next;
+            }
+
+            node = next;
+        }
+    }
+
+    if (table->nodes[node].match != QUANTITY_NONE)
+        return false;
+
+    table->nodes[node].match = match;
+
+    return true;
+}
+
+
+/* Child of `node` for `byte`, or QUANTITY_NONE */
+static size_t trieStep(const QuantityTable *table, size_t node, unsigned char byte)
+{
+    size_t child = table->nodes[node].child;
+
+    while (child != QUANTITY_NONE && table->nodes[child].byte != byte)
+        child = table->nodes[child].sibling;
+
+    return child;
+}
+
+
+/* Longest prefixed unit at the start of `str`, or NULL if there is none */
+static const struct QuantityScale *trieLookup(const QuantityTable *table, const char *str, char **endptr)
+{
+    const struct QuantityScale *scale = NULL;
+    size_t node = 0;
+
+    for (const char *c = str; *c; ++c)
+    {
+        node = trieStep(table, node, (unsigned char) *c);
+
+        if (node == QUANTITY_NONE)
+            break;
+
+        if (table->nodes[node].match != QUANTITY_NONE)
+        {
+            scale = &table->scales[table->nodes[node].match];
+            *endptr = (char *) (uintptr_t) (c + 1);
+        }
+    }
+
+    return scale;
+}
+
+
+/*
+ * Split "[sign]digits[.digits][e[sign]digits][space][unit]" into its number
+ * and unit scale, leaving `endptr` after the last character used
+ */
+static ParseErr lexQuantity(struct QuantityNumber *number, const struct QuantityScale **scale, char *nptr,
+                               char **endptr, const QuantityTable *table)
+{
+    char *c = nptr;
+
+    *endptr = nptr;
+
+    /* Get pointer to start of number */
+    while (isspace(*c))
+        ++c;
+
+    number->negative = (*c == '-');
+
+    if (*c == '+' || *c == '-')
+        ++c;
+
+    number->integer = c;
+
+    while (isdigit(*c))
+        ++c;
+
+    number->integerLength = (size_t) (c - number->integer);
+    number->fraction = c;
+    number->fractionLength = 0;
+
+    if (*c == '.')
+    {
+        number->fraction = ++c;
+
+        while (isdigit(*c))
+            ++c;
+
+        number->fractionLength = (size_t) (c - number->fraction);
+    }
+
+    if (number->integerLength + number->fractionLength == 0)
+        return PARSE_EFORM;
+
+    number->exponent = 0;
+
+    /* An 'e' or 'E' without digits after it may be the exa prefix */
+    if ((*c == 'e' || *c == 'E')
+        && (isdigit(c[1]) || ((c[1] == '+' || c[1] == '-') && isdigit(c[2]))))
+    {
+        bool negative = (c[1] == '-');
+
+        c += (c[1] == '+' || c[1] == '-') ? 2 : 1;
+
+        for (; isdigit(*c); ++c)
+        {
+            if (number->exponent < QUANTITY_EXPONENT_MAX)
+                number->exponent = number->exponent * 10 + (*c - '0');
+        }
+
+        if (negative)
+            number->exponent = -number->exponent;
+    }
+
+    *endptr = c;
+    *scale = &table->scales[0];
+
+    while (isspace(*c))
+        ++c;
+
+    if (*c != '\0')
+    {
+        const struct QuantityScale *unit = trieLookup(table, c, endptr);
+
+        if (unit)
+            *scale = unit;
+    }
+
+    return PARSE_SUCCESS;
+}
+
+
+/* The i'th digit of a number, counting integer then fraction digits */
+static int quantityDigit(const struct QuantityNumber *number, size_t i)
+{
+    if (i < number->integerLength)
+        return number->integer[i] - '0';
+    else if (i < number->integerLength + number->fractionLength)
+        return number->fraction[i - number->integerLength] - '0';
+    else
+        return 0;
+}
@@ -0,0 +1,374 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tally.h"
+
+
+/* Longest segment name */
+#define STATS_NAME_MAX 256
+
+/* Copies of a slot a reader tries before taking one that may be torn (its writer died mid-write) */
+#define STATS_READ_TRIES 1000
+
+
+#ifdef PERCY_STATS
+__thread StatsCounters statsTally;
+
+/* The calling thread's slot once it has published, or whether none was free */
+static __thread StatsSlot *statsSlot;
+static __thread bool statsFull;
+
+static pthread_once_t statsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t statsKey;
+static bool statsReady;
+
+/* The exported segment and its name, and the slots of exited threads */
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static StatsSegment *statsSegment;
+static char statsName[STATS_NAME_MAX];
+static uint32_t statsRetired[STATS_SLOTS];
+static size_t statsRetiredCount;
+
+
+static void statsInit(void);
+static StatsSlot *statsClaim(void);
+static void statsExit(void *arg);
+static void storeCounters(StatsCounters *to, const StatsCounters *from);
+#endif
+
+static void loadCounters(StatsCounters *to, const StatsCounters *from);
+static void addCounters(StatsCounters *into, const StatsCounters *from);
+
+
+/* Whether the library was built with PERCY_STATS, so counts and can export */
+bool statsEnabled(void)
+{
+    #ifdef PERCY_STATS
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+
+/*
+ * Create the shared-memory segment `name` (as for shm_open(), or
+ * "/percy.<pid>" if NULL) and publish every thread's counters to it from now
+ * on. The name is removed at exit. Returns PARSE_EERR if the segment cannot be
+ * created, if one is already exported, or unless built with PERCY_STATS
+ */
+ParseErr statsExport(const char *name)
+{
+    #ifdef PERCY_STATS
+    char defaultName[32];
+    StatsSegment *segment;
+    int fd;
+
+    if (!name)
+    {
+        sprintf(defaultName, "/percy.%ld", (long) getpid());
+        name = defaultName;
+    }
+
+    if (strlen(name) >= STATS_NAME_MAX)
+        return PARSE_EERR;
+
+    pthread_once(&statsOnce, statsInit);
+    pthread_mutex_lock(&statsMutex);
+
+    if (!statsReady || statsSegment)
+    {
+        pthread_mutex_unlock(&statsMutex);
+        return PARSE_EERR;
+    }
+
+    fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+    if (fd < 0)
+    {
+        pthread_mutex_unlock(&statsMutex);
+        return PARSE_EERR;
+    }
+
+    segment = (ftruncate(fd, sizeof(*segment)) == 0)
+              ? mmap(NULL, sizeof(*segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (segment == MAP_FAILED)
+    {
+        shm_unlink(name);
+        pthread_mutex_unlock(&statsMutex);
+        return PARSE_EERR;
+    }
+
+    /* The magic number is stored last, so readers never see a half-made header */
+    segment->version = STATS_VERSION;
+    segment->pid = (int64_t) getpid();
+    __atomic_store_n(&segment->magic, STATS_MAGIC, __ATOMIC_RELEASE);
+
+    strcpy(statsName, name);
+    __atomic_store_n(&statsSegment, segment, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&statsMutex);
+
+    atexit(statsRemove);
+
+    return PARSE_SUCCESS;
+    #else
+    (void) name;
+    return PARSE_EERR;
+    #endif
+}
+
+
+/*
+ * Publish the calling thread's counters now, e.g. after a loop of
+ * single-value parser calls; the batch parsers publish after every batch
+ */
+void statsFlush(void)
+{
+    #ifdef PERCY_STATS
+    statsPublish();
+    #endif
+}
+
+
+/*
+ * Remove the exported segment's name, so no new reader can attach. The
+ * segment itself stays mapped, and counted, until the process exits
+ */
+void statsRemove(void)
+{
+    #ifdef PERCY_STATS
+    pthread_mutex_lock(&statsMutex);
+
+    if (statsName[0])
+        shm_unlink(statsName);
+
+    statsName[0] = '\0';
+
+    pthread_mutex_unlock(&statsMutex);
+    #endif
+}
+
+
+/*
+ * Map the statistics segment `name` read-only into `*segment`. Returns
+ * PARSE_EERR if it cannot be opened, or PARSE_EFORM if it is not a statistics
+ * segment of this version
+ */
+ParseErr statsAttach(const StatsSegment **segment, const char *name)
+{
+    struct stat status;
+    void *map;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+
+    if (fd < 0)
+        return PARSE_EERR;
+
+    if (fstat(fd, &status) || (size_t) status.st_size < sizeof(**segment))
+    {
+        close(fd);
+        return PARSE_EFORM;
+    }
+
+    map = mmap(NULL, sizeof(**segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return PARSE_EERR;
+
+    *segment = map;
+
+    if (__atomic_load_n(&(*segment)->magic, __ATOMIC_ACQUIRE) != STATS_MAGIC
+        || (*segment)->version != STATS_VERSION)
+    {
+        munmap(map, sizeof(**segment));
+        return PARSE_EFORM;
+    }
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Sum the counters of every thread of an attached segment into `total`, each
+ * thread's read consistently (retrying while it is being written). Returns
+ * the number of slots in use
+ */
+size_t statsRead(const StatsSegment *segment, StatsCounters *total)
+{
+    uint32_t slots = __atomic_load_n(&segment->slots, __ATOMIC_ACQUIRE);
+
+    memset(total, 0, sizeof(*total));
+
+    if (slots > STATS_SLOTS)
+        slots = STATS_SLOTS;
+
+    for (uint32_t s = 0; s < slots; ++s)
+    {
+        const StatsSlot *slot = &segment->slot[s];
+        StatsCounters counters;
+        uint64_t before, after;
+        int tries = 0;
+
+        do
+        {
+            before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+            loadCounters(&counters, &slot->counters);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+        }
+        while (((before & 1) || before != after) && ++tries < STATS_READ_TRIES);
+
+        addCounters(total, &counters);
+    }
+
+    return slots;
+}
+
+
+/* Unmap a segment mapped by statsAttach() */
+void statsDetach(const StatsSegment *segment)
+{
+    munmap((void *) (uintptr_t) segment, sizeof(*segment));
+}
+
+
+#ifdef PERCY_STATS
+/*
+ * Write the calling thread's tallies to its slot, claiming one on the first
+ * call after the segment is exported. The thread is the slot's only writer,
+ * so this is a seqlock write of plain relaxed stores: no locked instructions,
+ * and on x86 no fences
+ */
+void statsPublish(void)
+{
+    StatsSlot *slot = statsSlot;
+    uint64_t sequence;
+
+    if (!slot)
+    {
+        if (statsFull || !__atomic_load_n(&statsSegment, __ATOMIC_ACQUIRE) || !(slot = statsClaim()))
+            return;
+    }
+
+    sequence = slot->sequence;
+
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    storeCounters(&slot->counters, &statsTally);
+
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+
+static void statsInit(void)
+{
+    statsReady = !pthread_key_create(&statsKey, statsExit);
+}
+
+
+/*
+ * Give the calling thread the slot of an exited thread, taking over its
+ * totals, or else an unused one. Returns NULL if all STATS_SLOTS are taken
+ */
+static StatsSlot *statsClaim(void)
+{
+    StatsSlot *slot = NULL;
+
+    pthread_mutex_lock(&statsMutex);
+
+    if (statsRetiredCount)
+        slot = &statsSegment->slot[statsRetired[--statsRetiredCount]];
+    else if (statsSegment->slots < STATS_SLOTS)
+    {
+        slot = &statsSegment->slot[statsSegment->slots];
+        __atomic_store_n(&statsSegment->slots, statsSegment->slots + 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&statsMutex);
+
+    if (!slot)
+    {
+        statsFull = true;
+        return NULL;
+    }
+
+    addCounters(&statsTally, &slot->counters);
+
+    /* Without the key the slot is simply never retired */
+    pthread_setspecific(statsKey, slot);
+    statsSlot = slot;
+
+    return slot;
+}
+
+
+/* Publish an exiting thread's final totals, and retire its slot */
+static void statsExit(void *arg)
+{
+    StatsSlot *slot = arg;
+
+    statsPublish();
+
+    pthread_mutex_lock(&statsMutex);
+    statsRetired[statsRetiredCount++] = (uint32_t) (slot - statsSegment->slot);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+
+static void storeCounters(StatsCounters *to, const StatsCounters *from)
+{
+    __atomic_store_n(&to->values, from->values, __ATOMIC_RELAXED);
+    __atomic_store_n(&to->bytes, from->bytes, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < STATS_OUTCOMES; ++i)
+        __atomic_store_n(&to->outcomes[i], from->outcomes[i], __ATOMIC_RELAXED);
+
+    __atomic_store_n(&to->fast, from->fast, __ATOMIC_RELAXED);
+    __atomic_store_n(&to->slow, from->slow, __ATOMIC_RELAXED);
+}
+#endif
+
+
+static void loadCounters(StatsCounters *to, const StatsCounters *from)
+{
+    to->values = __atomic_load_n(&from->values, __ATOMIC_RELAXED);
+    to->bytes = __atomic_load_n(&from->bytes, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < STATS_OUTCOMES; ++i)
+        to->outcomes[i] = __atomic_load_n(&from->outcomes[i], __ATOMIC_RELAXED);
+
+    to->fast = __atomic_load_n(&from->fast, __ATOMIC_RELAXED);
+    to->slow = __atomic_load_n(&from->slow, __ATOMIC_RELAXED);
+}
+
+
+static void addCounters(StatsCounters *into, const StatsCounters *from)
+{
+    into->values += from->values;
+    into->bytes += from->bytes;
+
+    for (size_t i = 0; i < STATS_OUTCOMES; ++i)
+        into->outcomes[i] += from->outcomes[i];
+
+    into->fast += from->fast;
+    into->slow += from->slow;
+}
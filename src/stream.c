@@ -0,0 +1,450 @@
+#include "unprofiled.h"
+#include "stream.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZLIB_STREAM
+#include <zlib.h>
+#endif
+
+#ifdef ZSTD_STREAM
+#include <zstd.h>
+#endif
+
+#include "block.h"
+#include "parser.h"
+
+
+/* Default bytes of text per block, sized so a block and its values sit in L2 */
+#define STREAM_BLOCK_SIZE 16384
+
+/* Number of blocks in the ring used by streamParse() */
+#define STREAM_BLOCKS 2
+
+/* Bytes of (possibly compressed) input read from the file at a time */
+#define STREAM_INPUT_SIZE 16384
+
+
+struct PercyStream
+{
+    FILE *file;
+    StreamFormat format;
+
+    unsigned char *input;
+    size_t inputLength;
+    size_t inputPos;
+
+    /* End of file reached, or a read error occurred */
+    bool eof;
+    bool error;
+
+    /* Part-way through a compressed member/frame, so end of file is an error */
+    bool frameOpen;
+
+    #ifdef ZLIB_STREAM
+    z_stream gzip;
+    bool gzipInit;
+    #endif
+
+    #ifdef ZSTD_STREAM
+    ZSTD_DStream *zstd;
+    #endif
+};
+
+
+static bool fillInput(Stream *stream);
+static StreamFormat detectFormat(const unsigned char *buf, size_t length);
+
+static int rawRead(Stream *stream, char *buf, size_t size, size_t *length);
+
+#ifdef ZLIB_STREAM
+static int gzipRead(Stream *stream, char *buf, size_t size, size_t *length);
+#endif
+
+#ifdef ZSTD_STREAM
+static int zstdRead(Stream *stream, char *buf, size_t size, size_t *length);
+#endif
+
+
+/*
+ * Open a file for streamed reading. With STREAM_AUTO, the format is detected
+ * from the file's magic number, falling back to uncompressed text
+ *
+ * Returns:
+ *   - PARSE_EERR if the file could not be opened or memory could not be
+ *     allocated
+ *   - PARSE_EFORM if the format is compressed but its library was not
+ *     built in (see `make ZLIB=1 ZSTD=1`)
+ */
+ParseErr streamOpen(Stream **stream, const char *path, StreamFormat format)
+{
+    Stream *s;
+
+    *stream = NULL;
+
+    s = calloc(1, sizeof(*s));
+
+    if (!s)
+        return PARSE_EERR;
+
+    s->input = malloc(STREAM_INPUT_SIZE);
+    s->file = fopen(path, "rb");
+
+    if (!s->input || !s->file)
+    {
+        streamClose(s);
+        return PARSE_EERR;
+    }
+
+    /* The first read is kept as the start of the input whatever the format */
+    fillInput(s);
+
+    if (s->error)
+    {
+        streamClose(s);
+        return PARSE_EERR;
+    }
+
+    s->format = (format == STREAM_AUTO) ? detectFormat(s->input, s->inputLength) : format;
+
+    switch (s->format)
+    {
+        case STREAM_RAW:
+            break;
+
+        #ifdef ZLIB_STREAM
+        case STREAM_GZIP:
+            /* Window bits of 15 + 32 accept both gzip and zlib headers */
+            if (inflateInit2(&s->gzip, 15 + 32) != Z_OK)
+            {
+                streamClose(s);
+                return PARSE_EERR;
+            }
+
+            s->gzipInit = true;
+            s->gzip.next_in = s->input;
+            s->gzip.avail_in = (uInt) s->inputLength;
+            break;
+        #endif
+
+        #ifdef ZSTD_STREAM
+        case STREAM_ZSTD:
+            s->zstd = ZSTD_createDStream();
+
+            if (!s->zstd || ZSTD_isError(ZSTD_initDStream(s->zstd)))
+            {
+                streamClose(s);
+                return PARSE_EERR;
+            }
+
+            break;
+        #endif
+
+        default:
+            streamClose(s);
+            return PARSE_EFORM;
+    }
+
+    *stream = s;
+
+    return PARSE_SUCCESS;
+}
+
+
+/* Close the file and free the stream */
+void streamClose(Stream *stream)
+{
+    if (!stream)
+        return;
+
+    #ifdef ZLIB_STREAM
+    if (stream->gzipInit)
+        inflateEnd(&stream->gzip);
+    #endif
+
+    #ifdef ZSTD_STREAM
+    ZSTD_freeDStream(stream->zstd);
+    #endif
+
+    if (stream->file)
+        fclose(stream->file);
+
+    free(stream->input);
+    free(stream);
+}
+
+
+/* Format of an open stream, after any detection */
+StreamFormat streamFormat(const Stream *stream)
+{
+    return stream->format;
+}
+
+
+/*
+ * Read up to `size` bytes of decompressed text. This matches the BlockReader
+ * signature, so a stream can also feed a pipeline directly
+ */
+int streamRead(char *buf, size_t size, size_t *length, void *stream)
+{
+    Stream *s = stream;
+
+    *length = 0;
+
+    switch (s->format)
+    {
+        case STREAM_RAW:
+            return rawRead(s, buf, size, length);
+
+        #ifdef ZLIB_STREAM
+        case STREAM_GZIP:
+            return gzipRead(s, buf, size, length);
+        #endif
+
+        #ifdef ZSTD_STREAM
+        case STREAM_ZSTD:
+            return zstdRead(s, buf, size, length);
+        #endif
+
+        default:
+            return 1;
+    }
+}
+
+
+/*
+ * Decompress and parse a stream of whitespace-separated values into a small
+ * ring of blocks, passing each to `writer` as soon as it has been parsed,
+ * while its text is still in cache. A token cut off at the end of one block is
+ * carried to the start of the next. The previous block remains valid during
+ * the writer callback, and memory use is independent of the input size
+ *
+ * A `blockSize` of 0 selects the default. Returns PARSE_EERR on a read or
+ * decompression error (or if the writer stops early), and PARSE_EFORM if a
+ * single token is larger than a block
+ */
+ParseErr streamParse(Stream *stream, ValueType type, int arg, size_t blockSize, StreamWriter writer, void *writerArg)
+{
+    Block *ring[STREAM_BLOCKS] = {NULL};
+    Block *prev = NULL;
+    uint64_t sequence = 0;
+    size_t carry = 0;
+    bool final = false;
+    ParseErr parseError = PARSE_SUCCESS;
+
+    if (blockSize == 0)
+        blockSize = STREAM_BLOCK_SIZE;
+
+    for (size_t i = 0; i < STREAM_BLOCKS; ++i)
+    {
+        ring[i] = blockCreate(blockSize, type);
+
+        if (!ring[i])
+            parseError = PARSE_EERR;
+    }
+
+    for (size_t i = 0; parseError == PARSE_SUCCESS && !final; i = (i + 1) % STREAM_BLOCKS)
+    {
+        Block *block = ring[i];
+
+        block->length = 0;
+
+        if (prev)
+        {
+            memcpy(block->data, prev->data + prev->length - carry, carry);
+            block->length = carry;
+        }
+
+        parseError = blockFill(block, streamRead, stream, &final, &carry);
+
+        if (parseError != PARSE_SUCCESS || block->count == 0)
+            continue;
+
+        blockParse(block, arg);
+        block->sequence = sequence++;
+
+        if (writer(block, writerArg))
+            parseError = PARSE_EERR;
+
+        prev = block;
+    }
+
+    for (size_t i = 0; i < STREAM_BLOCKS; ++i)
+        blockDestroy(ring[i]);
+
+    return parseError;
+}
+
+
+/* Read the next chunk of the file into the input buffer */
+static bool fillInput(Stream *stream)
+{
+    stream->inputPos = 0;
+    stream->inputLength = 0;
+
+    if (stream->eof)
+        return false;
+
+    stream->inputLength = fread(stream->input, 1, STREAM_INPUT_SIZE, stream->file);
+
+    if (stream->inputLength == 0)
+    {
+        stream->eof = true;
+        stream->error = ferror(stream->file) != 0;
+    }
+
+    return stream->inputLength > 0;
+}
+
+
+/* Identify gzip/zlib or zstd data from its first bytes */
+static StreamFormat detectFormat(const unsigned char *buf, size_t length)
+{
+    const unsigned char GZIP_MAGIC[] = {0x1F, 0x8B};
+    const unsigned char ZSTD_MAGIC[] = {0x28, 0xB5, 0x2F, 0xFD};
+
+    if (length >= sizeof(GZIP_MAGIC) && !memcmp(buf, GZIP_MAGIC, sizeof(GZIP_MAGIC)))
+        return STREAM_GZIP;
+    else if (length >= sizeof(ZSTD_MAGIC) && !memcmp(buf, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)))
+        return STREAM_ZSTD;
+
+    return STREAM_RAW;
+}
+
+
+/* Uncompressed input: drain the already-read input buffer, then the file */
+static int rawRead(Stream *stream, char *buf, size_t size, size_t *length)
+{
+    if (stream->inputPos < stream->inputLength)
+    {
+        *length = stream->inputLength - stream->inputPos;
+
+        if (*length > size)
+            *length = size;
+
+        memcpy(buf, stream->input + stream->inputPos, *length);
+        stream->inputPos += *length;
+
+        return 0;
+    }
+
+    if (stream->eof)
+        return stream->error;
+
+    *length = fread(buf, 1, size, stream->file);
+
+    if (*length == 0)
+    {
+        stream->eof = true;
+        stream->error = ferror(stream->file) != 0;
+    }
+
+    return stream->error;
+}
+
+
+#ifdef ZLIB_STREAM
+/* Inflate gzip or zlib data, including concatenated gzip members */
+static int gzipRead(Stream *stream, char *buf, size_t size, size_t *length)
+{
+    z_stream *z = &stream->gzip;
+
+    z->next_out = (Bytef *) buf;
+    z->avail_out = (size > UINT_MAX) ? UINT_MAX : (uInt) size;
+
+    while (z->avail_out > 0)
+    {
+        uInt avail = z->avail_out;
+        int ret;
+
+        if (z->avail_in == 0 && fillInput(stream))
+        {
+            z->next_in = stream->input;
+            z->avail_in = (uInt) stream->inputLength;
+        }
+
+        if (stream->error)
+            return 1;
+
+        ret = inflate(z, Z_NO_FLUSH);
+
+        if (ret == Z_STREAM_END)
+        {
+            stream->frameOpen = false;
+
+            if (z->avail_in == 0 && stream->eof)
+                break;
+
+            /* Another member follows */
+            if (inflateReset(z) != Z_OK)
+                return 1;
+
+            continue;
+        }
+
+        if (ret == Z_OK)
+            stream->frameOpen = true;
+        else if (ret != Z_BUF_ERROR)
+            return 1;
+
+        /* Nothing more to come out */
+        if (stream->eof && z->avail_in == 0 && z->avail_out == avail)
+            break;
+    }
+
+    *length = (size_t) ((char *) z->next_out - buf);
+
+    /* Input ended in the middle of a member */
+    return *length == 0 && stream->frameOpen;
+}
+#endif
+
+
+#ifdef ZSTD_STREAM
+/* Decompress zstd data, including concatenated frames */
+static int zstdRead(Stream *stream, char *buf, size_t size, size_t *length)
+{
+    ZSTD_outBuffer out = {buf, size, 0};
+
+    while (out.pos < out.size)
+    {
+        ZSTD_inBuffer in;
+        size_t pos = out.pos;
+        size_t ret;
+
+        if (stream->inputPos == stream->inputLength)
+            fillInput(stream);
+
+        if (stream->error)
+            return 1;
+
+        in.src = stream->input;
+        in.size = stream->inputLength;
+        in.pos = stream->inputPos;
+
+        ret = ZSTD_decompressStream(stream->zstd, &out, &in);
+
+        if (ZSTD_isError(ret))
+            return 1;
+
+        /* Nothing more to come out */
+        if (in.pos == stream->inputPos && out.pos == pos && stream->eof)
+            break;
+
+        /* A return of 0 means a frame has been completely decoded and flushed */
+        stream->frameOpen = (ret != 0);
+        stream->inputPos = in.pos;
+    }
+
+    *length = out.pos;
+
+    /* Input ended in the middle of a frame */
+    return *length == 0 && stream->frameOpen;
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef TALLY_H
+#define TALLY_H
+
+
+/*
+ * With PERCY_STATS, the parsers tally values, outcomes and fast or slow path
+ * hits into plain thread-local counters, and the batch parsers publish them
+ * to the thread's slot of the exported statistics segment once per batch
+ * (see stats.c). Without it, the tallies compile to nothing. Not installed
+ */
+
+
+#include "stats.h"
+
+
+#ifdef PERCY_STATS
+extern __thread StatsCounters statsTally;
+
+void statsPublish(void);
+
+#define STATS_PATH(isFast) ((void) ((isFast) ? ++statsTally.fast : ++statsTally.slow))
+#define STATS_VALUE(error, length) \
+    ((void) (++statsTally.values, statsTally.bytes += (uint64_t) (length), ++statsTally.outcomes[error]))
+#define STATS_PUBLISH() statsPublish()
+#else
+#define STATS_PATH(isFast) ((void) 0)
+#define STATS_VALUE(error, length) ((void) 0)
+#define STATS_PUBLISH() ((void) 0)
+#endif
+
+
+#endif
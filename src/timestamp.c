@@ -0,0 +1,291 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tally.h"
+
+
+/* Nanoseconds per second */
+#define NS_PER_SEC 1000000000
+
+/* Size of a memory page, within which a 16-byte load can never fault */
+#define PAGE_SIZE 4096
+
+
+static bool lexDateTime(const char *c, int fields[6]);
+static bool lexDateTimeScalar(const char *c, int fields[6]);
+static int64_t daysFromCivil(int year, int month, int day);
+static bool isLeapYear(int year);
+
+
+/*
+ * Parse an ISO 8601 / RFC 3339 timestamp into nanoseconds since the Unix epoch
+ *
+ * Input must be of the form:
+ *   "YYYY-MM-DDTHH:MM:SS[.fraction][offset]"
+ *
+ * Where:
+ *   - The 'T' separator can also be 't' or a space
+ *   - The fraction can have any number of digits; those beyond nanoseconds
+ *     are truncated
+ *   - The offset is 'Z', 'z' or "+HH:MM"/"-HH:MM". If omitted, the time is
+ *     taken to be UTC
+ *   - A leap second (60) is accepted, and counts as the first second of the
+ *     next minute
+ *
+ * The fixed-layout date and time are validated with a single 16-byte SIMD
+ * load where available. Times outside the range of `int64_t` nanoseconds
+ * (years 1677 to 2262) return PARSE_ERANGE
+ */
+ParseErr stringToTimestamp(int64_t *ns, char *nptr, int64_t min, int64_t max, char **endptr)
+{
+    const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    int fields[6];
+    int64_t seconds, fraction = 0, offset = 0;
+    int monthDays;
+
+    *endptr = nptr;
+
+    /* Get pointer to start of timestamp */
+    while (isspace(**endptr))
+        ++(*endptr);
+
+    if (!lexDateTime(*endptr, fields))
+        return PARSE_EFORM;
+
+    if (fields[1] < 1 || fields[1] > 12)
+        return PARSE_EFORM;
+
+    monthDays = DAYS_IN_MONTH[fields[1] - 1] + (fields[1] == 2 && isLeapYear(fields[0]));
+
+    if (fields[2] < 1 || fields[2] > monthDays || fields[3] > 23 || fields[4] > 59 || fields[5] > 60)
+        return PARSE_EFORM;
+
+    *endptr += 19;
+
+    /* Fractional seconds */
+    if (**endptr == '.' || **endptr == ',')
+    {
+        int digits = 0;
+
+        ++(*endptr);
+
+        if (!isdigit(**endptr))
+            return PARSE_EFORM;
+
+        for (; isdigit(**endptr); ++(*endptr), ++digits)
+        {
+            if (digits < 9)
+                fraction = fraction * 10 + (**endptr - '0');
+        }
+
+        for (; digits < 9; ++digits)
+            fraction *= 10;
+    }
+
+    /* UTC offset */
+    if (**endptr == 'Z' || **endptr == 'z')
+    {
+        ++(*endptr);
+    }
+    else if (**endptr == '+' || **endptr == '-')
+    {
+        const char *c = *endptr;
+
+        if (!isdigit(c[1]) || !isdigit(c[2]) || c[3] != ':' || !isdigit(c[4]) || !isdigit(c[5]))
+            return PARSE_EFORM;
+
+        offset = ((c[1] - '0') * 10 + (c[2] - '0')) * 3600 + ((c[4] - '0') * 10 + (c[5] - '0')) * 60;
+
+        if (offset >= 24 * 3600 || (c[4] - '0') * 10 + (c[5] - '0') > 59)
+            return PARSE_EFORM;
+
+        if (*c == '-')
+            offset = -offset;
+
+        *endptr += 6;
+    }
+
+    seconds = daysFromCivil(fields[0], fields[1], fields[2]) * 86400
+              + fields[3] * 3600 + fields[4] * 60 + fields[5] - offset;
+
+    /* Checked separately for negative times so the fraction cannot overflow */
+    if (seconds >= 0)
+    {
+        if (seconds > (INT64_MAX - fraction) / NS_PER_SEC)
+            return PARSE_ERANGE;
+
+        *ns = seconds * NS_PER_SEC + fraction;
+    }
+    else
+    {
+        int64_t whole, remainder = fraction - NS_PER_SEC;
+
+        if (seconds < INT64_MIN / NS_PER_SEC - 1)
+            return PARSE_ERANGE;
+
+        whole = (seconds + 1) * NS_PER_SEC;
+
+        if (whole < INT64_MIN - remainder)
+            return PARSE_ERANGE;
+
+        *ns = whole + remainder;
+    }
+
+    /* Range checks */
+    if (*ns < min)
+        return PARSE_EMIN;
+    else if (*ns > max)
+        return PARSE_EMAX;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+/*
+ * Parse `n` timestamp strings with stringToTimestamp(), storing the result of
+ * each in `errors` (if not NULL). Return the number that failed
+ */
+size_t stringToTimestampBatch(int64_t *ns, ParseErr *errors, char **nptrs, size_t n, int64_t min, int64_t max)
+{
+    size_t failed = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        char *endptr;
+        ParseErr parseError = stringToTimestamp(&ns[i], nptrs[i], min, max, &endptr);
+
+        if (errors)
+            errors[i] = parseError;
+
+        if (parseError != PARSE_SUCCESS)
+            ++failed;
+
+        STATS_VALUE(parseError, endptr - nptrs[i]);
+    }
+
+    STATS_PUBLISH();
+
+    return failed;
+}
+
+
+/*
+ * Validate the layout of "YYYY-MM-DDTHH:MM:SS" and split it into year, month,
+ * day, hour, minute and second. Values are not range-checked
+ */
+static bool lexDateTime(const char *c, int fields[6])
+{
+    #if defined(__SSE2__)
+    /* Bits of the digit and separator positions in "YYYY-MM-DDTHH:MM" */
+    const int DIGITS = 0xDB6F;
+    const int SEPARATORS = 0x2090;
+
+    __m128i v, d, isDigit, isSeparator;
+    unsigned char digits[16];
+
+    /*
+     * The load may read past the end of a short string, which is harmless as
+     * long as it stays within the page (the check below then fails on the NUL)
+     */
+    if (PAGE_SIZE - ((uintptr_t) c & (PAGE_SIZE - 1)) < 16)
+    {
+        STATS_PATH(false);
+        return lexDateTimeScalar(c, fields);
+    }
+
+    STATS_PATH(true);
+
+    v = _mm_loadu_si128((const __m128i *) (const void *) c);
+    d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+
+    /* Digits are those with (c - '0') <= 9, unsigned */
+    isDigit = _mm_cmpeq_epi8(_mm_subs_epu8(d, _mm_set1_epi8(9)), _mm_setzero_si128());
+    isSeparator = _mm_cmpeq_epi8(v, _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 0, 0, 0, ':', 0, 0));
+
+    if ((_mm_movemask_epi8(isDigit) & DIGITS) != DIGITS
+        || (_mm_movemask_epi8(isSeparator) & SEPARATORS) != SEPARATORS
+        || (c[10] != 'T' && c[10] != 't' && c[10] != ' ')
+        || c[16] != ':' || !isdigit(c[17]) || !isdigit(c[18]))
+    {
+        return false;
+    }
+
+    _mm_storeu_si128((__m128i *) (void *) digits, d);
+
+    fields[0] = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 + digits[3];
+    fields[1] = digits[5] * 10 + digits[6];
+    fields[2] = digits[8] * 10 + digits[9];
+    fields[3] = digits[11] * 10 + digits[12];
+    fields[4] = digits[14] * 10 + digits[15];
+    fields[5] = (c[17] - '0') * 10 + (c[18] - '0');
+
+    return true;
+    #else
+    return lexDateTimeScalar(c, fields);
+    #endif
+}
+
+
+/* Character-at-a-time version of lexDateTime() */
+static bool lexDateTimeScalar(const char *c, int fields[6])
+{
+    const char LAYOUT[] = "0000-00-00T00:00:00";
+
+    for (size_t i = 0; i < sizeof(LAYOUT) - 1; ++i)
+    {
+        if (LAYOUT[i] == '0')
+        {
+            if (!isdigit(c[i]))
+                return false;
+        }
+        else if (i == 10)
+        {
+            if (c[i] != 'T' && c[i] != 't' && c[i] != ' ')
+                return false;
+        }
+        else if (c[i] != LAYOUT[i])
+        {
+            return false;
+        }
+    }
+
+    fields[0] = (c[0] - '0') * 1000 + (c[1] - '0') * 100 + (c[2] - '0') * 10 + (c[3] - '0');
+    fields[1] = (c[5] - '0') * 10 + (c[6] - '0');
+    fields[2] = (c[8] - '0') * 10 + (c[9] - '0');
+    fields[3] = (c[11] - '0') * 10 + (c[12] - '0');
+    fields[4] = (c[14] - '0') * 10 + (c[15] - '0');
+    fields[5] = (c[17] - '0') * 10 + (c[18] - '0');
+
+    return true;
+}
+
+
+/* Days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant) */
+static int64_t daysFromCivil(int year, int month, int day)
+{
+    int64_t y = year - (month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + doe - 719468;
+}
+
+
+static bool isLeapYear(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
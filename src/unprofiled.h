@@ -0,0 +1,63 @@
+#ifndef UNPROFILED_H
+#define UNPROFILED_H
+
+
+/*
+ * With PERCY_PROFILE, each public parser is compiled under an "Unprofiled"
+ * name, and the public name is defined in profile.c as a wrapper timing the
+ * call. Included before any public header, so that both the definitions and
+ * the library's own calls are renamed: only calls from outside the library are
+ * timed, once each. Not installed
+ */
+
+
+#ifdef PERCY_PROFILE
+#define stringToULong stringToULongUnprofiled
+#define stringToUIntMax stringToUIntMaxUnprofiled
+#define stringToDouble stringToDoubleUnprofiled
+#define stringToDoubleL stringToDoubleLUnprofiled
+#define stringToComplexPart stringToComplexPartUnprofiled
+#define stringToComplexPartL stringToComplexPartLUnprofiled
+#define stringToComplex stringToComplexUnprofiled
+#define stringToComplexL stringToComplexLUnprofiled
+#define stringToComplexDialect stringToComplexDialectUnprofiled
+#define stringToComplexDialectBatch stringToComplexDialectBatchUnprofiled
+#define stringToMemory stringToMemoryUnprofiled
+#define stringToULongUTF8 stringToULongUTF8Unprofiled
+#define stringToUIntMaxUTF8 stringToUIntMaxUTF8Unprofiled
+#define stringToDoubleUTF8 stringToDoubleUTF8Unprofiled
+#define stringToDoubleLUTF8 stringToDoubleLUTF8Unprofiled
+#define stringToULongGrouped stringToULongGroupedUnprofiled
+#define stringToUIntMaxGrouped stringToUIntMaxGroupedUnprofiled
+#define stringToDoubleGrouped stringToDoubleGroupedUnprofiled
+#define stringToULongU16 stringToULongU16Unprofiled
+#define stringToUIntMaxU16 stringToUIntMaxU16Unprofiled
+#define stringToDoubleU16 stringToDoubleU16Unprofiled
+#define stringToComplexU16 stringToComplexU16Unprofiled
+#define stringToMemoryU16 stringToMemoryU16Unprofiled
+#define stringToULongW stringToULongWUnprofiled
+#define stringToUIntMaxW stringToUIntMaxWUnprofiled
+#define stringToDoubleW stringToDoubleWUnprofiled
+#define stringToComplexW stringToComplexWUnprofiled
+#define stringToMemoryW stringToMemoryWUnprofiled
+#define stringToTimestamp stringToTimestampUnprofiled
+#define stringToTimestampBatch stringToTimestampBatchUnprofiled
+#define stringToDuration stringToDurationUnprofiled
+#define stringToDurationBatch stringToDurationBatchUnprofiled
+#define stringToBytes stringToBytesUnprofiled
+#define stringToValue stringToValueUnprofiled
+#define stringToQuantity stringToQuantityUnprofiled
+#define stringToQuantityU stringToQuantityUUnprofiled
+#define stringToLexed stringToLexedUnprofiled
+#define stringToMPZ stringToMPZUnprofiled
+#define stringToMPQ stringToMPQUnprofiled
+#define stringToMPFR stringToMPFRUnprofiled
+#define stringToMPFRParallel stringToMPFRParallelUnprofiled
+#define stringToMPFRAuto stringToMPFRAutoUnprofiled
+#define stringToComplexPartMPC stringToComplexPartMPCUnprofiled
+#define stringToComplexMPC stringToComplexMPCUnprofiled
+#define stringToComplexMPCAuto stringToComplexMPCAutoUnprofiled
+#endif
+
+
+#endif
@@ -0,0 +1,821 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "lexer.h"
+#include "tally.h"
+
+
+/* Normalised forms of a code point besides ASCII characters */
+#define UTF8_SPACE (-1)
+#define UTF8_GROUP (-2)
+#define UTF8_OTHER (-3)
+
+/* Significant digits always kept exactly in a uint64_t (a 20th may fit) */
+#define UTF8_DIGITS_MAX 19
+
+/* Largest integer below which every integer is exact as a double */
+#define CLINGER_MANTISSA_MAX (UINT64_C(1) << 53)
+
+/* Largest power of ten exact as a double */
+#define CLINGER_EXPONENT_MAX 22
+
+/* Numbers up to this length are normalised on the stack for strtod() */
+#define UTF8_BUFFER_SIZE 128
+
+
+/* A decimal number as lexed: its leading digits, scale and extent */
+struct Utf8Real
+{
+    uint64_t value;
+    size_t significant;     /* Digits after any leading zeros */
+    size_t dropped;         /* Significant digits that did not fit */
+    bool truncated;         /* Whether any dropped digit was non-zero */
+    long exponent;
+    bool negative;
+    char *start;            /* Sign, or first digit */
+    char *end;
+};
+
+
+static bool tokenIsASCII(const char *str);
+static char *utf8SkipSpace(char *c);
+static char *utf8Sign(char *c, bool *negative);
+static ParseErr utf8Integer(uintmax_t *x, char *nptr, char **endptr, int base, bool *negative);
+static ParseErr utf8Real(struct Utf8Real *real, char *nptr, char **endptr);
+static char *utf8Digits(struct Utf8Real *real, char *c, bool fraction);
+static bool utf8Copy(const struct Utf8Real *real, char *buffer, char **copy);
+
+static int utf8Normal(const char *c, int *length);
+static int utf8DigitValue(const char *c, int base, int *length);
+static bool utf8IsGroup(const char *c, int base);
+static int utf8Decode(const char *str, uint32_t *codePoint);
+static int normaliseCodePoint(uint32_t codePoint);
+static bool isSpaceCodePoint(uint32_t codePoint);
+static bool isExtendCodePoint(uint32_t codePoint);
+
+
+static const double POWERS_OF_TEN[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/*
+ * UTF-8 variants of the integer and floating-point parsers. As well as ASCII,
+ * these accept:
+ *   - The minus sign (U+2212) and full-width plus, minus and full stop
+ *   - Full-width digits (U+FF10 to U+FF19)
+ *   - No-break, thin and other Unicode spaces around the number
+ *   - No-break (U+00A0), figure (U+2007), thin (U+2009) and narrow no-break
+ *     (U+202F) spaces between digits, as digit grouping
+ *
+ * Pure ASCII input (found with an SSE2 scan where available) goes straight to
+ * the standard parser. Other numbers are normalised code point by code point
+ * as they are lexed, with no copy: integers are accumulated directly, and
+ * decimals of up to 19 significant digits with a small exponent are converted
+ * exactly with Clinger's fast path. Only longer decimals are normalised into a
+ * copy for strtod(). Errors and `endptr` are as for the standard parsers, with
+ * `endptr` pointing into `nptr`
+ */
+ParseErr stringToULongUTF8(unsigned long *x, char *nptr, unsigned long min, unsigned long max, char **endptr,
+                              int base)
+{
+    uintmax_t value;
+    bool negative;
+    ParseErr parseError;
+
+    if (tokenIsASCII(nptr))
+        return stringToULong(x, nptr, min, max, endptr, base);
+
+    parseError = utf8Integer(&value, nptr, endptr, base, &negative);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    if (value > ULONG_MAX)
+    {
+        *x = ULONG_MAX;
+        return PARSE_ERANGE;
+    }
+
+    /* Negated as strtoul() does */
+    *x = negative ? -(unsigned long) value : (unsigned long) value;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+    else if (negative && *x != 0)
+        return PARSE_EMIN;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+ParseErr stringToUIntMaxUTF8(uintmax_t *x, char *nptr, uintmax_t min, uintmax_t max, char **endptr, int base)
+{
+    bool negative;
+    ParseErr parseError;
+
+    if (tokenIsASCII(nptr))
+        return stringToUIntMax(x, nptr, min, max, endptr, base);
+
+    parseError = utf8Integer(x, nptr, endptr, base, &negative);
+
+    if (parseError != PARSE_SUCCESS)
+        return parseError;
+
+    /* Negated as strtoumax() does */
+    if (negative)
+        *x = -*x;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+    else if (negative && *x != 0)
+        return PARSE_EMIN;
+
+    /* If more characters in string */
+    return (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+}
+
+
+ParseErr stringToDoubleUTF8(double *x, char *nptr, double min, double max, char **endptr)
+{
+    struct Utf8Real real;
+    ParseErr parseError;
+
+    if (tokenIsASCII(nptr))
+        return stringToDouble(x, nptr, min, max, endptr);
+
+    parseError = utf8Real(&real, nptr, endptr);
+
+    /* Infinity, NaN and hexadecimal, which are ASCII after the sign */
+    if (parseError == PARSE_EFORM)
+    {
+        parseError = stringToDouble(x, *endptr, -HUGE_VAL, HUGE_VAL, endptr);
+
+        if (parseError == PARSE_EERR)
+            *endptr = nptr;
+        else if (real.negative)
+            *x = -*x;
+    }
+    else if (parseError != PARSE_SUCCESS)
+    {
+        return parseError;
+    }
+    else if (!real.truncated && real.value <= CLINGER_MANTISSA_MAX
+             && real.exponent >= -CLINGER_EXPONENT_MAX && real.exponent <= CLINGER_EXPONENT_MAX)
+    {
+        *x = (double) real.value;
+
+        if (real.exponent < 0)
+            *x /= POWERS_OF_TEN[-real.exponent];
+        else
+            *x *= POWERS_OF_TEN[real.exponent];
+
+        if (real.negative)
+            *x = -*x;
+
+        parseError = (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+    }
+    else
+    {
+        char buffer[UTF8_BUFFER_SIZE];
+        char *copy;
+
+        if (!utf8Copy(&real, buffer, &copy))
+            return PARSE_EERR;
+
+        errno = 0;
+        *x = strtod(copy, NULL);
+
+        if (copy != buffer)
+            free(copy);
+
+        if (errno == ERANGE)
+            return PARSE_ERANGE;
+
+        parseError = (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+    }
+
+    if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
+        return parseError;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    return parseError;
+}
+
+
+ParseErr stringToDoubleLUTF8(long double *x, char *nptr, long double min, long double max, char **endptr)
+{
+    struct Utf8Real real;
+    ParseErr parseError;
+
+    if (tokenIsASCII(nptr))
+        return stringToDoubleL(x, nptr, min, max, endptr);
+
+    parseError = utf8Real(&real, nptr, endptr);
+
+    /* Infinity, NaN and hexadecimal, which are ASCII after the sign */
+    if (parseError == PARSE_EFORM)
+    {
+        parseError = stringToDoubleL(x, *endptr, -HUGE_VALL, HUGE_VALL, endptr);
+
+        if (parseError == PARSE_EERR)
+            *endptr = nptr;
+        else if (real.negative)
+            *x = -*x;
+    }
+    else if (parseError != PARSE_SUCCESS)
+    {
+        return parseError;
+    }
+    else if (!real.truncated && real.value <= CLINGER_MANTISSA_MAX
+             && real.exponent >= -CLINGER_EXPONENT_MAX && real.exponent <= CLINGER_EXPONENT_MAX)
+    {
+        /* Exact in double, so exact in long double, and rounded once */
+        *x = (long double) real.value;
+
+        if (real.exponent < 0)
+            *x /= (long double) POWERS_OF_TEN[-real.exponent];
+        else
+            *x *= (long double) POWERS_OF_TEN[real.exponent];
+
+        if (real.negative)
+            *x = -*x;
+
+        parseError = (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+    }
+    else
+    {
+        char buffer[UTF8_BUFFER_SIZE];
+        char *copy;
+
+        if (!utf8Copy(&real, buffer, &copy))
+            return PARSE_EERR;
+
+        errno = 0;
+        *x = strtold(copy, NULL);
+
+        if (copy != buffer)
+            free(copy);
+
+        if (errno == ERANGE)
+            return PARSE_ERANGE;
+
+        parseError = (**endptr == '\0') ? PARSE_SUCCESS : PARSE_EEND;
+    }
+
+    if (parseError != PARSE_SUCCESS && parseError != PARSE_EEND)
+        return parseError;
+
+    /* Range checks */
+    if (*x < min)
+        return PARSE_EMIN;
+    else if (*x > max)
+        return PARSE_EMAX;
+
+    return parseError;
+}
+
+
+/*
+ * As strncpyGraph(), but for UTF-8: Unicode spaces and malformed bytes are
+ * dropped, and characters are copied whole, each together with any combining
+ * marks and variation selectors after it (and the character after a
+ * zero-width joiner), so the length limit never splits a combining sequence
+ */
+size_t strncpyGraphUTF8(char *dest, const char *src, size_t n)
+{
+    size_t j = 0;
+
+    if (n == 0)
+        return 0;
+
+    for (size_t i = 0; src[i] != '\0';)
+    {
+        uint32_t codePoint;
+        int length = utf8Decode(src + i, &codePoint);
+        size_t sequence;
+
+        /* Malformed bytes, controls and spaces are skipped */
+        if (length == 0 || (length == 1 && !isgraph(src[i]))
+            || (length > 1 && (isSpaceCodePoint(codePoint) || (codePoint >= 0x80 && codePoint < 0xA0))))
+        {
+            i += (length > 0) ? (size_t) length : 1;
+            continue;
+        }
+
+        sequence = (size_t) length;
+
+        /* Combining marks and joined characters that follow */
+        for (;;)
+        {
+            int next = utf8Decode(src + i + sequence, &codePoint);
+
+            if (next <= 1 || !isExtendCodePoint(codePoint))
+                break;
+
+            sequence += (size_t) next;
+
+            if (codePoint == 0x200D)
+            {
+                next = utf8Decode(src + i + sequence, &codePoint);
+
+                if (next == 0 || src[i + sequence] == '\0' || (next == 1 && !isgraph(src[i + sequence])))
+                    break;
+
+                sequence += (size_t) next;
+            }
+        }
+
+        if (j + sequence > n - 1)
+            break;
+
+        for (size_t k = 0; k < sequence; ++k)
+            dest[j++] = src[i + k];
+
+        i += sequence;
+    }
+
+    dest[j] = '\0';
+
+    /* Length of dest */
+    return j;
+}
+
+
+/*
+ * Whether the token at the start of `str` (after any leading ASCII spaces, up
+ * to the next byte <= ' ') is pure ASCII. Checks 16 bytes at a time with
+ * aligned loads, which cannot cross into an unmapped page
+ */
+static bool tokenIsASCII(const char *str)
+{
+    const unsigned char *c = (const unsigned char *) str;
+    bool ascii;
+
+    while (isspace(*c))
+        ++c;
+
+    #if defined(__SSE2__)
+    {
+        /* Bytes < 0x21 as signed chars, i.e. NUL, spaces, controls and all non-ASCII */
+        const __m128i LIMIT = _mm_set1_epi8(0x21);
+
+        size_t misalign = (uintptr_t) c & 15;
+        const unsigned char *block = c - misalign;
+        unsigned int mask;
+
+        mask = (unsigned int) _mm_movemask_epi8(_mm_cmpgt_epi8(LIMIT, _mm_load_si128((const __m128i *)
+                                                                                     (const void *) block)));
+        mask &= ~0u << misalign;
+
+        while (!mask)
+        {
+            block += 16;
+            mask = (unsigned int) _mm_movemask_epi8(_mm_cmpgt_epi8(LIMIT, _mm_load_si128((const __m128i *)
+                                                                                         (const void *) block)));
+        }
+
+        ascii = block[__builtin_ctz(mask)] < 0x80;
+    }
+    #else
+    while (*c > ' ' && *c < 0x80)
+        ++c;
+
+    ascii = *c < 0x80;
+    #endif
+
+    STATS_PATH(ascii);
+
+    return ascii;
+}
+
+
+/* Skip ASCII and Unicode spaces */
+static char *utf8SkipSpace(char *c)
+{
+    int length;
+
+    for (;; c += length)
+    {
+        int normal = utf8Normal(c, &length);
+
+        if (normal != UTF8_SPACE && normal != UTF8_GROUP)
+            return c;
+    }
+}
+
+
+/* Skip an ASCII or Unicode sign */
+static char *utf8Sign(char *c, bool *negative)
+{
+    int length;
+    int normal = utf8Normal(c, &length);
+
+    *negative = (normal == '-');
+
+    return (normal == '-' || normal == '+') ? c + length : c;
+}
+
+
+/*
+ * Lex an integer in `base` (0 for a prefix-selected base, as for strtoul()),
+ * accumulating its magnitude as its code points are read. Returns PARSE_EERR
+ * with `endptr` at the start if there are no digits, and PARSE_ERANGE if the
+ * magnitude does not fit in a uintmax_t
+ */
+static ParseErr utf8Integer(uintmax_t *x, char *nptr, char **endptr, int base, bool *negative)
+{
+    char *c;
+    int length, digit;
+    bool digits = false, overflow = false;
+
+    *x = 0;
+    *endptr = nptr;
+
+    if ((base < 2 && base != 0) || base > 36)
+        return PARSE_EBASE;
+
+    /* Get pointer to start of number */
+    c = utf8Sign(utf8SkipSpace(nptr), negative);
+
+    /* A "0x" prefix counts only if a hex digit follows */
+    if ((base == 0 || base == 16) && utf8Normal(c, &length) == '0' && length == 1 && (c[1] == 'x' || c[1] == 'X')
+        && utf8DigitValue(c + 2, 16, &length) >= 0)
+    {
+        c += 2;
+        base = 16;
+    }
+    else if (base == 0)
+    {
+        base = (utf8Normal(c, &length) == '0') ? 8 : 10;
+    }
+
+    for (;; c += length)
+    {
+        digit = utf8DigitValue(c, base, &length);
+
+        if (digit < 0)
+        {
+            if (digits && utf8IsGroup(c, base))
+                continue;
+
+            break;
+        }
+
+        if (*x > (UINTMAX_MAX - (uintmax_t) digit) / (uintmax_t) base)
+            overflow = true;
+        else
+            *x = *x * (uintmax_t) base + (uintmax_t) digit;
+
+        digits = true;
+    }
+
+    if (!digits)
+        return PARSE_EERR;
+
+    *endptr = c;
+
+    if (overflow)
+    {
+        *x = UINTMAX_MAX;
+        return PARSE_ERANGE;
+    }
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Lex a decimal real number as strtod() would, keeping its leading digits and
+ * scale. Returns PARSE_EFORM with `endptr` after the sign for the ASCII-only
+ * forms (infinity, NaN and hexadecimal), and PARSE_EERR if there is no number
+ */
+static ParseErr utf8Real(struct Utf8Real *real, char *nptr, char **endptr)
+{
+    char *c, *digits;
+    int length, normal;
+
+    real->value = 0;
+    real->significant = 0;
+    real->dropped = 0;
+    real->truncated = false;
+    real->exponent = 0;
+
+    *endptr = nptr;
+
+    /* Get pointer to start of number */
+    real->start = utf8SkipSpace(nptr);
+    c = utf8Sign(real->start, &real->negative);
+
+    if ((c[0] == '0' && (c[1] == 'x' || c[1] == 'X')) || (*c != '\0' && strchr("iInN", *c)))
+    {
+        *endptr = c;
+        return PARSE_EFORM;
+    }
+
+    digits = c;
+    c = utf8Digits(real, c, false);
+
+    if (utf8Normal(c, &length) == '.')
+    {
+        char *fraction = c + length;
+
+        c = utf8Digits(real, fraction, true);
+
+        /* A point needs digits on at least one side */
+        if (c == fraction && fraction - length == digits)
+            return PARSE_EERR;
+    }
+    else if (c == digits)
+    {
+        return PARSE_EERR;
+    }
+
+    /* An exponent needs digits, otherwise the 'e' belongs to what follows */
+    if (*c == 'e' || *c == 'E')
+    {
+        char *exponent = c + 1;
+        bool negativeExponent = false;
+        long value = 0;
+
+        normal = utf8Normal(exponent, &length);
+
+        if (normal == '+' || normal == '-')
+        {
+            negativeExponent = (normal == '-');
+            exponent += length;
+        }
+
+        if (utf8DigitValue(exponent, 10, &length) >= 0)
+        {
+            int digit;
+
+            for (c = exponent; (digit = utf8DigitValue(c, 10, &length)) >= 0; c += length)
+            {
+                if (value < 100000)
+                    value = value * 10 + digit;
+            }
+
+            real->exponent += negativeExponent ? -value : value;
+        }
+    }
+
+    real->end = *endptr = c;
+
+    return PARSE_SUCCESS;
+}
+
+
+/*
+ * Accumulate decimal digits and the group spaces between them, keeping as
+ * many significant digits as fit in a uint64_t. The exponent is scaled for
+ * each integer digit dropped and each fraction digit kept
+ */
+static char *utf8Digits(struct Utf8Real *real, char *c, bool fraction)
+{
+    int length, digit;
+    bool digits = false;
+
+    for (;; c += length)
+    {
+        digit = utf8DigitValue(c, 10, &length);
+
+        if (digit < 0)
+        {
+            if (digits && utf8IsGroup(c, 10))
+                continue;
+
+            return c;
+        }
+
+        digits = true;
+
+        if (real->significant == 0 && digit == 0)
+        {
+            /* Leading zeros */
+            if (fraction)
+                --real->exponent;
+        }
+        else if (real->dropped == 0
+                 && (real->significant < UTF8_DIGITS_MAX || real->value <= (UINT64_MAX - (uint64_t) digit) / 10))
+        {
+            real->value = real->value * 10 + (uint64_t) digit;
+            ++real->significant;
+
+            if (fraction)
+                --real->exponent;
+        }
+        else
+        {
+            ++real->dropped;
+
+            if (!fraction)
+                ++real->exponent;
+
+            if (digit)
+                real->truncated = true;
+        }
+    }
+}
+
+
+/*
+ * Normalise the lexed number into ASCII for strtod(), in `buffer` if it fits
+ * or else on the heap. Returns false if it cannot be allocated
+ */
+static bool utf8Copy(const struct Utf8Real *real, char *buffer, char **copy)
+{
+    size_t j = 0;
+    int length;
+
+    *copy = buffer;
+
+    /* Normalised, the number is never longer than its UTF-8 form */
+    if ((size_t) (real->end - real->start) >= UTF8_BUFFER_SIZE)
+    {
+        *copy = malloc((size_t) (real->end - real->start) + 1);
+
+        if (!*copy)
+            return false;
+    }
+
+    for (const char *c = real->start; c < real->end; c += length)
+    {
+        int normal = utf8Normal(c, &length);
+
+        if (normal >= 0)
+            (*copy)[j++] = (char) normal;
+    }
+
+    (*copy)[j] = '\0';
+
+    return true;
+}
+
+
+/*
+ * ASCII equivalent of the character at `c` (or UTF8_SPACE/GROUP/OTHER), and
+ * its length in bytes. NUL and malformed bytes are UTF8_OTHER
+ */
+static int utf8Normal(const char *c, int *length)
+{
+    uint32_t codePoint;
+
+    *length = utf8Decode(c, &codePoint);
+
+    if (*length == 0 || *c == '\0')
+    {
+        *length = 1;
+        return UTF8_OTHER;
+    }
+
+    if (*length == 1)
+        return isspace(*c) ? UTF8_SPACE : *c;
+
+    return normaliseCodePoint(codePoint);
+}
+
+
+/* Value of the digit at `c` in `base`, ASCII or full-width, or -1 */
+static int utf8DigitValue(const char *c, int base, int *length)
+{
+    int normal = utf8Normal(c, length);
+
+    return (normal > 0) ? lexDigitValue((char) normal, base) : -1;
+}
+
+
+/* Whether `c` is a group space followed by a digit in `base` */
+static bool utf8IsGroup(const char *c, int base)
+{
+    int length, nextLength;
+
+    return utf8Normal(c, &length) == UTF8_GROUP && utf8DigitValue(c + length, base, &nextLength) >= 0;
+}
+
+
+/*
+ * Decode the UTF-8 sequence at `str`, returning its length, or 0 if it is
+ * malformed (including overlong forms and surrogates)
+ */
+static int utf8Decode(const char *str, uint32_t *codePoint)
+{
+    const unsigned char *c = (const unsigned char *) str;
+    int length;
+
+    if (c[0] < 0x80)
+    {
+        *codePoint = c[0];
+        return 1;
+    }
+    else if (c[0] >= 0xC2 && c[0] <= 0xDF)
+    {
+        *codePoint = c[0] & 0x1Fu;
+        length = 2;
+    }
+    else if (c[0] >= 0xE0 && c[0] <= 0xEF)
+    {
+        *codePoint = c[0] & 0x0Fu;
+        length = 3;
+    }
+    else if (c[0] >= 0xF0 && c[0] <= 0xF4)
+    {
+        *codePoint = c[0] & 0x07u;
+        length = 4;
+    }
+    else
+    {
+        return 0;
+    }
+
+    for (int i = 1; i < length; ++i)
+    {
+        if ((c[i] & 0xC0) != 0x80)
+            return 0;
+
+        *codePoint = (*codePoint << 6) | (c[i] & 0x3Fu);
+    }
+
+    if ((length == 3 && *codePoint < 0x800) || (length == 4 && (*codePoint < 0x10000 || *codePoint > 0x10FFFF))
+        || (*codePoint >= 0xD800 && *codePoint <= 0xDFFF))
+    {
+        return 0;
+    }
+
+    return length;
+}
+
+
+/* ASCII equivalent of a non-ASCII code point, or UTF8_SPACE/GROUP/OTHER */
+static int normaliseCodePoint(uint32_t codePoint)
+{
+    if (codePoint >= 0xFF10 && codePoint <= 0xFF19)
+        return '0' + (int) (codePoint - 0xFF10);
+
+    switch (codePoint)
+    {
+        case 0x2212:    /* Minus sign */
+        case 0xFF0D:    /* Full-width hyphen-minus */
+            return '-';
+        case 0xFF0B:    /* Full-width plus sign */
+            return '+';
+        case 0xFF0E:    /* Full-width full stop */
+            return '.';
+        case 0x00A0:    /* No-break space */
+        case 0x2007:    /* Figure space */
+        case 0x2009:    /* Thin space */
+        case 0x202F:    /* Narrow no-break space */
+            return UTF8_GROUP;
+        default:
+            return isSpaceCodePoint(codePoint) ? UTF8_SPACE : UTF8_OTHER;
+    }
+}
+
+
+/* Unicode space separators (category Zs) besides U+0020 */
+static bool isSpaceCodePoint(uint32_t codePoint)
+{
+    return codePoint == 0x00A0 || codePoint == 0x1680 || (codePoint >= 0x2000 && codePoint <= 0x200A)
+           || codePoint == 0x202F || codePoint == 0x205F || codePoint == 0x3000;
+}
+
+
+/*
+ * Code points that extend the character before them: combining marks,
+ * variation selectors and the zero-width joiner
+ */
+static bool isExtendCodePoint(uint32_t codePoint)
+{
+    return (codePoint >= 0x0300 && codePoint <= 0x036F) || (codePoint >= 0x1AB0 && codePoint <= 0x1AFF)
+           || (codePoint >= 0x1DC0 && codePoint <= 0x1DFF) || (codePoint >= 0x20D0 && codePoint <= 0x20FF)
+           || (codePoint >= 0xFE00 && codePoint <= 0xFE0F) || (codePoint >= 0xFE20 && codePoint <= 0xFE2F)
+           || (codePoint >= 0xE0100 && codePoint <= 0xE01EF) || codePoint == 0x200D;
+}
@@ -0,0 +1,560 @@
+#include "unprofiled.h"
+#include "parser.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <uchar.h>
+#include <wchar.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/* Longest number narrowed into the stack; longer ones are narrowed onto the heap */
+#define WIDE_BUFFER_SIZE 256
+
+/* Size of a memory page, within which a 16-byte load can never fault */
+#define PAGE_SIZE 4096
+
+
+/* Whitespace a number may contain, beyond any leading it */
+enum WideSpaces
+{
+    WIDE_UNSPACED,      /* None: integers and reals */
+    WIDE_COMPLEX,       /* Around the operator and before the imaginary unit */
+    WIDE_MEMORY         /* Before the unit */
+};
+
+
+/* A number narrowed from wide input, and how narrowing stopped */
+struct WideToken
+{
+    char buffer[WIDE_BUFFER_SIZE];
+    char *text;
+    size_t length;
+    size_t capacity;
+    bool terminated;
+};
+
+
+static bool narrowUTF16(struct WideToken *token, const char16_t *str, enum WideSpaces spaces);
+static bool narrowWide(struct WideToken *token, const wchar_t *str, enum WideSpaces spaces);
+static bool narrowUnits(struct WideToken *token, const void *str, size_t width, enum WideSpaces spaces);
+static size_t narrowBlocksUTF16(struct WideToken *token, const char16_t *str, size_t i);
+static size_t narrowBlocksWide(struct WideToken *token, const wchar_t *str, size_t i);
+static bool tokenReserve(struct WideToken *token, size_t length);
+static uint32_t unitAt(const void *str, size_t width, size_t i);
+static bool isNumberUnit(uint32_t unit);
+static bool isSpaceUnit(uint32_t unit);
+static bool nearPageEnd(const void *ptr);
+static ParseErr wideFinish(ParseErr parseError, struct WideToken *token, const char *end, size_t *offset);
+
+
+/*
+ * Wide-character variants of the standard parsers, for UTF-16 (`char16_t`) and
+ * `wchar_t` text. Each works as its narrow counterpart, with `endptr` pointing
+ * into the wide string
+ *
+ * Only the number itself is narrowed, as it is read: its leading whitespace,
+ * then its ASCII letters, digits, signs and points (8 at a time with SSE2 pack
+ * instructions where available), stopping at the first unit that cannot
+ * continue it, such as whitespace or a field separator. Numbers that do not
+ * fit a small stack buffer are narrowed onto the heap, returning PARSE_EERR if
+ * it cannot be allocated
+ */
+ParseErr stringToULongU16(unsigned long *x, char16_t *nptr, unsigned long min, unsigned long max, char16_t **endptr,
+                             int base)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowUTF16(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToULong(x, token.text, min, max, &end, base);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToUIntMaxU16(uintmax_t *x, char16_t *nptr, uintmax_t min, uintmax_t max, char16_t **endptr,
+                               int base)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowUTF16(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToUIntMax(x, token.text, min, max, &end, base);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToDoubleU16(double *x, char16_t *nptr, double min, double max, char16_t **endptr)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowUTF16(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToDouble(x, token.text, min, max, &end);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToComplexU16(complex *z, char16_t *nptr, complex min, complex max, char16_t **endptr)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowUTF16(&token, nptr, WIDE_COMPLEX))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToComplex(z, token.text, min, max, &end);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToMemoryU16(size_t *bytes, char16_t *nptr, size_t min, size_t max, char16_t **endptr,
+                              int magnitude)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowUTF16(&token, nptr, WIDE_MEMORY))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToMemory(bytes, token.text, min, max, &end, magnitude);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToULongW(unsigned long *x, wchar_t *nptr, unsigned long min, unsigned long max, wchar_t **endptr,
+                           int base)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowWide(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToULong(x, token.text, min, max, &end, base);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToUIntMaxW(uintmax_t *x, wchar_t *nptr, uintmax_t min, uintmax_t max, wchar_t **endptr, int base)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowWide(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToUIntMax(x, token.text, min, max, &end, base);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToDoubleW(double *x, wchar_t *nptr, double min, double max, wchar_t **endptr)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowWide(&token, nptr, WIDE_UNSPACED))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToDouble(x, token.text, min, max, &end);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToComplexW(complex *z, wchar_t *nptr, complex min, complex max, wchar_t **endptr)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowWide(&token, nptr, WIDE_COMPLEX))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToComplex(z, token.text, min, max, &end);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+ParseErr stringToMemoryW(size_t *bytes, wchar_t *nptr, size_t min, size_t max, wchar_t **endptr, int magnitude)
+{
+    struct WideToken token;
+    char *end;
+    size_t offset;
+    ParseErr parseError;
+
+    if (!narrowWide(&token, nptr, WIDE_MEMORY))
+    {
+        *endptr = nptr;
+        return PARSE_EERR;
+    }
+
+    parseError = stringToMemory(bytes, token.text, min, max, &end, magnitude);
+    parseError = wideFinish(parseError, &token, end, &offset);
+    *endptr = nptr + offset;
+
+    return parseError;
+}
+
+
+/* Narrow the number at the start of a UTF-16 string */
+static bool narrowUTF16(struct WideToken *token, const char16_t *str, enum WideSpaces spaces)
+{
+    return narrowUnits(token, str, sizeof(*str), spaces);
+}
+
+
+/* Narrow the number at the start of a wide string */
+static bool narrowWide(struct WideToken *token, const wchar_t *str, enum WideSpaces spaces)
+{
+    return narrowUnits(token, str, sizeof(*str), spaces);
+}
+
+
+/*
+ * Narrow leading whitespace and then the units of a number, blocks of 8 at a
+ * time while they are all letters, digits, signs or points, and otherwise one
+ * at a time. Whitespace after the start is only taken where `spaces` allows
+ * the number to go on after it. Returns false if memory cannot be allocated
+ */
+static bool narrowUnits(struct WideToken *token, const void *str, size_t width, enum WideSpaces spaces)
+{
+    uint32_t unit, last = 0;
+    size_t i = 0;
+
+    token->text = token->buffer;
+    token->length = 0;
+    token->capacity = WIDE_BUFFER_SIZE;
+
+    for (; isSpaceUnit(unit = unitAt(str, width, i)); ++i)
+    {
+        if (!tokenReserve(token, 1))
+            return false;
+
+        token->text[token->length++] = (char) unit;
+    }
+
+    for (;;)
+    {
+        size_t j;
+        bool more;
+
+        if (width == sizeof(char16_t))
+            i = narrowBlocksUTF16(token, str, i);
+        else
+            i = narrowBlocksWide(token, str, i);
+
+        if (i == SIZE_MAX)
+            return false;
+
+        if (token->length > 0)
+            last = (unsigned char) token->text[token->length - 1];
+
+        unit = unitAt(str, width, i);
+
+        if (isNumberUnit(unit))
+        {
+            if (!tokenReserve(token, 1))
+                return false;
+
+            token->text[token->length++] = (char) unit;
+            ++i;
+            continue;
+        }
+
+        if (spaces == WIDE_UNSPACED || !isSpaceUnit(unit) || last == 0)
+            break;
+
+        /*
+         * Whitespace inside the number only if what follows it continues the
+         * number. The complex parsers read on over whitespace after a part
+         * before deciding, so it is narrowed either way for `endptr` to match
+         */
+        for (j = i; isSpaceUnit(unitAt(str, width, j)); ++j)
+            ;
+
+        unit = unitAt(str, width, j);
+
+        if (spaces == WIDE_COMPLEX)
+            more = unit == '+' || unit == '-' || unit == 'i' || unit == 'I'
+                   || (isNumberUnit(unit) && (last == '+' || last == '-'));
+        else
+            more = unit < 0x80 && (unit | 0x20) >= 'a' && (unit | 0x20) <= 'z';
+
+        if (!more && spaces != WIDE_COMPLEX)
+            break;
+
+        if (!tokenReserve(token, j - i))
+            return false;
+
+        for (; i < j; ++i)
+            token->text[token->length++] = (char) unitAt(str, width, i);
+
+        if (!more)
+            break;
+    }
+
+    token->text[token->length] = '\0';
+    token->terminated = (unitAt(str, width, i) == 0);
+
+    return true;
+}
+
+
+/*
+ * Narrow 8 UTF-16 units at a time while all are letters, digits, signs or
+ * points. Returns the index of the first unit left, or SIZE_MAX if memory
+ * cannot be allocated
+ */
+static size_t narrowBlocksUTF16(struct WideToken *token, const char16_t *str, size_t i)
+{
+    #if defined(__SSE2__)
+    const __m128i CASE = _mm_set1_epi16(0x20);
+
+    for (; !nearPageEnd(str + i); i += 8)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (const void *) (str + i));
+        __m128i lower = _mm_or_si128(v, CASE);
+
+        /* Units are compared as signed, so any at or above 0x8000 are in no range */
+        __m128i number = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('0' - 1)), _mm_cmplt_epi16(v, _mm_set1_epi16('9' + 1))),
+                _mm_and_si128(_mm_cmpgt_epi16(lower, _mm_set1_epi16('a' - 1)),
+                              _mm_cmplt_epi16(lower, _mm_set1_epi16('z' + 1)))),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('+')), _mm_cmpeq_epi16(v, _mm_set1_epi16('-'))),
+                         _mm_cmpeq_epi16(v, _mm_set1_epi16('.'))));
+
+        if (_mm_movemask_epi8(number) != 0xFFFF)
+            break;
+
+        if (!tokenReserve(token, 8))
+            return SIZE_MAX;
+
+        _mm_storel_epi64((__m128i *) (void *) (token->text + token->length), _mm_packus_epi16(v, v));
+        token->length += 8;
+    }
+    #else
+    (void) token;
+    (void) str;
+    #endif
+
+    return i;
+}
+
+
+/* As narrowBlocksUTF16(), for wide strings, 8 units being two loads */
+static size_t narrowBlocksWide(struct WideToken *token, const wchar_t *str, size_t i)
+{
+    #if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+    const __m128i CASE = _mm_set1_epi16(0x20);
+
+    for (; !nearPageEnd(str + i) && !nearPageEnd(str + i + 4); i += 8)
+    {
+        /* 32 to 16 bits with signed saturation, which keeps large units out of every range */
+        __m128i v = _mm_packs_epi32(_mm_loadu_si128((const __m128i *) (const void *) (str + i)),
+                                    _mm_loadu_si128((const __m128i *) (const void *) (str + i + 4)));
+        __m128i lower = _mm_or_si128(v, CASE);
+        __m128i number = _mm_or_si128(
+            _mm_or_si128(
+                _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('0' - 1)), _mm_cmplt_epi16(v, _mm_set1_epi16('9' + 1))),
+                _mm_and_si128(_mm_cmpgt_epi16(lower, _mm_set1_epi16('a' - 1)),
+                              _mm_cmplt_epi16(lower, _mm_set1_epi16('z' + 1)))),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('+')), _mm_cmpeq_epi16(v, _mm_set1_epi16('-'))),
+                         _mm_cmpeq_epi16(v, _mm_set1_epi16('.'))));
+
+        if (_mm_movemask_epi8(number) != 0xFFFF)
+            break;
+
+        if (!tokenReserve(token, 8))
+            return SIZE_MAX;
+
+        _mm_storel_epi64((__m128i *) (void *) (token->text + token->length), _mm_packus_epi16(v, v));
+        token->length += 8;
+    }
+    #else
+    (void) token;
+    (void) str;
+    #endif
+
+    return i;
+}
+
+
+/*
+ * Make room for `length` more characters and a terminator, moving the token
+ * to the heap once it outgrows the stack buffer
+ */
+static bool tokenReserve(struct WideToken *token, size_t length)
+{
+    size_t capacity = token->capacity;
+    char *text;
+
+    if (token->length + length < capacity)
+        return true;
+
+    while (token->length + length >= capacity)
+        capacity *= 2;
+
+    if (token->text == token->buffer)
+    {
+        text = malloc(capacity);
+
+        if (text)
+            memcpy(text, token->buffer, token->length);
+    }
+    else
+    {
+        text = realloc(token->text, capacity);
+    }
+
+    if (!text)
+    {
+        if (token->text != token->buffer)
+            free(token->text);
+
+        token->text = token->buffer;
+        return false;
+    }
+
+    token->text = text;
+    token->capacity = capacity;
+
+    return true;
+}
+
+
+/* Code unit `i` of a UTF-16 or wide string, with negative wide characters as invalid */
+static uint32_t unitAt(const void *str, size_t width, size_t i)
+{
+    if (width == sizeof(char16_t))
+        return ((const char16_t *) str)[i];
+
+    return (((const wchar_t *) str)[i] < 0) ? UINT32_MAX : (uint32_t) ((const wchar_t *) str)[i];
+}
+
+
+/* Letters, digits, signs and points: every unit a number can be made of, bar whitespace */
+static bool isNumberUnit(uint32_t unit)
+{
+    return (unit >= '0' && unit <= '9') || ((unit | 0x20) >= 'a' && (unit | 0x20) <= 'z' && unit < 0x80)
+           || unit == '+' || unit == '-' || unit == '.';
+}
+
+
+static bool isSpaceUnit(uint32_t unit)
+{
+    return unit == ' ' || (unit >= '\t' && unit <= '\r');
+}
+
+
+/* Whether a 16-byte load from `ptr` could cross into the next page */
+static bool nearPageEnd(const void *ptr)
+{
+    return PAGE_SIZE - ((uintptr_t) ptr & (PAGE_SIZE - 1)) < 16;
+}
+
+
+/*
+ * Turn the result of parsing a narrowed token into the result for the wide
+ * string, with the offset of `end` in code units, and free the token
+ */
+static ParseErr wideFinish(ParseErr parseError, struct WideToken *token, const char *end, size_t *offset)
+{
+    *offset = (size_t) (end - token->text);
+
+    if (token->text != token->buffer)
+        free(token->text);
+
+    if (*offset < token->length)
+        return parseError;
+
+    /* Narrowing stopped at a unit the number cannot include */
+    if (parseError == PARSE_SUCCESS && !token->terminated)
+        return PARSE_EEND;
+
+    return parseError;
+}
@@ -0,0 +1,844 @@
+#include "../include/parser.h"
+#include "../include/lexed.h"
+#include "../include/quantity.h"
+
+#include <complex.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wchar.h>
+
+#ifdef MP_PREC
+#include <gmp.h>
+#include <mpfr.h>
+#include <mpc.h>
+#endif
+
+
+/*
+ * Allocation check: counts the heap allocations made while parsing each kind
+ * of value, by interposing malloc() and friends (and GMP's memory functions in
+ * the multiple-precision build). Exits with status 1 if a path marked
+ * allocation-free allocates
+ */
+
+
+/* Calls of each case counted, after as many uncounted to warm up lazy initialisation */
+#define ALLOC_CALLS 1000
+
+/* Values parsed by each call of a batch parser */
+#define ALLOC_BATCH 4
+
+
+/* A parse of one value, and whether it must never allocate */
+struct AllocCase
+{
+    const char *name;
+    void (*parse)(void);
+    bool allocationFree;
+};
+
+
+/* glibc's allocator, under the names it exports for interposers */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+/* Not declared by <stdlib.h> in C99, but interposed all the same */
+void *aligned_alloc(size_t alignment, size_t size);
+int posix_memalign(void **ptr, size_t alignment, size_t size);
+
+
+static void count(unsigned long *counter);
+
+#ifdef MP_PREC
+static void *gmpAllocate(size_t size);
+static void *gmpReallocate(void *ptr, size_t oldSize, size_t newSize);
+static void gmpFree(void *ptr, size_t size);
+#endif
+
+static void parseULong(void);
+static void parseUIntMax(void);
+static void parseDouble(void);
+static void parseDoubleLong(void);
+static void parseDoubleL(void);
+static void parseComplexPart(void);
+static void parseComplexPartL(void);
+static void parseComplex(void);
+static void parseComplexL(void);
+static void parseComplexDialect(void);
+static void parseComplexDialectBatch(void);
+static void parseMemory(void);
+static void parseULongUTF8(void);
+static void parseUIntMaxUTF8(void);
+static void parseDoubleUTF8(void);
+static void parseDoubleLUTF8(void);
+static void parseULongGrouped(void);
+static void parseUIntMaxGrouped(void);
+static void parseDoubleGrouped(void);
+static void parseDoubleGroupedLong(void);
+static void parseULongU16(void);
+static void parseUIntMaxU16(void);
+static void parseDoubleU16(void);
+static void parseComplexU16(void);
+static void parseMemoryU16(void);
+static void parseULongW(void);
+static void parseUIntMaxW(void);
+static void parseDoubleW(void);
+static void parseComplexW(void);
+static void parseMemoryW(void);
+static void parseTimestamp(void);
+static void parseTimestampBatch(void);
+static void parseDuration(void);
+static void parseDurationBatch(void);
+static void parseBytes(void);
+static void parseValue(void);
+static void parseQuantity(void);
+static void parseQuantityU(void);
+static void parseLexed(void);
+static void parseLexedL(void);
+static void parseLexedComplex(void);
+
+#ifdef MP_PREC
+static void parseMPZ(void);
+static void parseMPQ(void);
+static void parseMPFR(void);
+static void parseMPFRParallel(void);
+static void parseMPFRAuto(void);
+static void parseComplexPartMPC(void);
+static void parseComplexMPC(void);
+static void parseComplexMPCAuto(void);
+static void parseLexedMPFR(void);
+static void parseLexedMPC(void);
+#endif
+
+
+/* Allocations counted while `counting`, from any thread */
+static bool counting;
+static unsigned long mallocs, frees, gmpAllocs;
+
+static QuantityTable *quantities;
+
+#ifdef MP_PREC
+static mpz_t mpzx;
+static mpq_t mpqx;
+static mpfr_t mpfrx;
+static mpc_t mpcx;
+#endif
+
+
+static const struct AllocCase CASES[] =
+{
+    {"stringToULong", parseULong, true},
+    {"stringToUIntMax", parseUIntMax, true},
+    {"stringToDouble", parseDouble, true},
+    {"stringToDouble (800 digits)", parseDoubleLong, true},
+    {"stringToDoubleL", parseDoubleL, true},
+    {"stringToComplexPart", parseComplexPart, true},
+    {"stringToComplexPartL", parseComplexPartL, true},
+    {"stringToComplex", parseComplex, true},
+    {"stringToComplexL", parseComplexL, true},
+    {"stringToComplexDialect", parseComplexDialect, true},
+    {"stringToComplexDialectBatch (4)", parseComplexDialectBatch, true},
+    {"stringToMemory", parseMemory, true},
+    {"stringToULongUTF8", parseULongUTF8, true},
+    {"stringToUIntMaxUTF8", parseUIntMaxUTF8, true},
+    {"stringToDoubleUTF8", parseDoubleUTF8, true},
+    {"stringToDoubleLUTF8", parseDoubleLUTF8, true},
+    {"stringToULongGrouped", parseULongGrouped, true},
+    {"stringToUIntMaxGrouped", parseUIntMaxGrouped, true},
+    {"stringToDoubleGrouped", parseDoubleGrouped, true},
+    {"stringToDoubleGrouped (long)", parseDoubleGroupedLong, false},
+    {"stringToULongU16", parseULongU16, true},
+    {"stringToUIntMaxU16", parseUIntMaxU16, true},
+    {"stringToDoubleU16", parseDoubleU16, true},
+    {"stringToComplexU16", parseComplexU16, true},
+    {"stringToMemoryU16", parseMemoryU16, true},
+    {"stringToULongW", parseULongW, true},
+    {"stringToUIntMaxW", parseUIntMaxW, true},
+    {"stringToDoubleW", parseDoubleW, true},
+    {"stringToComplexW", parseComplexW, true},
+    {"stringToMemoryW", parseMemoryW, true},
+    {"stringToTimestamp", parseTimestamp, true},
+    {"stringToTimestampBatch (4)", parseTimestampBatch, true},
+    {"stringToDuration", parseDuration, true},
+    {"stringToDurationBatch (4)", parseDurationBatch, true},
+    {"stringToBytes", parseBytes, true},
+    {"stringToValue", parseValue, true},
+    {"stringToQuantity", parseQuantity, true},
+    {"stringToQuantityU", parseQuantityU, true},
+    {"stringToLexed + lexedToDouble", parseLexed, true},
+    {"stringToLexed + lexedToDoubleL", parseLexedL, true},
+    {"stringToLexed + lexedToComplex", parseLexedComplex, true},
+
+    /* Reported only: GMP and MPFR allocate their own temporaries while converting */
+    #ifdef MP_PREC
+    {"stringToMPZ", parseMPZ, false},
+    {"stringToMPQ", parseMPQ, false},
+    {"stringToMPFR", parseMPFR, false},
+    {"stringToMPFRParallel", parseMPFRParallel, false},
+    {"stringToMPFRAuto", parseMPFRAuto, false},
+    {"stringToComplexPartMPC", parseComplexPartMPC, false},
+    {"stringToComplexMPC", parseComplexMPC, false},
+    {"stringToComplexMPCAuto", parseComplexMPCAuto, false},
+    {"lexedToMPFR", parseLexedMPFR, false},
+    {"lexedToMPC", parseLexedMPC, false},
+    #endif
+};
+
+
+int main(int argc, char **argv)
+{
+    const QuantityUnit UNITS[] = {{"bps", 1, QUANTITY_SI}, {"B", 1, QUANTITY_ALL}};
+
+    char *program = argv[0];
+    int failures = 0;
+
+    (void) argc;
+
+    if (quantityTableCreate(&quantities, UNITS, sizeof(UNITS) / sizeof(UNITS[0])) != PARSE_SUCCESS)
+    {
+        fprintf(stderr, "%s: Cannot create quantity table\n", program);
+        return 1;
+    }
+
+    #ifdef MP_PREC
+    mp_set_memory_functions(gmpAllocate, gmpReallocate, gmpFree);
+
+    mpz_init(mpzx);
+    mpq_init(mpqx);
+    mpfr_init2(mpfrx, 256);
+    mpc_init2(mpcx, 256);
+    #endif
+
+    printf("%-32s %12s %12s %12s\n", "function", "mallocs", "frees", "gmp allocs");
+
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i)
+    {
+        const struct AllocCase *allocCase = &CASES[i];
+        unsigned long total;
+
+        for (int call = 0; call < ALLOC_CALLS; ++call)
+            allocCase->parse();
+
+        mallocs = frees = gmpAllocs = 0;
+        __atomic_store_n(&counting, true, __ATOMIC_SEQ_CST);
+
+        for (int call = 0; call < ALLOC_CALLS; ++call)
+            allocCase->parse();
+
+        __atomic_store_n(&counting, false, __ATOMIC_SEQ_CST);
+
+        total = mallocs + gmpAllocs;
+
+        printf("%-32s %12.3f %12.3f %12.3f%s\n", allocCase->name, (double) mallocs / ALLOC_CALLS,
+               (double) frees / ALLOC_CALLS, (double) gmpAllocs / ALLOC_CALLS,
+               (allocCase->allocationFree && total) ? "  FAIL: must not allocate" : "");
+
+        if (allocCase->allocationFree && total)
+            ++failures;
+    }
+
+    #ifdef MP_PREC
+    mpz_clear(mpzx);
+    mpq_clear(mpqx);
+    mpfr_clear(mpfrx);
+    mpc_clear(mpcx);
+    #endif
+
+    quantityTableDestroy(quantities);
+
+    if (failures)
+    {
+        fprintf(stderr, "%s: %d allocation-free path(s) allocated\n", program, failures);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+void *malloc(size_t size)
+{
+    count(&mallocs);
+    return __libc_malloc(size);
+}
+
+
+void *calloc(size_t n, size_t size)
+{
+    count(&mallocs);
+    return __libc_calloc(n, size);
+}
+
+
+void *realloc(void *ptr, size_t size)
+{
+    count(&mallocs);
+    return __libc_realloc(ptr, size);
+}
+
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count(&mallocs);
+    return __libc_memalign(alignment, size);
+}
+
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    count(&mallocs);
+    *ptr = __libc_memalign(alignment, size);
+
+    return *ptr ? 0 : ENOMEM;
+}
+
+
+void free(void *ptr)
+{
+    if (ptr)
+        count(&frees);
+
+    __libc_free(ptr);
+}
+
+
+/* Count an allocation or free if counting */
+static void count(unsigned long *counter)
+{
+    if (__atomic_load_n(&counting, __ATOMIC_RELAXED))
+        __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+
+#ifdef MP_PREC
+static void *gmpAllocate(size_t size)
+{
+    count(&gmpAllocs);
+    return __libc_malloc(size);
+}
+
+
+static void *gmpReallocate(void *ptr, size_t oldSize, size_t newSize)
+{
+    (void) oldSize;
+
+    count(&gmpAllocs);
+    return __libc_realloc(ptr, newSize);
+}
+
+
+static void gmpFree(void *ptr, size_t size)
+{
+    (void) size;
+
+    count(&frees);
+    __libc_free(ptr);
+}
+#endif
+
+
+static void parseULong(void)
+{
+    unsigned long x;
+    char *endptr;
+
+    stringToULong(&x, "18446744073709551", 0, ULONG_MAX, &endptr, BASE_DEC);
+}
+
+
+static void parseUIntMax(void)
+{
+    uintmax_t x;
+    char *endptr;
+
+    stringToUIntMax(&x, "0x7fffffffffff", 0, UINTMAX_MAX, &endptr, 0);
+}
+
+
+static void parseDouble(void)
+{
+    double x;
+    char *endptr;
+
+    stringToDouble(&x, "-2.2250738585072011e-308", -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void parseDoubleLong(void)
+{
+    static char digits[802];
+    double x;
+    char *endptr;
+
+    if (!digits[0])
+    {
+        for (size_t i = 0; i < sizeof(digits) - 1; ++i)
+            digits[i] = (char) ('1' + i % 9);
+
+        digits[1] = '.';
+    }
+
+    stringToDouble(&x, digits, -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void parseDoubleL(void)
+{
+    long double x;
+    char *endptr;
+
+    stringToDoubleL(&x, "3.14159265358979323846264338327950288", -LDBL_MAX, LDBL_MAX, &endptr);
+}
+
+
+static void parseComplexPart(void)
+{
+    complex z = 0.0;
+    ComplexPt type;
+    char *endptr;
+
+    stringToComplexPart(&z, "-2.5e-3i", CMPLX_MIN, CMPLX_MAX, &endptr, &type);
+}
+
+
+static void parseComplexPartL(void)
+{
+    long double complex z = 0.0L;
+    ComplexPt type;
+    char *endptr;
+
+    stringToComplexPartL(&z, "0.333333333333333333333", -LDBL_MAX - LDBL_MAX * I, LDBL_MAX + LDBL_MAX * I, &endptr,
+                         &type);
+}
+
+
+static void parseComplex(void)
+{
+    complex z;
+    char *endptr;
+
+    stringToComplex(&z, "1.5e3 - 2.25i", CMPLX_MIN, CMPLX_MAX, &endptr);
+}
+
+
+static void parseComplexL(void)
+{
+    long double complex z;
+    char *endptr;
+
+    stringToComplexL(&z, "-7i + 0.125", -LDBL_MAX - LDBL_MAX * I, LDBL_MAX + LDBL_MAX * I, &endptr);
+}
+
+
+static void parseComplexDialect(void)
+{
+    complex z;
+    char *endptr;
+
+    stringToComplexDialect(&z, "(1.5+2j)", CMPLX_MIN, CMPLX_MAX, &endptr, DIALECT_ANY);
+}
+
+
+static void parseComplexDialectBatch(void)
+{
+    static char *tokens[ALLOC_BATCH] = {"1+2i", "(3.5-1j)", "4.25", "-i"};
+    complex z[ALLOC_BATCH];
+    ParseErr errors[ALLOC_BATCH];
+
+    stringToComplexDialectBatch(z, errors, tokens, ALLOC_BATCH, CMPLX_MIN, CMPLX_MAX, DIALECT_ANY);
+}
+
+
+static void parseMemory(void)
+{
+    size_t bytes;
+    char *endptr;
+
+    stringToMemory(&bytes, "512KiB", 0, SIZE_MAX, &endptr, MEM_B);
+}
+
+
+static void parseULongUTF8(void)
+{
+    unsigned long x;
+    char *endptr;
+
+    stringToULongUTF8(&x, "\xEF\xBC\x91\xEF\xBC\x92\xEF\xBC\x93" "456", 0, ULONG_MAX, &endptr, BASE_DEC);
+}
+
+
+static void parseUIntMaxUTF8(void)
+{
+    uintmax_t x;
+    char *endptr;
+
+    stringToUIntMaxUTF8(&x, "\xC2\xA0" "18\xE2\x80\xAF" "446\xE2\x80\xAF" "744", 0, UINTMAX_MAX, &endptr, BASE_DEC);
+}
+
+
+static void parseDoubleUTF8(void)
+{
+    double x;
+    char *endptr;
+
+    stringToDoubleUTF8(&x, "\xE2\x88\x92" "1\xE2\x80\xAF" "234.5", -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void parseDoubleLUTF8(void)
+{
+    long double x;
+    char *endptr;
+
+    stringToDoubleLUTF8(&x, "\xE2\x88\x92" "2.718281828459045235360287", -LDBL_MAX, LDBL_MAX, &endptr);
+}
+
+
+static void parseULongGrouped(void)
+{
+    unsigned long x;
+    char *endptr;
+
+    stringToULongGrouped(&x, "4_294_967_295", 0, ULONG_MAX, &endptr, '_', true);
+}
+
+
+static void parseUIntMaxGrouped(void)
+{
+    uintmax_t x;
+    char *endptr;
+
+    stringToUIntMaxGrouped(&x, "18,446,744,073,709,551,615", 0, UINTMAX_MAX, &endptr, ',', true);
+}
+
+
+static void parseDoubleGrouped(void)
+{
+    double x;
+    char *endptr;
+
+    stringToDoubleGrouped(&x, "1,234,567.891", -DBL_MAX, DBL_MAX, &endptr, ',', true);
+}
+
+
+/* Longer than the stack buffer of stringToDoubleGrouped(), so it takes the heap */
+static void parseDoubleGroupedLong(void)
+{
+    static char digits[256];
+    double x;
+    char *endptr;
+
+    if (!digits[0])
+    {
+        for (size_t i = 0; i < sizeof(digits) - 1; ++i)
+            digits[i] = (i % 4 == 3) ? ',' : '1';
+    }
+
+    stringToDoubleGrouped(&x, digits, -DBL_MAX, DBL_MAX, &endptr, ',', true);
+}
+
+
+static void parseULongU16(void)
+{
+    static char16_t text[] = {'4', '2', '9', '4', '9', '6', '7', '2', '9', '5', 0};
+    unsigned long x;
+    char16_t *endptr;
+
+    stringToULongU16(&x, text, 0, ULONG_MAX, &endptr, BASE_DEC);
+}
+
+
+static void parseUIntMaxU16(void)
+{
+    static char16_t text[] = {' ', '0', 'x', 'f', 'f', 'f', 'f', 0};
+    uintmax_t x;
+    char16_t *endptr;
+
+    stringToUIntMaxU16(&x, text, 0, UINTMAX_MAX, &endptr, 0);
+}
+
+
+static void parseDoubleU16(void)
+{
+    static char16_t text[] = {'6', '.', '0', '2', '2', 'e', '2', '3', 0};
+    double x;
+    char16_t *endptr;
+
+    stringToDoubleU16(&x, text, -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void parseComplexU16(void)
+{
+    static char16_t text[] = {'1', ' ', '-', ' ', '2', 'i', 0};
+    complex z;
+    char16_t *endptr;
+
+    stringToComplexU16(&z, text, CMPLX_MIN, CMPLX_MAX, &endptr);
+}
+
+
+static void parseMemoryU16(void)
+{
+    static char16_t text[] = {'1', '.', '5', ' ', 'G', 'B', 0};
+    size_t bytes;
+    char16_t *endptr;
+
+    stringToMemoryU16(&bytes, text, 0, SIZE_MAX, &endptr, MEM_B);
+}
+
+
+static void parseULongW(void)
+{
+    static wchar_t text[] = L"65535";
+    unsigned long x;
+    wchar_t *endptr;
+
+    stringToULongW(&x, text, 0, ULONG_MAX, &endptr, BASE_DEC);
+}
+
+
+static void parseUIntMaxW(void)
+{
+    static wchar_t text[] = L"0777";
+    uintmax_t x;
+    wchar_t *endptr;
+
+    stringToUIntMaxW(&x, text, 0, UINTMAX_MAX, &endptr, 0);
+}
+
+
+static void parseDoubleW(void)
+{
+    static wchar_t text[] = L"-1.25e-7";
+    double x;
+    wchar_t *endptr;
+
+    stringToDoubleW(&x, text, -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void parseComplexW(void)
+{
+    static wchar_t text[] = L"3 + 4i";
+    complex z;
+    wchar_t *endptr;
+
+    stringToComplexW(&z, text, CMPLX_MIN, CMPLX_MAX, &endptr);
+}
+
+
+static void parseMemoryW(void)
+{
+    static wchar_t text[] = L"64 MiB";
+    size_t bytes;
+    wchar_t *endptr;
+
+    stringToMemoryW(&bytes, text, 0, SIZE_MAX, &endptr, MEM_B);
+}
+
+
+static void parseTimestamp(void)
+{
+    int64_t ns;
+    char *endptr;
+
+    stringToTimestamp(&ns, "2026-10-17T12:34:56.789+02:00", INT64_MIN, INT64_MAX, &endptr);
+}
+
+
+static void parseTimestampBatch(void)
+{
+    static char *tokens[ALLOC_BATCH] =
+    {
+        "2026-10-17T12:34:56Z", "2026-10-17 12:34:56.5", "1970-01-01T00:00:00+01:00", "2000-02-29T23:59:59.999999999Z"
+    };
+    int64_t ns[ALLOC_BATCH];
+    ParseErr errors[ALLOC_BATCH];
+
+    stringToTimestampBatch(ns, errors, tokens, ALLOC_BATCH, INT64_MIN, INT64_MAX);
+}
+
+
+static void parseDuration(void)
+{
+    int64_t ns;
+    char *endptr;
+
+    stringToDuration(&ns, "1h30m15.5s", INT64_MIN, INT64_MAX, &endptr);
+}
+
+
+static void parseDurationBatch(void)
+{
+    static char *tokens[ALLOC_BATCH] = {"1h30m", "250ms", "-2.5s", "1d12h"};
+    int64_t ns[ALLOC_BATCH];
+    ParseErr errors[ALLOC_BATCH];
+
+    stringToDurationBatch(ns, errors, tokens, ALLOC_BATCH, INT64_MIN, INT64_MAX);
+}
+
+
+static void parseBytes(void)
+{
+    static const char TEXT[] = "de:ad:be:ef:ca:fe:ba:be";
+    uint8_t out[16];
+
+    stringToBytes(out, sizeof(out), TEXT, sizeof(TEXT) - 1, NULL, NULL, BYTES_COLON);
+}
+
+
+static void parseValue(void)
+{
+    Value value;
+    char *endptr;
+
+    stringToValue(&value, "2.5e-3", &endptr, VALUE_DOUBLE, 0);
+}
+
+
+static void parseQuantity(void)
+{
+    double x;
+    char *endptr;
+
+    stringToQuantity(&x, "10Gbps", 0.0, DBL_MAX, &endptr, quantities);
+}
+
+
+static void parseQuantityU(void)
+{
+    uintmax_t x;
+    char *endptr;
+
+    stringToQuantityU(&x, "4KiB", 0, UINTMAX_MAX, &endptr, quantities);
+}
+
+
+static void parseLexed(void)
+{
+    Lexed number;
+    double x;
+    char *endptr;
+
+    if (stringToLexed(&number, "123456.789e-2", &endptr) == PARSE_SUCCESS)
+        lexedToDouble(&x, &number, -DBL_MAX, DBL_MAX);
+}
+
+
+static void parseLexedL(void)
+{
+    Lexed number;
+    long double x;
+    char *endptr;
+
+    if (stringToLexed(&number, "2.718281828459045235360287", &endptr) == PARSE_SUCCESS)
+        lexedToDoubleL(&x, &number, -LDBL_MAX, LDBL_MAX);
+}
+
+
+static void parseLexedComplex(void)
+{
+    Lexed number;
+    complex z;
+    char *endptr;
+
+    if (stringToLexed(&number, "1.5e3-2.25i", &endptr) == PARSE_SUCCESS)
+        lexedToComplex(&z, &number, CMPLX_MIN, CMPLX_MAX);
+}
+
+
+#ifdef MP_PREC
+static void parseMPZ(void)
+{
+    char *endptr;
+
+    stringToMPZ(mpzx, "-123456789012345678901234567890", NULL, NULL, &endptr, 10);
+}
+
+
+static void parseMPQ(void)
+{
+    char *endptr;
+
+    stringToMPQ(mpqx, "355/113", NULL, NULL, &endptr, 10);
+}
+
+
+static void parseMPFR(void)
+{
+    char *endptr;
+
+    stringToMPFR(mpfrx, "3.14159265358979323846264338327950288", NULL, NULL, &endptr, 10, MPFR_RNDN);
+}
+
+
+static void parseMPFRParallel(void)
+{
+    char *endptr;
+
+    stringToMPFRParallel(mpfrx, "3.14159265358979323846264338327950288", NULL, NULL, &endptr, 10, MPFR_RNDN, 1);
+}
+
+
+static void parseMPFRAuto(void)
+{
+    char *endptr;
+
+    stringToMPFRAuto(mpfrx, "2.71828182845904523536", NULL, NULL, &endptr, 10, MPFR_RNDN, 256);
+}
+
+
+static void parseComplexPartMPC(void)
+{
+    ComplexPt type;
+    char *endptr;
+
+    stringToComplexPartMPC(mpcx, "-1.25e2i", NULL, NULL, &endptr, 10, 256, MPC_RNDNN, &type);
+}
+
+
+static void parseComplexMPC(void)
+{
+    char *endptr;
+
+    stringToComplexMPC(mpcx, "1.5 - 2.75i", NULL, NULL, &endptr, 10, 256, MPC_RNDNN);
+}
+
+
+static void parseComplexMPCAuto(void)
+{
+    char *endptr;
+
+    stringToComplexMPCAuto(mpcx, "1.5 - 2.75i", NULL, NULL, &endptr, 10, 256, MPC_RNDNN);
+}
+
+
+static void parseLexedMPFR(void)
+{
+    Lexed number;
+    char *endptr;
+
+    if (stringToLexed(&number, "1.4142135623730950488016887242097", &endptr) == PARSE_SUCCESS)
+        lexedToMPFR(mpfrx, &number, NULL, NULL, MPFR_RNDN);
+}
+
+
+static void parseLexedMPC(void)
+{
+    Lexed number;
+    char *endptr;
+
+    if (stringToLexed(&number, "1.5e3-2.25i", &endptr) == PARSE_SUCCESS)
+        lexedToMPC(mpcx, &number, NULL, NULL, MPC_RNDNN);
+}
+#endif
@@ -1,8 +1,8 @@
 #include "../include/parser.h"
+#include "../include/options.h"
 
 #include <complex.h>
 #include <float.h>
-#include <getopt.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <math.h>
@@ -17,24 +17,25 @@
 #endif
 
 
+#ifdef MP_PREC
+static int mpfrDigits(mpfr_t x);
+#endif
+
+
 int main(int argc, char **argv)
 {
     #ifdef MP_PREC
-    /* Maximum precision of multiple-precision (MPFR) numbers */
-    const mpfr_prec_t MPFR_PREC = 512;
-
-    /* Get number of significant digits in MPFR result */
-    int mpfrDigits = (int) floor(MPFR_PREC / log2(10));
+    /*
+     * Maximum precision of multiple-precision (MPFR) numbers. Each is parsed
+     * with just the precision its digits need, up to this
+     */
+    const int MPFR_PREC = 512;
     #endif
 
-    /* End pointer of parsed sub-string */
-    char *endptr;
-
     unsigned long ulx;
     uintmax_t uintx;
     double dx;
-    ComplexPt cmplxPt;
-    complex imagx;
+    OptionComplexPart imagx = {0.0, COMPLEX_REAL};
     complex cmplxx;
     size_t memx;
 
@@ -49,115 +50,36 @@ int main(int argc, char **argv)
 
     char *program = argv[0];
 
-    int optionID;
-
-    #ifdef MP_PREC
-    const char *GETOPT_STRING = ":u:x:d:i:c:m:D:C:";
-    #else
-    const char *GETOPT_STRING = ":u:x:d:i:c:m:";
-    #endif
+    OptionError error;
+    int operands;
 
-    const struct option LONG_OPTIONS[] =
+    /* Each option's argument is parsed into its target by the parser for its type, in one pass */
+    const Option OPTIONS[] =
     {
-        {"ulong", required_argument, NULL, 'u'},
-        {"uintmax", required_argument, NULL, 'x'},
-        {"double", required_argument, NULL, 'd'},
-        {"imaginary", optional_argument, NULL, 'i'},
-        {"complex", required_argument, NULL, 'c'},
-        {"memory", required_argument, NULL, 'm'},
+        {"ulong", 'u', OPTION_ULONG, &ulx, {0}, {0}, BASE_DEC, &u},
+        {"uintmax", 'x', OPTION_UINTMAX, &uintx, {0}, {0}, BASE_DEC, &x},
+        {"double", 'd', OPTION_DOUBLE, &dx, {0}, {0}, 0, &d},
+        {"imaginary", 'i', OPTION_COMPLEX_PART, &imagx, {0}, {0}, 0, &i},
+        {"complex", 'c', OPTION_COMPLEX, &cmplxx, {0}, {0}, 0, &c},
+        {"memory", 'm', OPTION_MEMORY, &memx, {0}, {0}, MEM_MB, &m},
 
         #ifdef MP_PREC
-        {"mpfr", required_argument, NULL, 'D'},
-        {"mpc", required_argument, NULL, 'C'},
+        {"mpfr", 'D', OPTION_MPFR, &mpfrx, {0}, {0}, MPFR_PREC, &D},
+        {"mpc", 'C', OPTION_MPC, &mpcx, {0}, {0}, MPFR_PREC, &C},
         #endif
-
-        {0, 0, 0, 0}
     };
 
     u = x = d = i = c = m = false;
 
     #ifdef MP_PREC
-    /* Initialise MPFR and MPC variables */
-    mpfr_init2(mpfrx, MPFR_PREC);
-    mpc_init2(mpcx, MPFR_PREC);
+    /* Initialise MPFR and MPC variables (precision is set when parsed) */
+    mpfr_init2(mpfrx, MPFR_PREC_MIN);
+    mpc_init2(mpcx, MPFR_PREC_MIN);
     #endif
 
-    opterr = 0;
-    while ((optionID = getopt_long(argc, argv, GETOPT_STRING, LONG_OPTIONS, NULL)) != -1)
+    if (optionsParse(OPTIONS, sizeof(OPTIONS) / sizeof(OPTIONS[0]), argc, argv, &operands, &error) != PARSE_SUCCESS)
     {
-        ParseErr err = PARSE_SUCCESS;
-
-        switch (optionID)
-        {
-            case 'u':
-                u = true;
-                err = stringToULong(&ulx, optarg, 0, ULONG_MAX, &endptr, BASE_DEC);
-                break;
-            case 'x':
-                x = true;
-                err = stringToUIntMax(&uintx, optarg, 0, UINTMAX_MAX, &endptr, BASE_DEC);
-                break;
-            case 'd':
-                d = true;
-                err = stringToDouble(&dx, optarg, -(DBL_MAX), DBL_MAX, &endptr);
-                break;
-            case 'i':
-                i = true;
-                err = stringToComplexPart(&imagx, optarg, CMPLX_MIN, CMPLX_MAX, &endptr, &cmplxPt);
-                break;
-            case 'c':
-                c = true;
-                err = stringToComplex(&cmplxx, optarg, CMPLX_MIN, CMPLX_MAX, &endptr);
-                break;
-            case 'm':
-                m = true;
-                err = stringToMemory(&memx, optarg, 0, SIZE_MAX, &endptr, MEM_MB);
-                break;
-            
-            #ifdef MP_PREC
-            case 'D':
-                D = true;
-                err = stringToMPFR(mpfrx, optarg, NULL, NULL, &endptr, 0, MPFR_RNDN);
-                break;
-            case 'C':
-                C = true;
-                err = stringToComplexMPC(mpcx, optarg, NULL, NULL, &endptr, 0, MPFR_PREC, MPC_RNDNN);
-                break;
-            #endif
-
-            default:
-                continue;
-        }
-
-        switch (err)
-        {
-            case PARSE_SUCCESS:
-                continue;
-            case PARSE_EERR:
-                fprintf(stderr, "%s: -%c: Unknown parse error\n", program, optionID);
-                break;
-            case PARSE_ERANGE:
-                fprintf(stderr, "%s: -%c: Argument out of range\n", program, optionID);
-                break;
-            case PARSE_EMIN:
-                fprintf(stderr, "%s: -%c: Argument too small\n", program, optionID);
-                break;
-            case PARSE_EMAX:
-                fprintf(stderr, "%s: -%c: Argument too large\n", program, optionID);
-                break;
-            case PARSE_EEND:
-                fprintf(stderr, "%s: -%c: WARNING: Argument not fully parsed\n", program, optionID);
-                continue;
-            case PARSE_EBASE:
-                fprintf(stderr, "%s: -%c: Invalid conversion radix\n", program, optionID);
-                break;
-            case PARSE_EFORM:
-                fprintf(stderr, "%s: -%c: Incorrect argument format\n", program, optionID);
-                break;
-            default:
-                fprintf(stderr, "%s: -%c: Unknown parse error\n", program, optionID);
-                break;
-        }
+        optionsWriteError(stderr, program, &error);
 
         #ifdef MP_PREC
         mpfr_clear(mpfrx);
@@ -167,27 +89,39 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (operands < argc)
+        fprintf(stderr, "%s: Ignoring operand '%s'\n", program, argv[operands]);
+
     if (u) printf("Unsigned long        = %lu\n", ulx);
     if (x) printf("Unsigned integer max = %" PRIuMAX "\n", uintx);
     if (d) printf("Double               = %g\n", dx);
 
-    if (i) 
+    if (i)
     {
-        if (cmplxPt == COMPLEX_REAL)
-            printf("Complex part         = %f\n", creal(imagx));
-        else if (cmplxPt == COMPLEX_IMAGINARY)
-            printf("Complex part         = %fi\n", cimag(imagx));
+        if (imagx.part == COMPLEX_IMAGINARY)
+            printf("Complex part         = %fi\n", cimag(imagx.value));
+        else
+            printf("Complex part         = %f\n", creal(imagx.value));
     }
 
     if (c) printf("Complex              = %g + %gi\n", creal(cmplxx), cimag(cmplxx));
     if (m) printf("Memory               = %zu bytes\n", memx);
 
     #ifdef MP_PREC
-    if (D) mpfr_printf("MPFR floating-point  = %.*Rg\n", mpfrDigits, mpfrx);
+    /*
+     * Significant digits of each result follow from its precision, which is
+     * enough for an integer to be printed exactly, e.g. "--mpfr 1e100" or
+     * "--mpfr 123e2"
+     */
+    if (D && mpfr_integer_p(mpfrx))
+        mpfr_printf("MPFR floating-point  = %.0Rf\n", mpfrx);
+    else if (D)
+        mpfr_printf("MPFR floating-point  = %.*Rg\n", mpfrDigits(mpfrx), mpfrx);
+
     if (C)
     {
         mpfr_printf("MPC complex          = %.*Rg + %.*Rgi\n",
-            mpfrDigits, mpc_realref(mpcx), mpfrDigits, mpc_imagref(mpcx));
+            mpfrDigits(mpc_realref(mpcx)), mpc_realref(mpcx), mpfrDigits(mpc_imagref(mpcx)), mpc_imagref(mpcx));
     }
 
     mpfr_clear(mpfrx);
@@ -195,4 +129,15 @@ int main(int argc, char **argv)
     #endif
 
     return 0;
-}
\ No newline at end of file
+}
+
+
+#ifdef MP_PREC
+/* Number of significant decimal digits held by an MPFR number */
+static int mpfrDigits(mpfr_t x)
+{
+    int digits = (int) floor((double) mpfr_get_prec(x) / log2(10));
+
+    return (digits > 0) ? digits : 1;
+}
+#endif
@@ -0,0 +1,529 @@
+/* strtod_l() and newlocale() for the locale-free libc baseline */
+#define _GNU_SOURCE
+
+#include "../include/parser.h"
+
+#include <complex.h>
+#include <float.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <locale.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/*
+ * Scaling benchmark: runs each parser, and the libc function it wraps, on 1 to
+ * N threads at once, each over its own private tokens, and prints the
+ * aggregate throughput and the scaling efficiency (throughput over N times
+ * the one-thread throughput) at each thread count. A parser that stops
+ * scaling where its libc baseline does not points at contention in percy; one
+ * whose baseline stops scaling too points at libc (locale or errno access)
+ */
+
+
+/* Longest token generated, with its terminating null */
+#define SCALE_TOKEN_SIZE 48
+
+
+enum ScaleKind
+{
+    SCALE_INTEGER,
+    SCALE_DOUBLE,
+    SCALE_COMPLEX,
+    SCALE_MEMORY,
+    SCALE_TIMESTAMP,
+    SCALE_DURATION
+};
+
+
+struct ScaleWorker;
+
+/* A parser (or libc baseline) and the tokens it parses */
+struct ScaleCase
+{
+    const char *name;
+    enum ScaleKind kind;
+    void (*run)(struct ScaleWorker *worker);
+};
+
+/* One benchmark thread, with its private tokens and results */
+struct ScaleWorker
+{
+    pthread_t thread;
+    pthread_barrier_t *barrier;
+    const struct ScaleCase *scaleCase;
+    unsigned long rounds;
+    uint64_t seed;
+
+    char *text;
+    char **tokens;
+    size_t n;
+
+    /* Room for n of the largest result (long double), and n errors */
+    long double *out;
+    ParseErr *errors;
+
+    /* When this thread started and finished parsing */
+    struct timespec start;
+    struct timespec end;
+
+    bool failed;
+};
+
+
+static int runCase(const struct ScaleCase *scaleCase, unsigned long threads, size_t n, unsigned long rounds,
+                   double *rate);
+static void *workerMain(void *arg);
+static bool makeTokens(struct ScaleWorker *worker, enum ScaleKind kind);
+static uint64_t nextRandom(uint64_t *state);
+static double elapsed(const struct timespec *start, const struct timespec *end);
+
+static void runULong(struct ScaleWorker *worker);
+static void runStrtoul(struct ScaleWorker *worker);
+static void runDouble(struct ScaleWorker *worker);
+static void runStrtod(struct ScaleWorker *worker);
+static void runStrtodL(struct ScaleWorker *worker);
+static void runDoubleL(struct ScaleWorker *worker);
+static void runStrtold(struct ScaleWorker *worker);
+static void runComplex(struct ScaleWorker *worker);
+static void runComplexDialectBatch(struct ScaleWorker *worker);
+static void runMemory(struct ScaleWorker *worker);
+static void runTimestamp(struct ScaleWorker *worker);
+static void runTimestampBatch(struct ScaleWorker *worker);
+static void runDuration(struct ScaleWorker *worker);
+static void runDurationBatch(struct ScaleWorker *worker);
+
+
+/* The C locale, for strtod_l() */
+static locale_t cLocale;
+
+
+static const struct ScaleCase CASES[] =
+{
+    {"stringToULong", SCALE_INTEGER, runULong},
+    {"strtoul", SCALE_INTEGER, runStrtoul},
+    {"stringToDouble", SCALE_DOUBLE, runDouble},
+    {"strtod", SCALE_DOUBLE, runStrtod},
+    {"strtod_l (C locale)", SCALE_DOUBLE, runStrtodL},
+    {"stringToDoubleL", SCALE_DOUBLE, runDoubleL},
+    {"strtold", SCALE_DOUBLE, runStrtold},
+    {"stringToComplex", SCALE_COMPLEX, runComplex},
+    {"stringToComplexDialectBatch", SCALE_COMPLEX, runComplexDialectBatch},
+    {"stringToMemory", SCALE_MEMORY, runMemory},
+    {"stringToTimestamp", SCALE_TIMESTAMP, runTimestamp},
+    {"stringToTimestampBatch", SCALE_TIMESTAMP, runTimestampBatch},
+    {"stringToDuration", SCALE_DURATION, runDuration},
+    {"stringToDurationBatch", SCALE_DURATION, runDurationBatch}
+};
+
+
+int main(int argc, char **argv)
+{
+    const char *GETOPT_STRING = ":t:n:r:f:";
+
+    const struct option LONG_OPTIONS[] =
+    {
+        {"threads", required_argument, NULL, 't'},
+        {"values", required_argument, NULL, 'n'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"function", required_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0}
+    };
+
+    char *program = argv[0];
+    char *endptr;
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long maxThreads = online > 0 ? (unsigned long) online : 1;
+    unsigned long values = 1UL << 16;
+    unsigned long rounds = 16;
+    const char *function = NULL;
+
+    int optionID;
+
+    while ((optionID = getopt_long(argc, argv, GETOPT_STRING, LONG_OPTIONS, NULL)) != -1)
+    {
+        unsigned long *option = NULL;
+
+        switch (optionID)
+        {
+            case 't':
+                option = &maxThreads;
+                break;
+            case 'n':
+                option = &values;
+                break;
+            case 'r':
+                option = &rounds;
+                break;
+            case 'f':
+                function = optarg;
+                continue;
+            case ':':
+                fprintf(stderr, "%s: Option '-%c' requires an argument\n", program, optopt);
+                return 1;
+            default:
+                fprintf(stderr, "Usage: %s [-t THREADS] [-n VALUES] [-r ROUNDS] [-f FUNCTION]\n", program);
+                return 1;
+        }
+
+        if (stringToULong(option, optarg, 1, 1UL << 24, &endptr, BASE_DEC) != PARSE_SUCCESS)
+        {
+            fprintf(stderr, "%s: Invalid count '%s', expected 1 to %lu\n", program, optarg, 1UL << 24);
+            return 1;
+        }
+    }
+
+    cLocale = newlocale(LC_ALL_MASK, "C", (locale_t) 0);
+
+    if (cLocale == (locale_t) 0)
+    {
+        fprintf(stderr, "%s: Cannot create the C locale\n", program);
+        return 1;
+    }
+
+    printf("%-28s %8s %14s %12s\n", "function", "threads", "Mvalues/s", "efficiency");
+
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i)
+    {
+        double single = 0.0;
+
+        if (function && strcmp(function, CASES[i].name))
+            continue;
+
+        for (unsigned long threads = 1; threads <= maxThreads; ++threads)
+        {
+            double rate;
+
+            if (runCase(&CASES[i], threads, values, rounds, &rate))
+            {
+                fprintf(stderr, "%s: %s: Out of memory or a token rejected on %lu threads\n", program,
+                        CASES[i].name, threads);
+                freelocale(cLocale);
+                return 1;
+            }
+
+            if (threads == 1)
+                single = rate;
+
+            printf("%-28s %8lu %14.3f %12.3f\n", threads == 1 ? CASES[i].name : "", threads, rate / 1e6,
+                   rate / (single * (double) threads));
+        }
+    }
+
+    freelocale(cLocale);
+
+    return 0;
+}
+
+
+/*
+ * Run `scaleCase` on `threads` threads, each parsing its own `n` tokens
+ * `rounds` times, and give the aggregate values parsed per second in `rate`.
+ * Return non-zero on error
+ */
+static int runCase(const struct ScaleCase *scaleCase, unsigned long threads, size_t n, unsigned long rounds,
+                   double *rate)
+{
+    struct ScaleWorker *workers = calloc(threads, sizeof(*workers));
+    pthread_barrier_t barrier;
+    struct timespec *start, *end;
+    unsigned long started = 0;
+    bool failed = false;
+
+    if (!workers)
+        return 1;
+
+    if (pthread_barrier_init(&barrier, NULL, (unsigned) threads + 1))
+    {
+        free(workers);
+        return 1;
+    }
+
+    for (; started < threads; ++started)
+    {
+        workers[started].barrier = &barrier;
+        workers[started].scaleCase = scaleCase;
+        workers[started].rounds = rounds;
+        workers[started].seed = 0x9E3779B97F4A7C15ULL * (started + 1);
+        workers[started].n = n;
+
+        if (pthread_create(&workers[started].thread, NULL, workerMain, &workers[started]))
+            break;
+    }
+
+    /* Every thread must reach both barriers, so a failed start cannot be recovered */
+    if (started < threads)
+    {
+        fprintf(stderr, "Cannot start thread %lu\n", started);
+        exit(1);
+    }
+
+    /* Tokens generated, then all rounds parsed */
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+
+    start = &workers[0].start;
+    end = &workers[0].end;
+
+    /* Timed from the first thread to start parsing to the last to finish */
+    for (unsigned long i = 0; i < threads; ++i)
+    {
+        pthread_join(workers[i].thread, NULL);
+        failed |= workers[i].failed;
+
+        if (elapsed(&workers[i].start, start) > 0.0)
+            start = &workers[i].start;
+
+        if (elapsed(end, &workers[i].end) > 0.0)
+            end = &workers[i].end;
+    }
+
+    *rate = (double) n * (double) rounds * (double) threads / elapsed(start, end);
+
+    pthread_barrier_destroy(&barrier);
+    free(workers);
+
+    return failed;
+}
+
+
+/*
+ * Generate the tokens, parse them `rounds` times between the two barriers,
+ * timing this thread alone, then check none was rejected
+ */
+static void *workerMain(void *arg)
+{
+    struct ScaleWorker *worker = arg;
+
+    worker->out = malloc(worker->n * sizeof(*worker->out));
+    worker->errors = calloc(worker->n, sizeof(*worker->errors));
+    worker->failed = !worker->out || !worker->errors || !makeTokens(worker, worker->scaleCase->kind);
+
+    pthread_barrier_wait(worker->barrier);
+    clock_gettime(CLOCK_MONOTONIC, &worker->start);
+
+    if (!worker->failed)
+    {
+        for (unsigned long round = 0; round < worker->rounds; ++round)
+            worker->scaleCase->run(worker);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &worker->end);
+    pthread_barrier_wait(worker->barrier);
+
+    /* The libc baselines leave every error PARSE_SUCCESS */
+    for (size_t i = 0; !worker->failed && i < worker->n; ++i)
+        worker->failed = worker->errors[i] != PARSE_SUCCESS;
+
+    free(worker->text);
+    free(worker->tokens);
+    free(worker->out);
+    free(worker->errors);
+
+    return NULL;
+}
+
+
+/* Fill the worker's private tokens with random values of `kind`. Return false if out of memory */
+static bool makeTokens(struct ScaleWorker *worker, enum ScaleKind kind)
+{
+    worker->text = malloc(worker->n * SCALE_TOKEN_SIZE);
+    worker->tokens = malloc(worker->n * sizeof(*worker->tokens));
+
+    if (!worker->text || !worker->tokens)
+        return false;
+
+    for (size_t i = 0; i < worker->n; ++i)
+    {
+        char *token = worker->tokens[i] = worker->text + i * SCALE_TOKEN_SIZE;
+        uint64_t r = nextRandom(&worker->seed);
+
+        switch (kind)
+        {
+            case SCALE_INTEGER:
+                snprintf(token, SCALE_TOKEN_SIZE, "%" PRIu64, r >> (r & 63));
+                break;
+            case SCALE_DOUBLE:
+                snprintf(token, SCALE_TOKEN_SIZE, "%.17g", (double) (r >> 11) * 0x1p-53 * 1e3);
+                break;
+            case SCALE_COMPLEX:
+                snprintf(token, SCALE_TOKEN_SIZE, "%.9g%+.9gi", (double) (r >> 40) / 1e3,
+                         (double) (int32_t) r / 1e5);
+                break;
+            case SCALE_MEMORY:
+                snprintf(token, SCALE_TOKEN_SIZE, "%u%s", (unsigned) (r >> 54), (r & 1) ? "kB" : "MB");
+                break;
+            case SCALE_TIMESTAMP:
+                snprintf(token, SCALE_TOKEN_SIZE, "20%02u-%02u-%02uT%02u:%02u:%02u.%06uZ",
+                         (unsigned) (r % 100), (unsigned) (r >> 8) % 12 + 1, (unsigned) (r >> 16) % 28 + 1,
+                         (unsigned) (r >> 24) % 24, (unsigned) (r >> 32) % 60, (unsigned) (r >> 40) % 60,
+                         (unsigned) (r >> 44) % 1000000);
+                break;
+            case SCALE_DURATION:
+                snprintf(token, SCALE_TOKEN_SIZE, "%uh%um%u.%03us", (unsigned) (r % 100),
+                         (unsigned) (r >> 8) % 60, (unsigned) (r >> 16) % 60, (unsigned) (r >> 24) % 1000);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* xorshift64* */
+static uint64_t nextRandom(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+
+/* Seconds from `start` to `end` */
+static double elapsed(const struct timespec *start, const struct timespec *end)
+{
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+
+static void runULong(struct ScaleWorker *worker)
+{
+    unsigned long *out = (unsigned long *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToULong(&out[i], worker->tokens[i], 0, ULONG_MAX, &endptr, BASE_DEC);
+}
+
+
+static void runStrtoul(struct ScaleWorker *worker)
+{
+    unsigned long *out = (unsigned long *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        out[i] = strtoul(worker->tokens[i], &endptr, 10);
+}
+
+
+static void runDouble(struct ScaleWorker *worker)
+{
+    double *out = (double *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToDouble(&out[i], worker->tokens[i], -DBL_MAX, DBL_MAX, &endptr);
+}
+
+
+static void runStrtod(struct ScaleWorker *worker)
+{
+    double *out = (double *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        out[i] = strtod(worker->tokens[i], &endptr);
+}
+
+
+static void runStrtodL(struct ScaleWorker *worker)
+{
+    double *out = (double *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        out[i] = strtod_l(worker->tokens[i], &endptr, cLocale);
+}
+
+
+static void runDoubleL(struct ScaleWorker *worker)
+{
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToDoubleL(&worker->out[i], worker->tokens[i], -LDBL_MAX, LDBL_MAX, &endptr);
+}
+
+
+static void runStrtold(struct ScaleWorker *worker)
+{
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->out[i] = strtold(worker->tokens[i], &endptr);
+}
+
+
+static void runComplex(struct ScaleWorker *worker)
+{
+    complex *out = (complex *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToComplex(&out[i], worker->tokens[i], CMPLX_MIN, CMPLX_MAX, &endptr);
+}
+
+
+static void runComplexDialectBatch(struct ScaleWorker *worker)
+{
+    stringToComplexDialectBatch((complex *) worker->out, worker->errors, worker->tokens, worker->n, CMPLX_MIN,
+                                CMPLX_MAX, DIALECT_STANDARD);
+}
+
+
+static void runMemory(struct ScaleWorker *worker)
+{
+    size_t *out = (size_t *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToMemory(&out[i], worker->tokens[i], 0, SIZE_MAX, &endptr, MEM_B);
+}
+
+
+static void runTimestamp(struct ScaleWorker *worker)
+{
+    int64_t *out = (int64_t *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToTimestamp(&out[i], worker->tokens[i], INT64_MIN, INT64_MAX, &endptr);
+}
+
+
+static void runTimestampBatch(struct ScaleWorker *worker)
+{
+    stringToTimestampBatch((int64_t *) worker->out, worker->errors, worker->tokens, worker->n, INT64_MIN,
+                           INT64_MAX);
+}
+
+
+static void runDuration(struct ScaleWorker *worker)
+{
+    int64_t *out = (int64_t *) worker->out;
+    char *endptr;
+
+    for (size_t i = 0; i < worker->n; ++i)
+        worker->errors[i] = stringToDuration(&out[i], worker->tokens[i], INT64_MIN, INT64_MAX, &endptr);
+}
+
+
+static void runDurationBatch(struct ScaleWorker *worker)
+{
+    stringToDurationBatch((int64_t *) worker->out, worker->errors, worker->tokens, worker->n, INT64_MIN,
+                          INT64_MAX);
+}
@@ -0,0 +1,421 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/parser.h"
+#include "../include/lexed.h"
+
+#include <complex.h>
+#include <float.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/*
+ * Worst-case benchmark: times each parser on a corpus of known slow inputs
+ * (halfway rounding cases, long subnormals, huge exponents, long whitespace,
+ * long hexadecimal mantissas, complex numbers failing late) next to a typical
+ * input, and reports the slowest inputs of each function. Exits with status 1
+ * if a median time exceeds the budget given with `-b`
+ */
+
+
+/* Most inputs in the corpus */
+#define WORST_INPUTS 64
+
+/* Significant digits of the long subnormal inputs */
+#define WORST_SUBNORMAL_DIGITS 768
+
+
+enum WorstFunction
+{
+    WORST_ULONG,
+    WORST_DOUBLE,
+    WORST_DOUBLEL,
+    WORST_COMPLEX,
+    WORST_LEXED,
+    WORST_FUNCTIONS
+};
+
+
+/* One input, its timings and its result */
+struct WorstInput
+{
+    const char *label;
+    enum WorstFunction function;
+    char *text;
+
+    double median;
+    double max;
+    ParseErr result;
+};
+
+
+static void buildCorpus(void);
+static void addInput(const char *label, enum WorstFunction function, char *text);
+static char *joinText(const char *prefix, char fill, size_t count, const char *suffix);
+static char *halfwaySubnormal(int side);
+static ParseErr parseInput(const struct WorstInput *input);
+static int compareSamples(const void *a, const void *b);
+static int compareInputs(const void *a, const void *b);
+static double now(void);
+
+
+static const char *const FUNCTION_NAMES[WORST_FUNCTIONS] =
+{
+    [WORST_ULONG] = "stringToULong",
+    [WORST_DOUBLE] = "stringToDouble",
+    [WORST_DOUBLEL] = "stringToDoubleL",
+    [WORST_COMPLEX] = "stringToComplex",
+    [WORST_LEXED] = "stringToLexed + lexedToDouble"
+};
+
+static const char *const ERROR_NAMES[] =
+{
+    [PARSE_SUCCESS] = "SUCCESS",
+    [PARSE_EERR] = "EERR",
+    [PARSE_ERANGE] = "ERANGE",
+    [PARSE_EMIN] = "EMIN",
+    [PARSE_EMAX] = "EMAX",
+    [PARSE_EEND] = "EEND",
+    [PARSE_EBASE] = "EBASE",
+    [PARSE_EFORM] = "EFORM"
+};
+
+
+static struct WorstInput corpus[WORST_INPUTS];
+static size_t inputs;
+
+
+int main(int argc, char **argv)
+{
+    const char *GETOPT_STRING = ":r:w:b:";
+
+    const struct option LONG_OPTIONS[] =
+    {
+        {"repeat", required_argument, NULL, 'r'},
+        {"worst", required_argument, NULL, 'w'},
+        {"budget", required_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0}
+    };
+
+    char *program = argv[0];
+    char *endptr;
+
+    unsigned long repeat = 101, worst = 3;
+    double budget = 0.0;
+    double *samples;
+
+    struct WorstInput *sorted;
+    double typical[WORST_FUNCTIONS] = {0.0};
+    bool overBudget = false;
+
+    int optionID;
+
+    while ((optionID = getopt_long(argc, argv, GETOPT_STRING, LONG_OPTIONS, NULL)) != -1)
+    {
+        ParseErr err;
+
+        switch (optionID)
+        {
+            case 'r':
+                err = stringToULong(&repeat, optarg, 1, 1000000, &endptr, BASE_DEC);
+                break;
+            case 'w':
+                err = stringToULong(&worst, optarg, 1, WORST_INPUTS, &endptr, BASE_DEC);
+                break;
+            case 'b':
+                err = stringToDouble(&budget, optarg, 0.0, DBL_MAX, &endptr);
+                break;
+            case ':':
+                fprintf(stderr, "%s: Option '-%c' requires an argument\n", program, optopt);
+                return 1;
+            default:
+                fprintf(stderr, "Usage: %s [-r REPEAT] [-w WORST] [-b BUDGET_NS]\n", program);
+                return 1;
+        }
+
+        if (err != PARSE_SUCCESS)
+        {
+            fprintf(stderr, "%s: Invalid argument '%s' for option '-%c'\n", program, optarg, optionID);
+            return 1;
+        }
+    }
+
+    samples = malloc(repeat * sizeof(*samples));
+    sorted = malloc(sizeof(corpus));
+
+    if (!samples || !sorted)
+    {
+        fprintf(stderr, "%s: Out of memory\n", program);
+        return 1;
+    }
+
+    buildCorpus();
+
+    printf("%-30s %-44s %12s %12s  %s\n", "function", "input", "median ns", "max ns", "result");
+
+    for (size_t i = 0; i < inputs; ++i)
+    {
+        struct WorstInput *input = &corpus[i];
+
+        if (!input->text)
+        {
+            fprintf(stderr, "%s: Out of memory\n", program);
+            return 1;
+        }
+
+        for (int warm = 0; warm < 3; ++warm)
+            input->result = parseInput(input);
+
+        for (unsigned long call = 0; call < repeat; ++call)
+        {
+            double start = now();
+
+            parseInput(input);
+            samples[call] = now() - start;
+        }
+
+        qsort(samples, repeat, sizeof(*samples), compareSamples);
+        input->median = samples[repeat / 2];
+        input->max = samples[repeat - 1];
+
+        /* The first input of each function is its typical one */
+        if (typical[input->function] == 0.0)
+            typical[input->function] = input->median;
+
+        printf("%-30s %-44s %12.0f %12.0f  %s\n", FUNCTION_NAMES[input->function], input->label, input->median,
+               input->max, ERROR_NAMES[input->result]);
+
+        if (budget > 0.0 && input->median > budget)
+            overBudget = true;
+    }
+
+    memcpy(sorted, corpus, inputs * sizeof(*sorted));
+    qsort(sorted, inputs, sizeof(*sorted), compareInputs);
+
+    printf("\nSlowest inputs by median time, and times the typical input's\n");
+
+    for (int function = 0; function < WORST_FUNCTIONS; ++function)
+    {
+        unsigned long shown = 0;
+
+        printf("%s\n", FUNCTION_NAMES[function]);
+
+        for (size_t i = 0; i < inputs && shown < worst; ++i)
+        {
+            if (sorted[i].function != (enum WorstFunction) function)
+                continue;
+
+            printf("  %-44s %12.0f %10.1fx\n", sorted[i].label, sorted[i].median,
+                   sorted[i].median / typical[function]);
+            ++shown;
+        }
+    }
+
+    for (size_t i = 0; i < inputs; ++i)
+        free(corpus[i].text);
+
+    free(samples);
+    free(sorted);
+
+    if (overBudget)
+    {
+        fprintf(stderr, "%s: An input took more than %.0f ns\n", program, budget);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* Fill the corpus, the typical input of each function first */
+static void buildCorpus(void)
+{
+    addInput("typical", WORST_ULONG, strdup("12345678"));
+    addInput("20 digits, overflowing", WORST_ULONG, strdup("18446744073709551616"));
+    addInput("10000 nines", WORST_ULONG, joinText("", '9', 10000, ""));
+    addInput("100000 leading zeros", WORST_ULONG, joinText("", '0', 100000, "1"));
+    addInput("65536 spaces", WORST_ULONG, joinText("", ' ', 65536, "1"));
+
+    addInput("typical", WORST_DOUBLE, strdup("3.141592653589793"));
+    addInput("halfway 2^53 + 1", WORST_DOUBLE, strdup("9007199254740993"));
+    addInput("halfway 2^53 + 1, 768 digits", WORST_DOUBLE, joinText("9007199254740993.", '0', 751, "1"));
+    addInput("just below halfway to overflow", WORST_DOUBLE, strdup("1.7976931348623158079e308"));
+    addInput("halfway 2^-1075, exact", WORST_DOUBLE, halfwaySubnormal(0));
+    addInput("768-digit subnormal above halfway", WORST_DOUBLE, halfwaySubnormal(1));
+    addInput("768-digit subnormal below halfway", WORST_DOUBLE, halfwaySubnormal(-1));
+    addInput("exponent 1e30", WORST_DOUBLE, joinText("1e", '9', 30, ""));
+    addInput("exponent -1e30", WORST_DOUBLE, joinText("1e-", '9', 30, ""));
+    addInput("10000 zeros, exponent -10000", WORST_DOUBLE, joinText("1", '0', 10000, "e-10000"));
+    addInput("10000 fraction zeros, exponent 10001", WORST_DOUBLE, joinText("0.", '0', 10000, "1e10001"));
+    addInput("65536 spaces", WORST_DOUBLE, joinText("", ' ', 65536, "1.5"));
+    addInput("hex, 4096-digit mantissa", WORST_DOUBLE, joinText("0x1.", 'f', 4096, "p0"));
+    addInput("hex, 4096-digit mantissa, exponent -16384", WORST_DOUBLE, joinText("0x", 'f', 4096, "p-16384"));
+
+    addInput("typical", WORST_DOUBLEL, strdup("3.14159265358979323846"));
+    addInput("halfway 2^64 + 1, 768 digits", WORST_DOUBLEL, joinText("18446744073709551617.", '0', 747, "1"));
+    addInput("768-digit subnormal above halfway", WORST_DOUBLEL, halfwaySubnormal(1));
+    addInput("10000 zeros, exponent -10000", WORST_DOUBLEL, joinText("1", '0', 10000, "e-10000"));
+    addInput("65536 spaces", WORST_DOUBLEL, joinText("", ' ', 65536, "1.5"));
+    addInput("hex, 4096-digit mantissa", WORST_DOUBLEL, joinText("0x1.", 'f', 4096, "p0"));
+
+    addInput("typical", WORST_COMPLEX, strdup("1.5-2.25i"));
+    addInput("two halfway 2^53 + 1, 768 digits", WORST_COMPLEX,
+             joinText("9007199254740993.", '0', 751, "1+9007199254740993i"));
+    addInput("768-digit part, then invalid 'j'", WORST_COMPLEX,
+             joinText("9007199254740993.", '0', 751, "1 + 1.5j"));
+    addInput("768-digit part, then invalid part", WORST_COMPLEX, joinText("1.5 + ", '9', 768, "x"));
+    addInput("768-digit parts, then a third part", WORST_COMPLEX, joinText("1.", '0', 766, "1 + 2i + 3"));
+    addInput("65536 spaces", WORST_COMPLEX, joinText("", ' ', 65536, "1.5-2.25i"));
+    addInput("65536 spaces between parts, invalid", WORST_COMPLEX, joinText("1.5", ' ', 65536, "+ 2.25"));
+    addInput("hex, 4096-digit mantissa", WORST_COMPLEX, joinText("0x1.", 'f', 4096, "p0i"));
+
+    addInput("typical", WORST_LEXED, strdup("3.141592653589793"));
+    addInput("halfway 2^53 + 1, 768 digits", WORST_LEXED, joinText("9007199254740993.", '0', 751, "1"));
+    addInput("768-digit subnormal above halfway", WORST_LEXED, halfwaySubnormal(1));
+    addInput("10000 zeros, exponent -10000", WORST_LEXED, joinText("1", '0', 10000, "e-10000"));
+    addInput("65536 spaces", WORST_LEXED, joinText("", ' ', 65536, "1.5"));
+}
+
+
+static void addInput(const char *label, enum WorstFunction function, char *text)
+{
+    if (inputs < WORST_INPUTS)
+        corpus[inputs++] = (struct WorstInput) {.label = label, .function = function, .text = text};
+    else
+        free(text);
+}
+
+
+/* `prefix`, `count` times `fill`, then `suffix`, in allocated memory */
+static char *joinText(const char *prefix, char fill, size_t count, const char *suffix)
+{
+    size_t prefixLength = strlen(prefix), suffixLength = strlen(suffix);
+    char *text = malloc(prefixLength + count + suffixLength + 1);
+
+    if (text)
+    {
+        memcpy(text, prefix, prefixLength);
+        memset(text + prefixLength, fill, count);
+        memcpy(text + prefixLength + count, suffix, suffixLength + 1);
+    }
+
+    return text;
+}
+
+
+/*
+ * 2^-1075, halfway between zero and the smallest subnormal double, written
+ * out exactly as the 752 digits of 5^1075 times 10^-1075. If `side` is
+ * positive (negative), it is padded to WORST_SUBNORMAL_DIGITS significant
+ * digits to fall just above (below) halfway: with zeros and a final one (or
+ * with the last 5 lowered to 4, and nines)
+ */
+static char *halfwaySubnormal(int side)
+{
+    unsigned char power[WORST_SUBNORMAL_DIGITS] = {1};
+    size_t digits = 1;
+    char *text = malloc(WORST_SUBNORMAL_DIGITS + 8);
+    char *c = text;
+
+    if (!text)
+        return NULL;
+
+    /* 5^1075, least significant digit first */
+    for (int i = 0; i < 1075; ++i)
+    {
+        unsigned carry = 0;
+
+        for (size_t j = 0; j < digits; ++j)
+        {
+            unsigned product = power[j] * 5U + carry;
+
+            power[j] = (unsigned char) (product % 10);
+            carry = product / 10;
+        }
+
+        if (carry)
+            power[digits++] = (unsigned char) carry;
+    }
+
+    if (side < 0)
+        power[0] = 4;
+
+    for (size_t j = digits; j-- > 0;)
+    {
+        *c++ = (char) ('0' + power[j]);
+
+        if (j == digits - 1)
+            *c++ = '.';
+    }
+
+    for (size_t j = digits; side && j < WORST_SUBNORMAL_DIGITS; ++j)
+        *c++ = side < 0 ? '9' : (j < WORST_SUBNORMAL_DIGITS - 1) ? '0' : '1';
+
+    strcpy(c, "e-324");
+
+    return text;
+}
+
+
+static ParseErr parseInput(const struct WorstInput *input)
+{
+    unsigned long ulx;
+    double dx;
+    long double ldx;
+    complex z;
+    Lexed number;
+    char *endptr;
+    ParseErr err;
+
+    switch (input->function)
+    {
+        case WORST_ULONG:
+            return stringToULong(&ulx, input->text, 0, ULONG_MAX, &endptr, BASE_DEC);
+        case WORST_DOUBLE:
+            return stringToDouble(&dx, input->text, -DBL_MAX, DBL_MAX, &endptr);
+        case WORST_DOUBLEL:
+            return stringToDoubleL(&ldx, input->text, -LDBL_MAX, LDBL_MAX, &endptr);
+        case WORST_COMPLEX:
+            return stringToComplex(&z, input->text, CMPLX_MIN, CMPLX_MAX, &endptr);
+        case WORST_LEXED:
+            err = stringToLexed(&number, input->text, &endptr);
+            return err != PARSE_SUCCESS ? err : lexedToDouble(&dx, &number, -DBL_MAX, DBL_MAX);
+        default:
+            return PARSE_EERR;
+    }
+}
+
+
+static int compareSamples(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* Slowest median first */
+static int compareInputs(const void *a, const void *b)
+{
+    double x = ((const struct WorstInput *) a)->median, y = ((const struct WorstInput *) b)->median;
+
+    return (x < y) - (x > y);
+}
+
+
+/* Monotonic time in nanoseconds */
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return (double) t.tv_sec * 1e9 + (double) t.tv_nsec;
+}
@@ -0,0 +1,61 @@
+#include "../include/profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*
+ * Merge the profiles saved by profileSave() (or through PERCY_PROFILE_FILE)
+ * in each file given, and print the latency percentiles of every parser
+ */
+int main(int argc, char **argv)
+{
+    char *program = argv[0];
+
+    Profile *total, *profile;
+    int status = 0;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s FILE...\n", program);
+        return 1;
+    }
+
+    total = malloc(sizeof(*total));
+    profile = malloc(sizeof(*profile));
+
+    if (!total || !profile)
+    {
+        fprintf(stderr, "%s: Out of memory\n", program);
+        free(total);
+        free(profile);
+        return 1;
+    }
+
+    profileClear(total);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        switch (profileLoad(profile, argv[i]))
+        {
+            case PARSE_SUCCESS:
+                profileMerge(total, profile);
+                continue;
+            case PARSE_EFORM:
+                fprintf(stderr, "%s: %s: Not a saved profile\n", program, argv[i]);
+                break;
+            default:
+                fprintf(stderr, "%s: %s: Cannot read file\n", program, argv[i]);
+                break;
+        }
+
+        status = 1;
+    }
+
+    profileWrite(stdout, total);
+
+    free(total);
+    free(profile);
+
+    return status;
+}
@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/stats.h"
+
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/*
+ * Attach to the statistics exported by a running process (statsExport()), by
+ * segment name or process ID, and print its parse rates every interval until
+ * it exits
+ */
+int main(int argc, char **argv)
+{
+    char *program = argv[0];
+    char *endptr;
+
+    char name[32];
+    const char *target;
+    double interval = 1.0;
+
+    const StatsSegment *segment;
+    StatsCounters last, now;
+    struct timespec lastTime, nowTime, pause;
+    unsigned long pid, lines = 0;
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s PID|NAME [SECONDS]\n", program);
+        return 1;
+    }
+
+    target = argv[1];
+
+    /* A process ID names the default segment "/percy.<pid>" */
+    if (stringToULong(&pid, argv[1], 1, LONG_MAX, &endptr, BASE_DEC) == PARSE_SUCCESS)
+    {
+        sprintf(name, "/percy.%lu", pid);
+        target = name;
+    }
+
+    if (argc == 3 && stringToDouble(&interval, argv[2], 0.01, 3600.0, &endptr) != PARSE_SUCCESS)
+    {
+        fprintf(stderr, "%s: Invalid interval '%s', expected 0.01 to 3600 seconds\n", program, argv[2]);
+        return 1;
+    }
+
+    switch (statsAttach(&segment, target))
+    {
+        case PARSE_SUCCESS:
+            break;
+        case PARSE_EFORM:
+            fprintf(stderr, "%s: %s: Not a percy statistics segment\n", program, target);
+            return 1;
+        default:
+            fprintf(stderr, "%s: %s: Cannot open segment\n", program, target);
+            return 1;
+    }
+
+    pause.tv_sec = (time_t) interval;
+    pause.tv_nsec = (long) ((interval - (double) pause.tv_sec) * 1e9);
+
+    statsRead(segment, &last);
+    clock_gettime(CLOCK_MONOTONIC, &lastTime);
+
+    /* Until the process has exited */
+    while (kill((pid_t) segment->pid, 0) == 0)
+    {
+        double seconds, values;
+        size_t threads;
+        uint64_t failed = 0;
+
+        nanosleep(&pause, NULL);
+
+        threads = statsRead(segment, &now);
+        clock_gettime(CLOCK_MONOTONIC, &nowTime);
+
+        seconds = (double) (nowTime.tv_sec - lastTime.tv_sec)
+                  + (double) (nowTime.tv_nsec - lastTime.tv_nsec) * 1e-9;
+        values = (double) (now.values - last.values);
+
+        for (size_t e = PARSE_SUCCESS + 1; e < STATS_OUTCOMES; ++e)
+            failed += now.outcomes[e] - last.outcomes[e];
+
+        if (lines++ % 20 == 0)
+        {
+            printf("%8s %14s %10s %10s %9s %8s %8s %8s %8s %8s %8s\n", "threads", "values", "values/s", "MB/s",
+                   "failed/s", "EFORM", "EEND", "ERANGE", "EMIN", "EMAX", "fast %");
+        }
+
+        printf("%8zu %14" PRIu64 " %10.0f %10.2f %9.0f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64
+               " %8" PRIu64 " %8.1f\n", threads, now.values, values / seconds,
+               (double) (now.bytes - last.bytes) / seconds / 1e6, (double) failed / seconds,
+               now.outcomes[PARSE_EFORM], now.outcomes[PARSE_EEND], now.outcomes[PARSE_ERANGE],
+               now.outcomes[PARSE_EMIN], now.outcomes[PARSE_EMAX],
+               (now.fast + now.slow) ? 100.0 * (double) now.fast / (double) (now.fast + now.slow) : 0.0);
+        fflush(stdout);
+
+        last = now;
+        lastTime = nowTime;
+    }
+
+    statsDetach(segment);
+
+    return 0;
+}